@@ -0,0 +1,137 @@
+#pragma once
+#include <Arduino.h>
+#include "Util.h"
+#include <esp_partition.h>
+#include "EventBus.h"
+
+// Registro de accesos persistente: anillo de registros binarios de 32 bytes
+// sobre una partición de datos en flash, sin sistema de archivos. Usa la
+// partición "journal" si la tabla la tiene; si no, la "spiffs" de la tabla
+// por defecto (1,375 MB, el firmware no la usa) = 352 sectores x 128
+// registros, ~45 000 accesos.
+//
+// - Append-only: cada registro lleva número de secuencia creciente y CRC-32.
+//   Un corte de energía a mitad de una escritura deja un registro con CRC
+//   inválido que se saltea al leer; begin() retoma después de él.
+// - Desgaste: se escribe en orden y un sector se borra recién cuando el
+//   anillo vuelve a él (el borrado descarta sus 128 registros más viejos),
+//   así cada sector se borra una vez por vuelta completa.
+// - log() se puede llamar desde cualquier tarea (la del sensor, al terminar
+//   el match): encola sin locks y loop() graba con flush(). Borrar un sector
+//   (~45 ms) ocurre una vez cada 128 registros.
+// - read() por número de secuencia desde cualquier tarea (GET /fp/journal).
+
+enum class JournalOutcome : uint8_t {
+  Match       = 0,   // 1:N o verify 1:1 aceptado
+  NoMatch     = 1,   // NOTFOUND
+  SensorError = 2,   // imagen, UART...
+  LowScore    = 3,   // hit del sensor rechazado por MatchPolicy: score < floor
+  NoAgreement = 4,   // hit en la zona gris sin acuerdo entre los slots del usuario
+  Confirmed   = 5,   // match en la zona gris confirmado por otros slots del usuario
+};
+
+struct JournalRecord {
+  uint32_t seq;         // 1.. creciente; 0xFFFFFFFF = lugar vacío
+  uint32_t time;        // unix s; 0 = sin hora (SNTP no sincronizó)
+  uint32_t uptimeMs;    // millis() del evento
+  int16_t  user;        // -1 sin match o slot sin dueño
+  int16_t  slot;        // -1 sin match
+  uint16_t score;
+  int16_t  claimed;     // verify 1:1: usuario declarado; -1 = 1:N
+  uint8_t  outcome : 4; // JournalOutcome
+  uint8_t  retries : 4; // recapturas por imagen mala (registros anteriores: 0)
+  uint8_t  rc;          // FINGERPRINT_*
+  uint16_t latencyMs;   // petición -> resultado (0 = desconocido)
+  uint32_t request;     // id de la petición de ScanRequest (0 = desconocida)
+  uint32_t crc;         // CRC-32 de los 28 bytes anteriores
+};
+static_assert(sizeof(JournalRecord) == 32, "JournalRecord: 32 bytes en flash");
+
+struct JournalStats {
+  uint32_t oldest;      // primer seq legible (0 = vacío)
+  uint32_t newest;      // último seq grabado
+  uint32_t capacity;    // registros que entran en la partición
+  uint32_t appended;    // grabados desde el arranque
+  uint32_t dropped;     // cola llena o error de flash
+  uint32_t badRecords;  // CRC inválido encontrados por begin()
+  uint32_t erases;      // sectores borrados desde el arranque
+};
+
+class AccessJournal {
+public:
+  static constexpr uint32_t SECTOR  = 4096;
+  static constexpr uint32_t PER_SECTOR = SECTOR / sizeof(JournalRecord);
+  static constexpr size_t   PENDING = 32;        // cola entre log() y flush()
+
+  // Busca la partición y la posición de escritura (lee el primer registro de
+  // cada sector y recorre el más nuevo). false sin partición.
+  bool begin();
+  bool ready() const { return _part != nullptr; }
+
+  // Cualquier tarea; completa seq, time, uptimeMs y crc. false si la cola está llena.
+  bool log(const JournalRecord& r);
+  // loop(): graba lo encolado
+  void flush();
+
+  // Registros válidos con seq >= fromSeq, en orden, hasta `max`. Devuelve la
+  // cantidad; 0 = no hay más.
+  size_t read(uint32_t fromSeq, JournalRecord* out, size_t max);
+
+  JournalStats stats();
+
+private:
+  enum class Slot : uint8_t { Empty, Valid, Bad };
+  static Slot check(const JournalRecord& r);
+  uint32_t scanFirst(uint32_t sector);
+  bool blank(uint32_t sector);
+  bool append(JournalRecord& r);
+
+  const esp_partition_t* _part = nullptr;
+  SemaphoreHandle_t _lock = nullptr;
+  uint32_t  _sectors = 0;
+  uint32_t* _firstSeq = nullptr;   // seq del primer registro válido de cada sector (0 = ninguno)
+  uint32_t  _headSector = 0;       // donde va el próximo registro
+  uint32_t  _headIndex  = 0;
+  uint32_t  _nextSeq    = 1;
+  uint32_t  _appended = 0, _badRecords = 0, _erases = 0;
+  std::atomic<uint32_t> _dropped{0};
+  MpmcRing<JournalRecord, PENDING> _pending;
+};
+
+// Consulta de GET /fp/journal: desde `fromSeq` (cursor de paginación: el
+// último seq recibido + 1), hasta `limit` registros, opcionalmente acotada
+// por hora unix [since, until] (registros sin hora quedan afuera).
+enum class JournalFormat : uint8_t { Csv, Ndjson };
+
+struct JournalQuery {
+  uint32_t fromSeq = 0;
+  uint32_t limit   = 1000;
+  uint32_t since   = 0;              // 0 = sin cota
+  uint32_t until   = 0;
+  JournalFormat format = JournalFormat::Csv;
+};
+
+// Arma la respuesta de a pedazos (respuesta chunked): una línea por registro,
+// CSV con encabezado o NDJSON. Lee la flash de a BATCH registros.
+class JournalExporter {
+public:
+  static constexpr size_t BATCH = 16;
+
+  JournalExporter(AccessJournal& journal, const JournalQuery& q) : _journal(journal), _q(q), _next(q.fromSeq) {}
+  size_t fill(uint8_t* out, size_t maxLen);
+  uint32_t sent() const { return _sent; }
+
+private:
+  bool nextRecord(JournalRecord& r);
+
+  AccessJournal& _journal;
+  JournalQuery   _q;
+  uint32_t _next;
+  uint32_t _sent = 0;
+  bool     _header = true;
+  bool     _end = false;
+  JournalRecord _batch[BATCH];
+  size_t   _batchLen = 0, _batchPos = 0;
+  char     _line[208];
+  size_t   _lineLen = 0, _lineOff = 0;
+};
@@ -5,25 +5,135 @@
 #include "NamesModel.h"
 #include "FingerprintApi.h"
 #include "ScanRequest.h"
+#include "SensorWorker.h"
+#include "SearchEngine.h"
+#include "SlotMap.h"
+#include "MatchPolicy.h"
 #include "Bitmaps.h"
+#include "ScanMetrics.h"
+#include <Preferences.h>
+#include <atomic>
 
 enum class AutoState { WAIT_FINGER, MATCHING, COOLDOWN };
 
+// Free-run (molinete, entrada con mucho tránsito): armado sin petición, sin
+// animación mínima. El resultado de la persona N queda en pantalla resultMs
+// mientras la N+1 ya apoya el dedo; se re-arma apenas se levanta el dedo.
+//   ARMED     esperando dedo (pollFinger)
+//   MATCHING  job en la tarea del sensor (reusa la imagen de pollFinger)
+//   LIFT      esperando que levante el dedo
+enum class FreeRunState { ARMED, MATCHING, LIFT };
+
+// Resultado para consumidores externos (SSE, relé). Se entrega desde la
+// tarea del sensor apenas termina el job, sin esperar la animación
+// (minScanMs): la pantalla lo muestra después, por su cuenta.
+struct ScanOutcome {
+  bool     ok;
+  int      user;      // dueño del slot (SlotMap); -1 sin match o sin dueño
+  int      page;      // slot que coincidió; -1 sin match
+  int      score;
+  int      claimed;   // verify 1:1: usuario declarado; -1 = 1:N
+  uint8_t  rc;        // FINGERPRINT_*
+  uint32_t latencyUs; // requestScan -> entrega (0 = desconocido)
+  uint32_t requestId; // petición de ScanRequest atendida (0 = desconocida)
+  uint8_t  retries;   // recapturas dentro del job (imagen mala o segundo buffer)
+  PolicyReason reason; // veredicto de MatchPolicy (None sin hit o sin política)
+};
+// Corre en la tarea del sensor: no tocar la UART ni bloquear
+typedef void (*ScanResultFn)(void* ctx, const ScanOutcome& r);
+
+// Tiempos de la UI, configurables por equipo (NVS namespace "auto"):
+// minScanMs = animación mínima antes de mostrar el resultado, resultMs =
+// tiempo que se ve el resultado, relayMs = pulso del relé en un match.
+struct AutoTiming {
+  uint32_t minScanMs;
+  uint32_t resultMs;
+  uint32_t relayMs;
+};
+
+// Traspaso del resultado entre la tarea del sensor y loop():
+// la tarea escribe ok/id/score y después publica `doneSeq` con release;
+// loop() lee `doneSeq` con acquire y recién entonces los campos.
 struct MatchJob {
-  bool active = false;
-  bool done   = false;
-  bool ok     = false;
-  int  id     = -1;
-  int  score  = 0;
+  bool     active = false;   // sólo lo toca loop()
+  uint32_t seq    = 0;       // job esperado (0 = ninguno)
+  int      claimed = -1;     // verify 1:1: usuario declarado (lo fija loop() antes de submit)
+  uint32_t requestId = 0;    // petición atendida (idem)
+  int64_t  requestUs = 0;    // esp_timer de requestScan (0 = desconocido)
+  int64_t  detectUs  = 0;    // dedo detectado = submit del job
+  bool     imageReady = false; // free-run: pollFinger ya dejó la imagen en el sensor
+  unsigned long deadlineMs = 0;  // millis(): la tarea deja de recapturar (antes que loop() lo venza)
+  uint8_t  rc     = 0;
+  uint8_t  retries = 0;      // lo escribe la tarea antes de publicar doneSeq
+  PolicyReason reason = PolicyReason::None;   // idem
+  bool     ok     = false;
+  int      id     = -1;
+  int      score  = 0;
+  std::atomic<uint32_t> doneSeq{0};
+  std::atomic<uint32_t> abandonedSeq{0};   // vencido en loop(): no entregar el resultado
+
+  bool done() const { return seq != 0 && doneSeq.load(std::memory_order_acquire) == seq; }
 };
 
 class AutoMode {
 public:
-  AutoMode(DisplayModel& d, FingerprintModel& f, NamesModel& n) 
-    : display(d), finger(f), names(n) {}
+  AutoMode(DisplayModel& d, FingerprintModel& f, NamesModel& n, SensorWorker& w,
+           SearchEngine& s, SlotMap& m)
+    : display(d), finger(f), names(n), worker(w), search(s), slots(m) {}
+
+  static constexpr uint32_t TIMING_MAX_MS = 10000;
+
+  // Consumidor del resultado (lo llama la tarea del sensor); setear antes de begin()
+  void onResult(ScanResultFn fn, void* ctx) { resultFn = fn; resultCtx = ctx; }
+  // Umbrales de score por usuario/zona/horario; nullptr = cualquier hit del
+  // sensor es match. Setear antes de begin().
+  void setPolicy(MatchPolicy* p) { policy = p; }
+
+  AutoTiming timing() const {
+    AutoTiming t;
+    t.minScanMs = minScanMs.load(std::memory_order_relaxed);
+    t.resultMs  = resultMs.load(std::memory_order_relaxed);
+    t.relayMs   = relayMs.load(std::memory_order_relaxed);
+    return t;
+  }
+
+  // Desde cualquier tarea (API, CLI); aplica al próximo scan. false si algún
+  // valor está fuera de rango (resultMs >= 200, todos <= TIMING_MAX_MS).
+  bool setTiming(const AutoTiming& t, bool persist = true) {
+    if (t.minScanMs > TIMING_MAX_MS || t.resultMs < 200 || t.resultMs > TIMING_MAX_MS ||
+        t.relayMs > TIMING_MAX_MS)
+      return false;
+    minScanMs.store(t.minScanMs, std::memory_order_relaxed);
+    resultMs.store(t.resultMs, std::memory_order_relaxed);
+    relayMs.store(t.relayMs, std::memory_order_relaxed);
+    if (persist) {
+      Preferences p;
+      if (p.begin(TIMING_NS, false)) {
+        p.putBytes("timing", &t, sizeof(t));
+        p.end();
+      }
+    }
+    return true;
+  }
+
+  bool freeRun() const { return freeRunOn.load(std::memory_order_relaxed); }
+
+  // Desde cualquier tarea; loop() cambia de modo cuando no hay un job en curso
+  void setFreeRun(bool on, bool persist = true) {
+    freeRunOn.store(on, std::memory_order_relaxed);
+    if (persist) {
+      Preferences p;
+      if (p.begin(TIMING_NS, false)) {
+        p.putBool("freeRun", on);
+        p.end();
+      }
+    }
+  }
 
   // Llamar en setup()
   void begin() {
+    loadTiming();
+
     // asegurar estado inicial: no esperar huella y mostrar idle
     cancelScan();                     // limpiar cualquier petición previa
     waitingForFinger = false;
@@ -51,11 +161,28 @@ public:
       prevState = state;
     }
 
+    // Cambio de modo (API/CLI): sólo entre scans, nunca con un job en el sensor
+    const bool wantFreeRun = freeRunOn.load(std::memory_order_relaxed);
+    const bool jobRunning = job.active && !job.done();
+    if (wantFreeRun != runningFreeRun && !jobRunning && state != AutoState::MATCHING) {
+      runningFreeRun = wantFreeRun;
+      Serial.printf("[AutoMode] modo %s at %lu\n", runningFreeRun ? "free-run" : "interactivo", now);
+      forcedReturnAt = 0;
+      waitingForFinger = false;
+      frShownUntil = 0;
+      frState = FreeRunState::LIFT;     // si quedó un dedo apoyado, esperar que lo levante
+      state = AutoState::WAIT_FINGER;
+      uiDrawn = AutoState::WAIT_FINGER;
+      if (runningFreeRun) display.scanning();
+      else drawWaitingCommand();
+    }
+    if (runningFreeRun) { tickFreeRun(now); return; }
+
     // Si programamos un retorno forzado a idle, cumplirlo (por seguridad)
     if (forcedReturnAt != 0 && (long)(now - forcedReturnAt) >= 0) {
       Serial.printf("[AutoMode] forced return to idle at %lu\n", now);
       forcedReturnAt = 0;
-      cancelScan();
+      // la petición atendida ya terminó al mostrar el resultado; no tocar la cola
       waitingForFinger = false;
       state = AutoState::WAIT_FINGER;
       uiDrawn = AutoState::WAIT_FINGER;
@@ -80,14 +207,22 @@ public:
           if (!waitingForFinger) {
             waitingForFinger = true;
             display.scanning();    // pantalla que indica "Ponga su huella"
-            Serial.printf("[AutoMode] requestScan -> waitingForFinger at %lu\n", millis());
+            Serial.printf("[AutoMode] requestScan #%u -> waitingForFinger at %lu\n",
+                          (unsigned)activeRequestId(), millis());
             uiDrawn = AutoState::MATCHING; // usamos MATCHING UI mientras esperamos el dedo
           }
 
-          // Si detecta dedo => arrancar MATCHING (tarea background)
-          if (finger.chip().getImage() != FINGERPRINT_NOFINGER) {
+          // Si detecta dedo => arrancar MATCHING (tarea background).
+          // No tocar la UART mientras la tarea del sensor siga con un job viejo
+          // (p.ej. uno que venció por timeout). Con línea touch, pollFinger()
+          // no manda GenImg hasta que la ISR vea el dedo.
+          const bool sensorBusy = job.active && !job.done();
+          if (!sensorBusy && finger.pollFinger() != FINGERPRINT_NOFINGER) {
             // salir del modo "esperando dedo" porque ya apoyó el dedo
             waitingForFinger = false;
+            job.detectUs  = fpMetricsNow();
+            job.requestUs = scanRequestedAtUs();
+            if (job.requestUs) fpMetricsRecord(MetricStage::FingerWait, (uint32_t)(job.detectUs - job.requestUs));
             Serial.printf("[AutoMode] dedo detectado -> start MATCHING at %lu\n", millis());
 
             // arrancamos animación y matching como antes
@@ -96,16 +231,25 @@ public:
             display.drawFpPhase(phase);
 
             scanStart       = now;
-            matchingDeadline= now + 15000;
+            matchingDeadline= now + MATCH_TIMEOUT_MS;
             resultReady     = false;
 
-            job.done = false;
-            job.active = true;
-            xTaskCreatePinnedToCore(+[](void* arg){
-              AutoMode* self = static_cast<AutoMode*>(arg);
-              self->runMatchTask();
-              vTaskDelete(nullptr);
-            }, "fingerMatch", 8192, this, 1, nullptr, 0);
+            // el match corre en la tarea persistente del sensor
+            job.claimed = claimedUser();
+            job.requestId = activeRequestId();
+            job.imageReady = false;
+            job.deadlineMs = matchingDeadline - RETRY_MARGIN_MS;
+            job.seq = worker.submit(&AutoMode::matchJobRun, &AutoMode::matchJobDone, this);
+            job.active = (job.seq != 0);
+            if (!job.active) {
+              fpMetricsCount(MetricCounter::QueueDrop);
+              display.errorMsg("Sensor ocupado");
+              Serial.printf("[AutoMode] cola del sensor llena -> cooldown at %lu\n", millis());
+              cooldownUntil = now + resultMs.load(std::memory_order_relaxed);
+              state = AutoState::COOLDOWN;
+              uiDrawn = AutoState::COOLDOWN;
+              break;
+            }
 
             // reset scan bar
             scanBarY = FP_Y;
@@ -140,53 +284,68 @@ public:
               // mostrar sólo icono de OK centrado (sin nombre/texto)
               showCenteredIcon(ICON_OK_64);
               // opcional: imprimir info por serial para debug
-              const int slotsPerUser = 5;
-              int userId = (resultId >= 0) ? (resultId / slotsPerUser) : -1;
-              String name = names.get(userId);
-              Serial.printf("Match OK: user=%d name='%s' score=%d\n", userId, name.c_str(), resultScore);
+              int userId = (resultId >= 0) ? slots.userOf((uint16_t)resultId) : -1;
+              char name[NamesModel::NAME_MAX + 1] = "";
+              if (userId >= 0) names.copy((uint16_t)userId, name, sizeof(name));
+              Serial.printf("Match OK: user=%d name='%s' score=%d\n", userId, name, resultScore);
             } else {
               // mostrar sólo icono de ERROR centrado
               showCenteredIcon(ICON_ERR_64);
-              Serial.println("Match FAIL: sin coincidencia");
+              if (job.claimed >= 0) Serial.printf("Verify FAIL: no es user=%d\n", job.claimed);
+              else Serial.println("Match FAIL: sin coincidencia");
             }
-            Serial.printf("[AutoMode] result shown ok=%d id=%d score=%d at %lu\n", resultOk, resultId, resultScore, millis());
+            Serial.printf("[AutoMode] result shown #%u ok=%d id=%d score=%d at %lu\n",
+                          (unsigned)job.requestId, resultOk, resultId, resultScore, millis());
+            fpMetricsSince(MetricStage::Result, job.detectUs);
+            fpMetricsSince(MetricStage::Total, job.requestUs);
+            fpMetricsPerson(MetricMode::Interactive);
 
-            // Asegurar que cancelamos cualquier petición de escaneo y salimos del modo "esperando dedo"
+            // Terminar la petición atendida y salir del modo "esperando dedo" (las encoladas siguen)
             cancelScan();
             waitingForFinger = false;
 
-            // programar un retorno forzado a idle tras RESULT_MS por si algo re-habilita el modo
-            forcedReturnAt = millis() + RESULT_MS;
+            // programar un retorno forzado a idle tras resultMs por si algo re-habilita el modo
+            const uint32_t shownMs = resultMs.load(std::memory_order_relaxed);
+            forcedReturnAt = millis() + shownMs;
 
-            cooldownUntil = now + RESULT_MS;
+            cooldownUntil = now + shownMs;
             state  = AutoState::COOLDOWN;
             uiDrawn= AutoState::COOLDOWN;
           }
           break;
         }
 
-        // 3) ¿Job en background ya terminó? Setear resultado y marcar tiempo de show
-        if (job.active && job.done) {
+        // 3) ¿Job en background ya terminó? Setear resultado y marcar tiempo de show.
+        //    Los consumidores externos ya lo recibieron en matchJobDone().
+        if (job.active && job.done()) {
           job.active = false;
           resultOk    = job.ok;
           resultId    = job.id;
           resultScore = job.score;
           resultReady = true;
+          fpMetricsCount(job.ok ? MetricCounter::Match
+                         : job.rc == FINGERPRINT_NOTFOUND ? MetricCounter::NoMatch
+                         : MetricCounter::SensorError);
           // asegurar que ha pasado el mínimo de tiempo de escaneo visual
+          const unsigned long minMs = minScanMs.load(std::memory_order_relaxed);
           unsigned long elapsed = now - scanStart;
-          if (elapsed >= minScanMs) {
+          if (elapsed >= minMs) {
             showResultAt = now; // mostrar inmediatamente
           } else {
-            showResultAt = scanStart + minScanMs; // esperar al mínimo
+            showResultAt = scanStart + minMs; // esperar al mínimo
           }
           break;
         }
 
         // 4) ¿Timeout global?
         if ((long)(now - matchingDeadline) >= 0) {
+          fpMetricsCount(MetricCounter::MatchTimeout);
+          // si el job termina igual, ya no abre la puerta ni avisa por SSE
+          job.abandonedSeq.store(job.seq, std::memory_order_release);
+          cancelScan();
           display.errorMsg("Tiempo agotado");
           Serial.printf("[AutoMode] matching timeout -> enter cooldown at %lu\n", millis());
-          cooldownUntil = now + RESULT_MS;
+          cooldownUntil = now + resultMs.load(std::memory_order_relaxed);
           state = AutoState::COOLDOWN;
           uiDrawn = AutoState::COOLDOWN;
         }
@@ -200,8 +359,8 @@ public:
           // asegurar que la UI vuelva a idle inmediatamente
           uiDrawn = AutoState::WAIT_FINGER;
           waitingForFinger = false;
-          // también cancelar petición por si quedó en cola desde otro lado
-          cancelScan();
+          // sin cancelScan(): tras "Sensor ocupado" la misma petición se
+          // reintenta (si no venció); las encoladas siguen
           forcedReturnAt = 0;
           drawWaitingCommand();
         }
@@ -210,106 +369,98 @@ public:
     }
   }
 
+  AutoState currentState() const { return state; }
+  FreeRunState currentFreeRunState() const { return frState; }
+
 private:
   // ===== modelos
   DisplayModel&     display;
   FingerprintModel& finger;
   NamesModel&       names;
-
-  // helper: dibuja logo en idle
-  void drawWaitingCommand() {
-    auto& d = display.raw();
-    d.clearDisplay();
-
-    // offset horizontal (desplazar 32 píxeles a la derecha)
-    const int xOffset = 32;
-    const int yOffset = 0;
-
-    // debug: leer primeros bytes del bitmap para comprobar que existe en PROGMEM
-    uint8_t first = pgm_read_byte_near(ICON_PERMAQUIM_64);
-    Serial.printf("[AutoMode] ICON_PERMAQUIM_64 first=0x%02x\n", first);
-
-    // contar píxeles para detectar formato
-    auto countPixels = [&](bool msbFirst)->int {
-      int count = 0;
-      for (int y = 0; y < ICON_H; ++y) {
-        for (int x = 0; x < ICON_W; ++x) {
-          int bitIndex = y * ICON_W + x;
-          int byteIndex = bitIndex >> 3;
-          int bitPos = bitIndex & 7;
-          uint8_t b = pgm_read_byte_near(ICON_PERMAQUIM_64 + byteIndex);
-          bool on = msbFirst ? ((b >> (7 - bitPos)) & 1) : ((b >> bitPos) & 1);
-          if (on) ++count;
-        }
-      }
-      return count;
-    };
-
-    int msbCount = countPixels(true);
-    int lsbCount = countPixels(false);
-    Serial.printf("[AutoMode] pixelCounts msb=%d lsb=%d\n", msbCount, lsbCount);
-
-    if (msbCount == 0 && lsbCount == 0) {
-      // fallback texto centrado
-      d.setTextSize(1);
-      d.setTextColor(SH110X_WHITE);
-      d.setCursor(0, 28);
-      d.print("Waiting command");
-      d.display();
-      return;
+  SensorWorker&     worker;
+  SearchEngine&     search;
+  SlotMap&          slots;
+
+  // ===== free-run: un paso de la máquina ARMED -> MATCHING -> LIFT
+  void tickFreeRun(unsigned long now) {
+    // el resultado anterior se borra a los resultMs, salvo que ya haya otro
+    if (frShownUntil && (long)(now - frShownUntil) >= 0) {
+      frShownUntil = 0;
+      display.scanning();
     }
 
-    bool useMsb = msbCount >= lsbCount;
+    switch (frState) {
+      case FreeRunState::ARMED: {
+        // una petición encolada (verify 1:1, request id) la atiende el próximo dedo
+        const bool requested = isScanRequested();
+        if (finger.pollFinger() == FINGERPRINT_NOFINGER) break;
+        job.detectUs   = fpMetricsNow();
+        job.requestUs  = requested ? scanRequestedAtUs() : 0;
+        if (job.requestUs) fpMetricsRecord(MetricStage::FingerWait, (uint32_t)(job.detectUs - job.requestUs));
+        job.claimed    = requested ? claimedUser() : -1;
+        job.requestId  = requested ? activeRequestId() : 0;
+        job.imageReady = true;      // el GenImg de pollFinger ya capturó: Img2Tz directo
+        matchingDeadline = now + MATCH_TIMEOUT_MS;
+        job.deadlineMs = matchingDeadline - RETRY_MARGIN_MS;
+        job.seq = worker.submit(&AutoMode::matchJobRun, &AutoMode::matchJobDone, this);
+        job.active = (job.seq != 0);
+        if (!job.active) { fpMetricsCount(MetricCounter::QueueDrop); break; }   // reintenta en el próximo poll
+        frState = FreeRunState::MATCHING;
+        break;
+      }
 
-  #if FP_BITMAP_IS_XBM
-    if (useMsb) {
-      d.drawXBitmap(xOffset, yOffset, ICON_PERMAQUIM_64, ICON_W, ICON_H, SH110X_WHITE);
-    } else {
-      // dibujado manual LSB
-      for (int y = 0; y < ICON_H; ++y) {
-        for (int x = 0; x < ICON_W; ++x) {
-          int bitIndex = y * ICON_W + x;
-          int byteIndex = bitIndex >> 3;
-          int bitPos = bitIndex & 7;
-          uint8_t b = pgm_read_byte_near(ICON_PERMAQUIM_64 + byteIndex);
-          bool on = ((b >> bitPos) & 1);
-          if (on) d.drawPixel(x + xOffset, y + yOffset, SH110X_WHITE);
+      case FreeRunState::MATCHING: {
+        if (job.done()) {
+          // ya entregado a SSE/relé en matchJobDone(); acá sólo la pantalla
+          job.active = false;
+          fpMetricsCount(job.ok ? MetricCounter::Match
+                         : job.rc == FINGERPRINT_NOTFOUND ? MetricCounter::NoMatch
+                         : MetricCounter::SensorError);
+          showCenteredIcon(job.ok ? ICON_OK_64 : ICON_ERR_64);
+          fpMetricsSince(MetricStage::Result, job.detectUs);
+          fpMetricsSince(MetricStage::Total, job.requestUs);
+          fpMetricsPerson(MetricMode::FreeRun);
+          Serial.printf("[AutoMode] free-run #%u ok=%d id=%d score=%d at %lu\n",
+                        (unsigned)job.requestId, job.ok, job.id, job.score, now);
+          if (job.requestId) cancelScan();
+          frShownUntil = now + resultMs.load(std::memory_order_relaxed);
+          frState = FreeRunState::LIFT;
+        } else if ((long)(now - matchingDeadline) >= 0) {
+          fpMetricsCount(MetricCounter::MatchTimeout);
+          job.abandonedSeq.store(job.seq, std::memory_order_release);
+          // job.active sigue: no tocar la UART hasta que la tarea lo suelte
+          if (job.requestId) cancelScan();
+          display.errorMsg("Tiempo agotado");
+          frShownUntil = now + resultMs.load(std::memory_order_relaxed);
+          frState = FreeRunState::LIFT;
         }
+        break;
       }
-    }
-  #else
-    if (!useMsb) {
-      d.drawBitmap(xOffset, yOffset, ICON_PERMAQUIM_64, ICON_W, ICON_H, SH110X_WHITE);
-    } else {
-      // dibujado manual MSB
-      for (int y = 0; y < ICON_H; ++y) {
-        for (int x = 0; x < ICON_W; ++x) {
-          int bitIndex = y * ICON_W + x;
-          int byteIndex = bitIndex >> 3;
-          int bitPos = bitIndex & 7;
-          uint8_t b = pgm_read_byte_near(ICON_PERMAQUIM_64 + byteIndex);
-          bool on = ((b >> (7 - bitPos)) & 1);
-          if (on) d.drawPixel(x + xOffset, y + yOffset, SH110X_WHITE);
+
+      case FreeRunState::LIFT: {
+        // job vencido todavía en la tarea del sensor: esperar a que termine
+        if (job.active) {
+          if (!job.done()) break;
+          job.active = false;
         }
+        // con línea touch no usa la UART; sin ella, un GenImg por vuelta
+        if (finger.pollFinger() == FINGERPRINT_NOFINGER) frState = FreeRunState::ARMED;
+        break;
       }
     }
-  #endif
-
-    d.display();
   }
 
+  // helper: pantalla de reposo (frame cacheado en DisplayModel)
+  void drawWaitingCommand() { display.idle(); }
+
   // helper: mostrar icono centrado sin texto
   void showCenteredIcon(const uint8_t* icon) {
     auto& d = display.raw();
     d.clearDisplay();
     const int xOffset = 32; // desplazar 32 píxeles a la derecha  
     const int yOffset = 0;
-  #if FP_BITMAP_IS_XBM
-    d.drawXBitmap(xOffset, yOffset, icon, ICON_W, ICON_H, SH110X_WHITE);
-  #else
-    d.drawBitmap(xOffset, yOffset, icon, ICON_W, ICON_H, SH110X_WHITE);
-  #endif
-    d.display();
+    display.drawImage(xOffset, yOffset, icon, ICON_W, ICON_H);
+    display.flush();
   }
 
   // ===== estado UI
@@ -326,9 +477,28 @@ private:
   int8_t   phaseDir = +1;
   unsigned long nextPhaseAt = 0;
   static constexpr unsigned long PHASE_MS     = 150;   // más chico = más rápido
-  static constexpr unsigned long RESULT_MS    = 1500; // tiempo que se ve el resultado
-  // MIN_SCAN_MS ahora configurable en runtime:
-  unsigned long minScanMs = 3900;  // "mínimo escaneo" visual (ms)
+  // configurables en runtime (setTiming); los escribe otra tarea
+  std::atomic<uint32_t> minScanMs{3900};  // "mínimo escaneo" visual (ms)
+  std::atomic<uint32_t> resultMs{1500};   // tiempo que se ve el resultado
+  std::atomic<uint32_t> relayMs{1000};    // pulso del relé en un match
+  static constexpr const char* TIMING_NS = "auto";
+
+  // ===== match: plazo y recapturas
+  static constexpr unsigned long MATCH_TIMEOUT_MS = 15000;  // dedo detectado -> loop() abandona el job
+  static constexpr unsigned long RETRY_MARGIN_MS  = 1000;   // la tarea no arranca recapturas pasado deadline - esto
+  static constexpr uint8_t CAPTURE_RETRIES = 3;             // recapturas por IMAGEMESS/FEATUREFAIL
+  static constexpr bool    SECOND_BUFFER   = true;          // NOTFOUND del sensor: una captura más en CharBuffer2
+
+  // ===== free-run
+  std::atomic<bool> freeRunOn{false};      // pedido (API/CLI, NVS "auto"/"freeRun")
+  bool runningFreeRun = false;             // el que usa loop()
+  FreeRunState frState = FreeRunState::LIFT;
+  unsigned long frShownUntil = 0;          // resultado en pantalla hasta (0 = nada)
+
+  // ===== entrega del resultado
+  ScanResultFn resultFn  = nullptr;
+  void*        resultCtx = nullptr;
+  MatchPolicy* policy    = nullptr;
 
   // ===== timers
   unsigned long scanStart        = 0;
@@ -385,29 +555,158 @@ private:
      // así evitamos restos dejados por la barra anterior
      auto& d = display.raw();
      d.fillRect(FP_X, FP_Y, FP_W, FP_H, SH110X_BLACK); // limpia área FP
-     display.drawFpPhase(phase);                        // pinta huella original
+     display.drawFpPhase(phase, false);                 // pinta huella original
      // barra horizontal blanca que cruza la imagen de la huella (en la mitad derecha)
      d.fillRect(FP_X, scanBarY, FP_W, SCANBAR_THICK, SH110X_WHITE);
-     d.display();
+     display.flush();                                   // sólo las columnas/páginas que cambiaron
    }
 
-  // --- tarea en background (bloqueante sin afectar UI)
-  void runMatchTask() {
-    auto& chip = finger.chip();
-    bool ok = false; int id = -1; int score = 0;
+  // --- job de match: corre en la tarea del sensor (bloqueante sin afectar UI)
+  static void matchJobRun(void* ctx, SensorResult& r) {
+    static_cast<AutoMode*>(ctx)->runMatchTask(r);
+  }
+
+  void loadTiming() {
+    Preferences p;
+    if (!p.begin(TIMING_NS, true)) return;     // primera vez: sin namespace
+    AutoTiming t;
+    const bool found = p.getBytesLength("timing") == sizeof(t) && p.getBytes("timing", &t, sizeof(t));
+    p.end();
+    if (found && !setTiming(t, false)) Serial.println("[AutoMode] tiempos en NVS inválidos");
+    if (p.begin(TIMING_NS, true)) {
+      freeRunOn.store(p.getBool("freeRun", false), std::memory_order_relaxed);
+      p.end();
+    }
+  }
+
+  // --- en la tarea del sensor, antes de avisar a loop(): el resultado sale
+  //     ya, la animación sigue hasta minScanMs
+  void deliver(const SensorResult& r) {
+    ScanOutcome o;
+    o.ok        = r.ok;
+    o.page      = r.ok ? r.id : -1;
+    o.user      = r.ok ? slots.userOf((uint16_t)r.id) : -1;
+    o.score     = r.ok ? r.score : 0;
+    o.claimed   = job.claimed;
+    o.rc        = r.rc;
+    o.latencyUs = job.requestUs ? (uint32_t)(fpMetricsNow() - job.requestUs) : 0;
+    o.requestId = job.requestId;
+    o.retries   = job.retries;
+    o.reason    = job.reason;
+    if (o.latencyUs) fpMetricsRecord(MetricStage::Deliver, o.latencyUs);
+    if (resultFn) resultFn(resultCtx, o);
+  }
+
+  // --- completado: entregar y publicar el resultado para loop()
+  static void matchJobDone(void* ctx, const SensorResult& r) {
+    AutoMode* self = static_cast<AutoMode*>(ctx);
+    MatchJob& job = self->job;
+    if (r.seq != job.abandonedSeq.load(std::memory_order_acquire)) self->deliver(r);
+    job.rc    = r.rc;
+    job.ok    = r.ok;
+    // job.retries ya lo dejó runMatchTask()
+    job.id    = r.id;
+    job.score = r.ok ? r.score : 0;
+    job.doneSeq.store(r.seq, std::memory_order_release);
+    // job.active se limpia en loop() cuando procese el resultado
+  }
 
-    // Hacer la captura en el task (bloqueante aquí, pero no afecta UI)
-    if (chip.getImage() == FINGERPRINT_OK) {
-      if (chip.image2Tz(1) == FINGERPRINT_OK) {
-        ok = (chip.fingerFastSearch() == FINGERPRINT_OK);
-        if (ok) { id = chip.fingerID; score = chip.confidence; }
+  bool retryTimeLeft() const { return (long)(millis() - job.deadlineMs) < 0; }
+
+  // --- captura + extracción en `buf`. El R305 no informa la calidad de la
+  //     imagen: el código de Img2Tz es la compuerta. IMAGEMESS/FEATUREFAIL
+  //     (dedo sucio, corrido, apoyado a medias) vuelve a capturar, hasta
+  //     CAPTURE_RETRIES veces y dentro de job.deadlineMs; si el dedo se
+  //     levantó, espera a que lo vuelva a apoyar. La primera extracción buena
+  //     va directo a la búsqueda. La espera a que lo vuelva a apoyar va al
+  //     ritmo de PollPolicy (PollScheduler, como captureToBuffer) hasta
+  //     job.deadlineMs. Una recaptura cuenta en job.retries recién
+  //     cuando el sensor devolvió la imagen nueva; con `retry` (segundo
+  //     buffer) la primera imagen ya es una recaptura.
+  uint8_t captureFeatures(uint8_t buf, bool imageReady, bool retry = false) {
+    auto& chip = finger.chip();
+    const PollPolicy& pace = finger.pollPolicy();
+    PollScheduler replace(pace.fastMs, pace.fastWindowMs, pace.maxMs, 0);
+    uint8_t bad = 0;            // último IMAGEMESS/FEATUREFAIL
+    for (;;) {
+      uint8_t rc = FINGERPRINT_OK;
+      if (!imageReady) {
+        const int64_t t = fpMetricsNow();
+        rc = chip.getImage();
+        if (rc == FINGERPRINT_OK || !bad) fpMetricsSince(MetricStage::GetImage, t);
+      }
+      imageReady = false;
+      if (rc == FINGERPRINT_OK) {
+        if (bad || retry) {
+          ++job.retries;
+          fpMetricsCount(MetricCounter::CaptureRetry);
+          Serial.printf("[AutoMode] %s -> recaptura %u\n", bad ? "Img2Tz mala" : "NOTFOUND", job.retries);
+          retry = false;
+        }
+        const int64_t t = fpMetricsNow();
+        rc = chip.image2Tz(buf);
+        fpMetricsSince(MetricStage::Image2Tz, t);
+        if (rc != FINGERPRINT_IMAGEMESS && rc != FINGERPRINT_FEATUREFAIL) return rc;
+        if (job.retries >= CAPTURE_RETRIES || !retryTimeLeft()) return rc;
+        bad = rc;
+        // el ritmo rápido arranca con cada imagen mala; el plazo es el del job
+        replace = PollScheduler(pace.fastMs, pace.fastWindowMs, pace.maxMs, job.deadlineMs - millis());
+      } else if (rc != FINGERPRINT_NOFINGER || !bad) {
+        return rc;              // UART, o sin dedo en la primera captura (como antes)
+      } else if (!retryTimeLeft() || !replace.next()) {
+        return bad;             // no lo volvió a apoyar: informar la imagen mala
       }
     }
+  }
+
+  // --- búsqueda con las características de `buf`: verify 1:1 o 1:N por zonas.
+  //     Con política, un hit rechazado (score bajo, sin acuerdo entre slots)
+  //     vuelve como NOTFOUND y el motivo queda en job.reason.
+  uint8_t searchBuffer(uint8_t buf, SensorResult& r) {
+    const int64_t t0 = fpMetricsNow();
+    uint16_t page = 0, score = 0;
+    int zone = -1;
+    uint8_t rc;
+    if (job.claimed >= 0) {
+      // verify 1:1: Search acotado a los slots del usuario declarado
+      rc = slots.verify((uint16_t)job.claimed, buf, page, score);
+    } else {
+      // 1:N por zonas (SearchEngine): la propia primero, después los fallbacks
+      rc = search.search(buf, page, score, zone);
+    }
+    if (rc == FINGERPRINT_OK || rc == FINGERPRINT_NOTFOUND) fpMetricsSince(MetricStage::Search, t0);
+    if (rc == FINGERPRINT_OK && policy) {
+      const PolicyVerdict v = policy->decide(buf, page, score, zone);
+      job.reason = v.reason;
+      if (!v.accept) rc = FINGERPRINT_NOTFOUND;
+    }
+    if (rc == FINGERPRINT_OK) { r.id = page; r.score = score; }
+    return rc;
+  }
 
-    job.ok   = ok;
-    job.id   = id;
-    job.score= ok ? score : 0;
-    job.done = true;
-    // job.active se limpia en el thread que lanzó la tarea cuando procese el resultado
+  void runMatchTask(SensorResult& r) {
+    const int64_t t0 = fpMetricsNow();
+    fpMetricsRecord(MetricStage::Queue, (uint32_t)(t0 - job.detectUs));
+    job.retries = 0;
+    job.reason  = PolicyReason::None;
+
+    // Hacer la captura en el task (bloqueante aquí, pero no afecta UI).
+    // Free-run: la imagen del GenImg que detectó el dedo ya está en el sensor.
+    r.rc = captureFeatures(1, job.imageReady);
+    if (r.rc == FINGERPRINT_OK) {
+      r.rc = searchBuffer(1, r);
+      // el sensor no encontró nada con una extracción buena pero quizás
+      // pobre: otra captura en CharBuffer2, si el dedo sigue apoyado y queda
+      // plazo. Un hit que rechazó la política (job.reason) ya tuvo veredicto:
+      // recapturar sólo demoraría al impostor.
+      if (SECOND_BUFFER && r.rc == FINGERPRINT_NOTFOUND && job.reason == PolicyReason::None &&
+          job.retries < CAPTURE_RETRIES && retryTimeLeft()) {
+        const uint8_t rc2 = captureFeatures(2, false, true);
+        if (rc2 == FINGERPRINT_OK) r.rc = searchBuffer(2, r);
+      }
+    }
+    r.ok = (r.rc == FINGERPRINT_OK);
+    if (r.ok && job.retries) fpMetricsCount(MetricCounter::RetryRecovered);
+    fpMetricsSince(MetricStage::Job, t0);
   }
 };
\ No newline at end of file
@@ -4,7 +4,9 @@
 #define FP64_W 64
 #define FP64_H 64
 
-// 0 = drawBitmap (LSB-first), 1 = drawXBitmap (XBM/MSB-first)
+// 0 = drawBitmap (MSB-first), 1 = drawXBitmap (XBM/LSB-first).
+// scripts/gen_paged_bitmaps.py lee este flag de build_flags para generar
+// BitmapsPaged.h con el mismo orden de bits.
 #ifndef FP_BITMAP_IS_XBM
 #define FP_BITMAP_IS_XBM 0
 #endif
@@ -10,10 +10,32 @@
 #ifndef HTTP_PORT
 #define HTTP_PORT 80
 #endif
+// 1 = listar redes Wi-Fi al arrancar (diagnóstico; suma ~2 s al boot)
+#ifndef FP_WIFI_SCAN
+#define FP_WIFI_SCAN 0
+#endif
 
 // R305 en UART2 remapeado (cruzado)
 static const int FP_PIN_RX = 25;  // TX del R305 -> RX del ESP32
 static const int FP_PIN_TX = 26;  // RX del R305 <- TX del ESP32
+// Salida touch/WAKEUP del sensor (R307/R503). -1 = no cableada: AutoMode
+// detecta el dedo sólo por polling de GenImg.
+static const int  FP_PIN_TOUCH = -1;
+static const bool FP_TOUCH_ACTIVE_HIGH = true;
+
+// Relé de la cerradura: se activa apenas hay match (AutoMode::onResult), sin
+// esperar la animación; el pulso dura `relayMs` (GET /fp/timing). -1 = sin relé.
+static const int  FP_PIN_RELAY = -1;
+static const bool FP_RELAY_ACTIVE_HIGH = true;
+
+// Enlace con el sensor: tope de baud y tamaño de paquete que negocia al
+// arrancar (FingerprintModel::negotiate)
+#ifndef FP_MAX_BAUD
+#define FP_MAX_BAUD 115200
+#endif
+#ifndef FP_MAX_PACKET
+#define FP_MAX_PACKET 256
+#endif
 
 // I2C OLED
 static const int I2C_SDA = 21;
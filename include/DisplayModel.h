@@ -0,0 +1,84 @@
+#pragma once
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_SH110X.h>
+
+// Estadísticas de flush parcial (bytes de datos de píxeles enviados por I2C)
+struct FlushStats {
+  uint32_t frames     = 0;   // flush() que enviaron algo
+  uint32_t lastBytes  = 0;   // bytes del último frame enviado
+  uint8_t  lastPages  = 0;   // máscara de páginas enviadas en el último frame
+  uint64_t totalBytes = 0;
+};
+
+class DisplayModel {
+public:
+  explicit DisplayModel(Adafruit_SH1106G& d, int xoff = 2, TwoWire& wire = Wire)
+    : _display(d), _wire(wire), _xoff(xoff) {}
+  Adafruit_SH1106G& raw();  // acceso al objeto OLED (después de dibujar, llamar a flush())
+
+  // Envía al panel sólo lo que cambió desde el último flush: por cada una de
+  // las 8 páginas del SH1106 compara contra la copia enviada y manda el rango
+  // de columnas modificado. Reemplaza a raw().display().
+  void flush();
+  // Fuerza que el próximo flush() envíe el frame completo (panel desconocido).
+  void invalidate() { _shadowValid = false; }
+  const FlushStats& flushStats() const { return _stats; }
+
+  // Inicialización del OLED (wrapper conveniente)
+  bool begin(uint8_t addr = 0x3C, bool reset = true);
+
+  // Pantallas básicas (podés ajustar los textos a gusto)
+  // idle(): logo Permaquim centrado (o texto si el bitmap está vacío). El frame
+  // se arma una sola vez y después se restaura con una copia del buffer.
+  void idle();
+  void scanning();
+  void welcome(const String& nombre, uint16_t id, int score);
+  void errorMsg(const String& msg);
+  void okMsg(const String& l2 = "");
+
+  // Dibuja un bitmap de Bitmaps.h. Transparente como drawXBitmap: los bits en
+  // 0 no tocan lo que hay debajo; con `opaque` también pinta el fondo. Si
+  // existe su versión en páginas (BitmapsPaged.h) y `y` es múltiplo de 8, la
+  // combina por bytes (OR o copia) en el frame buffer; si no, cae a
+  // drawBitmap/drawXBitmap.
+  void drawImage(int x, int y, const uint8_t* img, int w, int h, bool opaque = false);
+
+  // Dibujo del ícono 64x64
+  void drawFp64Right();
+
+  // Animación por fases (0=25%, 1=50%, 2=75%, 3=100)
+  void drawFpPhase(uint8_t phase, bool flushNow = true);
+  void drawFpPhaseLabeled(uint8_t phase, uint8_t label);
+
+  // Compatibilidad: si alguien aún llama a ON/OFF
+  void scanBlinkTick(bool on);
+
+  // Offset horizontal típico del SH1106
+  void setXOffset(int xo) { _xoff = xo; }
+  int  xoffset() const { return _xoff; }
+  void drawOkRight();
+  void drawErrRight();
+
+private:
+  static constexpr int WIDTH = 128;
+  static constexpr int PAGES = 8;              // 64 filas / 8
+  static constexpr uint8_t COL_OFFSET = 2;     // RAM del SH1106 es de 132 columnas
+  static constexpr uint8_t I2C_CHUNK = 31;     // bytes de datos por transacción (como Adafruit_SH110X)
+
+  bool blitPaged(int x, int y, const uint8_t* img, int w, int h, bool opaque);
+  void renderIdleFrame();
+  void sendPage(uint8_t page, uint8_t x0, uint8_t x1, const uint8_t* row);
+
+  Adafruit_SH1106G& _display;
+  TwoWire& _wire;
+  int _xoff;
+  uint8_t _addr = 0x3C;
+  bool _shadowValid = false;
+  uint8_t _shadow[WIDTH * PAGES];              // lo que tiene el panel
+  bool _idleValid = false;
+  uint8_t _idleFrame[WIDTH * PAGES];           // frame de reposo pre-renderizado
+  FlushStats _stats;
+};
+
+  
@@ -0,0 +1,31 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// Salida de relé (cerradura / molinete). pulse() lo activa desde cualquier
+// tarea (AutoMode lo llama desde la tarea del sensor apenas hay match) y
+// loop() lo apaga al vencer el pulso. Con pin -1 no hace nada.
+class DoorRelay {
+public:
+  DoorRelay(int pin, bool activeHigh) : _pin(pin), _activeHigh(activeHigh) {}
+
+  void begin();
+  // Activa `ms` ms (0 = nada); un pulso durante otro lo extiende
+  void pulse(uint32_t ms);
+  // Llamar seguido desde loop()
+  void loop();
+
+  bool enabled() const { return _pin >= 0; }
+  bool on() const { return _offAt.load(std::memory_order_acquire) != 0; }
+  uint32_t pulses() const { return _pulses.load(std::memory_order_relaxed); }
+
+private:
+  void write(bool on);
+
+  const int  _pin;
+  const bool _activeHigh;
+  // único estado compartido: millis() de apagado, 0 = apagado. loop() lo
+  // libera con CAS, así no pisa un pulso que pulse() puso en el medio
+  std::atomic<uint32_t> _offAt{0};
+  std::atomic<uint32_t> _pulses{0};
+};
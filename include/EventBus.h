@@ -0,0 +1,163 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Cola acotada sin locks, varios productores / varios consumidores (esquema de
+// Vyukov: cada celda lleva su número de secuencia). N debe ser potencia de 2.
+// T se copia por valor: pensada para registros chicos (FpEvent = 12 bytes).
+template <typename T, size_t N>
+class MpmcRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "N debe ser potencia de 2");
+public:
+  MpmcRing() {
+    for (size_t i = 0; i < N; ++i) _cells[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  bool push(const T& v) {
+    Cell* c;
+    size_t pos = _enq.load(std::memory_order_relaxed);
+    for (;;) {
+      c = &_cells[pos & (N - 1)];
+      const size_t seq = c->seq.load(std::memory_order_acquire);
+      const intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+      if (dif == 0) {
+        if (_enq.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (dif < 0) {
+        return false;                                   // llena
+      } else {
+        pos = _enq.load(std::memory_order_relaxed);
+      }
+    }
+    c->data = v;
+    c->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T& out) {
+    Cell* c;
+    size_t pos = _deq.load(std::memory_order_relaxed);
+    for (;;) {
+      c = &_cells[pos & (N - 1)];
+      const size_t seq = c->seq.load(std::memory_order_acquire);
+      const intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+      if (dif == 0) {
+        if (_deq.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (dif < 0) {
+        return false;                                   // vacía
+      } else {
+        pos = _deq.load(std::memory_order_relaxed);
+      }
+    }
+    out = c->data;
+    c->seq.store(pos + N, std::memory_order_release);
+    return true;
+  }
+
+  // Aproximado si hay productores/consumidores concurrentes
+  size_t size() const {
+    const size_t e = _enq.load(std::memory_order_relaxed);
+    const size_t d = _deq.load(std::memory_order_relaxed);
+    return e > d ? e - d : 0;
+  }
+  static constexpr size_t capacity() { return N; }
+
+private:
+  struct Cell {
+    std::atomic<size_t> seq;
+    T data;
+  };
+  Cell _cells[N];
+  std::atomic<size_t> _enq{0};
+  std::atomic<size_t> _deq{0};
+};
+
+// Qué hacer cuando la cola de una prioridad está llena
+enum class DropPolicy : uint8_t {
+  DropOldest,   // el productor descarta el evento más viejo de esa prioridad
+  DropNewest,   // se descarta el evento que se intenta publicar
+};
+
+// Bus de eventos con dos prioridades, cada una en su propia cola: los eventos
+// de baja prioridad nunca desplazan a los de alta. T necesita un campo
+// `uint32_t seq` creciente; next() entrega en orden de seq entre ambas colas
+// (el consumidor guarda la cabeza de cada cola). Un solo consumidor.
+template <typename T, size_t N>
+class EventBus {
+public:
+  enum Priority : uint8_t { LOW_PRIO = 0, HIGH_PRIO = 1 };
+
+  struct Stats {
+    uint32_t published[2];
+    uint32_t dropped[2];
+    size_t   queued;
+  };
+
+  EventBus(DropPolicy lowPolicy = DropPolicy::DropOldest,
+           DropPolicy highPolicy = DropPolicy::DropOldest)
+    : _policy{lowPolicy, highPolicy} {}
+
+  // Cualquier tarea. Devuelve false si el evento se descartó (DropNewest).
+  bool publish(const T& ev, Priority prio) {
+    MpmcRing<T, N>& q = _q[prio];
+    while (!q.push(ev)) {
+      if (_policy[prio] == DropPolicy::DropNewest) {
+        _dropped[prio].fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      T old;
+      if (q.pop(old)) _dropped[prio].fetch_add(1, std::memory_order_relaxed);
+    }
+    _published[prio].fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Sólo el consumidor: mira el próximo evento (menor seq) sin sacarlo.
+  const T* peek() {
+    for (int p = 0; p < 2; ++p)
+      if (!_hasHead[p]) _hasHead[p] = _q[p].pop(_head[p]);
+    if (_hasHead[0] && _hasHead[1]) _peeked = seqBefore(_head[1].seq, _head[0].seq) ? 1 : 0;
+    else if (_hasHead[1])            _peeked = 1;
+    else if (_hasHead[0])            _peeked = 0;
+    else                             return nullptr;
+    return &_head[_peeked];
+  }
+
+  // Sólo el consumidor: descarta el evento devuelto por el último peek()
+  // (no vuelve a mirar las colas: pudo llegar otro con seq menor).
+  void consume() {
+    if (_peeked >= 0) _hasHead[_peeked] = false;
+    _peeked = -1;
+  }
+
+  bool next(T& out) {
+    const T* h = peek();
+    if (!h) return false;
+    out = *h;
+    consume();
+    return true;
+  }
+
+  bool empty() { return peek() == nullptr; }
+
+  Stats stats() const {
+    Stats s;
+    for (int p = 0; p < 2; ++p) {
+      s.published[p] = _published[p].load(std::memory_order_relaxed);
+      s.dropped[p]   = _dropped[p].load(std::memory_order_relaxed);
+    }
+    s.queued = _q[0].size() + _q[1].size() + _hasHead[0] + _hasHead[1];
+    return s;
+  }
+
+private:
+  static bool seqBefore(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+
+  MpmcRing<T, N> _q[2];
+  DropPolicy _policy[2];
+  std::atomic<uint32_t> _published[2] = {{0}, {0}};
+  std::atomic<uint32_t> _dropped[2]   = {{0}, {0}};
+  T    _head[2];                  // cabeza retenida por el consumidor
+  bool _hasHead[2] = {false, false};
+  int8_t _peeked = -1;            // cabeza devuelta por el último peek()
+};
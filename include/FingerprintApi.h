@@ -1,16 +1,30 @@
 #pragma once
 #include <ESPAsyncWebServer.h>
+#include "MatchPolicy.h"
 
 void initFingerprintApi(AsyncWebServer& server, AsyncEventSource& events);
 
-// Encolan eventos (no envían inmediatamente)
-void fpApiEmitPrompt();
-void fpApiEmitResult(bool ok, int id, int score);
+// Encolan eventos (no envían inmediatamente). `req` = id de la petición de
+// ScanRequest, para que el cliente correlacione prompt/result con su pedido.
+// `reason` = veredicto de MatchPolicy ("reason" en el JSON si no es None).
+void fpApiEmitPrompt(uint32_t req);
+void fpApiEmitResult(bool ok, int id, int score, uint32_t req, PolicyReason reason = PolicyReason::None);
 void fpApiEmitEnrollStart();
 void fpApiEmitEnrollAbort();
 void fpApiEmitEnrollResult(bool ok, int id);
 void fpApiEmitEraseRequest(int id);
 void fpApiEmitEraseResult(bool ok, int id);
 
+// Contadores del bus de eventos (también en /fp/command?action=status)
+struct FpApiStats {
+  uint32_t queued;          // pendientes de envío
+  uint32_t published;       // aceptados desde el arranque
+  uint32_t dropped;         // descartados por cola llena (todas las prioridades)
+  uint32_t droppedResults;  // de ellos, resultados (prioridad alta)
+  uint32_t lastSeq;         // último id SSE asignado
+  uint32_t replayLen;       // eventos en el log de reenvío (Last-Event-ID)
+};
+FpApiStats fpApiStats();
+
 // Llamar periódicamente desde loop() para intentar enviar eventos pendientes
 void fpApiLoop();
\ No newline at end of file
@@ -2,34 +2,137 @@
 #include <Arduino.h>
 #include <HardwareSerial.h>
 #include <Adafruit_Fingerprint.h>
+#include "PollPolicy.h"
+#include "R305Link.h"
 
 struct MatchRes { bool ok; int id; int score; };
 
+// Detección de dedo por la salida touch/WAKEUP del sensor (R307/R503 y
+// clones). Con pin < 0 no hay línea y pollFinger() siempre consulta la UART.
+struct TouchStats {
+  uint32_t edges     = 0;   // flancos atendidos por la ISR
+  uint32_t uartPolls = 0;   // GenImg enviados por pollFinger()
+  uint32_t uartSaved = 0;   // GenImg evitados (estimado al ritmo del polling)
+};
+
 class FingerprintModel {
 public:
-  FingerprintModel(HardwareSerial& ser, int pinRx, int pinTx)
-  : _ser(ser), _finger(&ser), _pinRx(pinRx), _pinTx(pinTx) {}
+  FingerprintModel(HardwareSerial& ser, int pinRx, int pinTx,
+                   int pinTouch = -1, bool touchActiveHigh = true)
+  : _ser(ser), _finger(&ser), _link(ser), _pinRx(pinRx), _pinTx(pinTx),
+    _pinTouch(pinTouch), _touchActiveHigh(touchActiveHigh) {}
 
+  // Handshake (VfyPwd) primero con el último baud bueno guardado en NVS
+  // (namespace "fp", clave "baud") o `initialBaud`; si no responde, el resto.
   void begin(uint32_t initialBaud = 57600);
   uint32_t detectedBaud() const { return _detectedBaud; }
   bool ready() const { return _detectedBaud != 0; }
 
+  // Sube tamaño de paquete y baud del sensor (SetSysPara, quedan en su flash)
+  // hasta `maxPacket` / `maxBaud`. Cada cambio se verifica con verifyLink();
+  // si falla se prueba el escalón de abajo y, para el baud, se vuelve al que
+  // andaba. El baud queda en NVS ("fp"/"baud") y uno que falló en
+  // "fp"/"baudCap", que no se reintenta salvo con `retryFailed`. Lo que el
+  // sensor ya tiene no se reescribe. FINGERPRINT_OK si el enlace quedó sano,
+  // aunque sea por debajo del objetivo.
+  uint8_t negotiate(uint32_t maxBaud = 115200, uint16_t maxPacket = 256, bool retryFailed = false);
+  uint16_t packetSize() { return packetBytes(); }
+
+  // Espera dedo según la política de polling (ver PollPolicy.h), GenImg +
+  // Img2Tz en `buf` y espera que levante. Estadísticas en lastCapture().
   bool captureToBuffer(uint8_t buf, uint32_t timeoutMs,
                        void (*blinkCb)(bool) = nullptr);
+  // La lee la tarea que tiene la UART: cambiarla con la UART tomada
+  void setPollPolicy(const PollPolicy& p) { _poll = p; }
+  const PollPolicy& pollPolicy() const { return _poll; }
+  const PollStats& lastCapture() const { return _lastCapture; }
 
   bool enroll(uint16_t id, void (*blinkCb)(bool) = nullptr);
   MatchRes fastMatch(void (*blinkCb)(bool) = nullptr);
 
+  // Plantillas por usuario del enrol multi-posición (y del layout clásico
+  // id*5 que SlotMap migra)
+  static constexpr uint16_t SLOTS_PER_USER = 5;
+  // HiSpeedSearch (0x1B) de CharBuffer `buf` sólo en los slots [start, start+count).
+  // `page`/`score` valen con FINGERPRINT_OK; sin coincidencia: FINGERPRINT_NOTFOUND.
+  uint8_t searchRange(uint8_t buf, uint16_t start, uint16_t count, uint16_t& page, uint16_t& score);
+
+  // GenImg sólo si puede haber dedo: con línea touch espera el flanco (ISR) o
+  // el nivel activo, y cada FALLBACK_POLL_MS consulta igual por si la línea no
+  // está cableada. Sin dedo probable devuelve NOFINGER sin tocar la UART.
+  uint8_t pollFinger();
+  bool touchEnabled() const { return _pinTouch >= 0; }
+  const TouchStats& touchStats() const { return _touch; }
+
+  // Plantillas como bytes (respaldo / migración entre sensores). Usan
+  // CharBuffer1. Devuelven FINGERPRINT_*.
+  static constexpr uint16_t TEMPLATE_MAX = 512;     // un template R305 (2 char files)
+  // Bitmap de slots ocupados (ReadIndexTable, 256 por página): bit i%8 del byte i/8
+  uint8_t readIndex(uint8_t* bits, uint16_t capacity);
+  // slot -> CharBuffer1 (LoadChar) -> host (UpChar)
+  uint8_t readTemplate(uint16_t slot, uint8_t* out, uint16_t& len);
+  // host -> CharBuffer1 (DownChar) -> slot (Store)
+  uint8_t writeTemplate(uint16_t slot, const uint8_t* data, uint16_t len);
+  R305Link& link() { return _link; }
+
   const char* err(uint8_t code) const;
 
+  // La UART del sensor es de a uno. La toman el job en curso de SensorWorker,
+  // la inicialización (begin/negotiate), los comandos del CLI y pollFinger(),
+  // que no espera: con la UART tomada devuelve NOFINGER sin tocarla. Mutex
+  // recursivo: dentro de un job los métodos de acá pueden volver a tomarlo.
+  // Quien use chip() fuera de un job tiene que tenerla.
+  bool lockUart(TickType_t wait = portMAX_DELAY);
+  void unlockUart();
+  SemaphoreHandle_t uartLock() { lockInit(); return _uartLock; }
+
+  struct UartGuard {
+    explicit UartGuard(FingerprintModel& fp, TickType_t wait = portMAX_DELAY) : fp(fp), held(fp.lockUart(wait)) {}
+    ~UartGuard() { release(); }
+    void release() { if (held) { fp.unlockUart(); held = false; } }
+    explicit operator bool() const { return held; }
+    FingerprintModel& fp;
+    bool held;
+  };
+
   Adafruit_Fingerprint& chip() { return _finger; }
 
 private:
+  static constexpr uint32_t FALLBACK_POLL_MS = 1000;
+  static constexpr uint32_t HANDSHAKE_MS     = 100;   // VfyPwd responde en ~5 ms
+  static constexpr uint32_t SENSOR_BOOT_MS   = 600;   // R305 tarda ~200 ms (clones más) tras el encendido
+  static constexpr size_t   RX_BUFFER        = 1024;  // un paquete de 256 + cabecera no entra en los 256 por defecto
+  static constexpr uint8_t  VERIFY_ROUNDS    = 3;     // VfyPwd seguidos que tiene que pasar verifyLink()
+
+  void lockInit();
   bool tryAt(uint32_t b);
-  void autoDetect();
+  void autoDetect(uint32_t first);
+  uint8_t setSysPara(uint8_t reg, uint8_t value);
+  bool verifyLink(uint32_t baud, uint16_t packet);
+  bool switchBaud(uint32_t baud);
+  void attachTouch();
+  bool touchActive() const;
+  uint16_t waitLift();
+  static void IRAM_ATTR onTouchIsr(void* arg);
+
+  uint16_t packetBytes();
 
   HardwareSerial& _ser;
   Adafruit_Fingerprint _finger;
+  R305Link _link;
   int _pinRx, _pinTx;
   uint32_t _detectedBaud = 0;
+  SemaphoreHandle_t _uartLock = nullptr;
+
+  int  _pinTouch;
+  bool _touchActiveHigh;
+  volatile bool _touchFlag = false;     // lo levanta la ISR, lo consume pollFinger()
+  volatile uint32_t _touchEdges = 0;
+  unsigned long _lastPollMs = 0;        // último GenImg real
+  unsigned long _lastSavedMs = 0;       // último GenImg evitado contabilizado
+  uint32_t _pollCostMs = 45;            // duración medida de un GenImg sin dedo
+  TouchStats _touch;
+
+  PollPolicy _poll;
+  PollStats  _lastCapture;
 };
@@ -2,25 +2,32 @@
 #include <HardwareSerial.h>
 #include <Adafruit_Fingerprint.h>
 #include "Types.h"        // <- ahora existe en include/
-#include <OledUi.h>       // si OledUi se usa en headers/impl
 #include <Config.h>
+#include "PollPolicy.h"
 
 
 class FingerprintService {
 public:
   FingerprintService(HardwareSerial& serial, int pinRx, int pinTx);
   bool begin();
+  // En lugar de begin(): la UART ya la abrió y negoció FingerprintModel, no
+  // se reabre ni se busca el baud
+  void attach(uint32_t baud) { detectedBaud_ = baud; }
   uint32_t detectedBaud() const { return detectedBaud_; }
 
   String infoJson();
+  bool params(int& capacity, int& securityLevel);   // ReadSysPara
   int count();
   bool empty();
   bool remove(uint16_t id);
-  bool enroll(uint16_t id, String& err);     // bloqueante simple
-  FPMatch match();                           // bloqueante simple
+  bool enroll(uint16_t id, String& err);     // bloqueante simple; id = slot
+  FPMatch match();                           // bloqueante simple; 1:N en toda la base
+  bool captureTo(uint8_t bufNo);             // GetImage (PollPolicy) + Img2Tz
+
+  void setPollPolicy(const PollPolicy& p) { poll_ = p; }
+  const PollStats& lastCapture() const { return lastCapture_; }
 
 private:
-  bool captureTo(uint8_t bufNo);
   bool tryAt(uint32_t baud);
   void autoDetectBaud();
 
@@ -28,4 +35,6 @@ private:
   Adafruit_Fingerprint fp_;
   int rx_, tx_;
   uint32_t detectedBaud_ = 0;
+  PollPolicy poll_;
+  PollStats  lastCapture_;
 };
@@ -0,0 +1,11 @@
+#pragma once
+#include <ESPAsyncWebServer.h>
+#include "AccessJournal.h"
+
+// GET /fp/journal: registro de accesos en flash (ver AccessJournal.h), en
+// streaming. ?from=<seq>&limit=<n>&since=<unix>&until=<unix>&format=csv|ndjson.
+// Cabeceras X-Journal-Oldest / X-Journal-Newest con el rango disponible; para
+// paginar, pedir desde el último seq recibido + 1. ?stats=1 devuelve JSON con
+// el estado del anillo. Llamar antes de initFingerprintApi(): el handler de
+// /fp también atiende /fp/*.
+void initJournalApi(AsyncWebServer& server, AccessJournal& journal);
@@ -0,0 +1,101 @@
+#pragma once
+#include <Arduino.h>
+#include "Util.h"
+#include "FingerprintModel.h"
+#include "SlotMap.h"
+
+// Decide si un hit del sensor se acepta según su score (confidence).
+//
+// - score >= accept: se acepta con el hit solo.
+// - score < floor: se rechaza.
+// - en el medio (zona gris): se busca 1:1 el mismo CharBuffer contra los
+//   otros slots del usuario (un HiSpeedSearch de una página cada uno, ~13 ms)
+//   hasta que `agree` slots, contando el del hit, den score >= floor. Un
+//   impostor que roza una plantilla no coincide con las otras posiciones del
+//   dueño; un dedo legítimo mal apoyado sí. Nunca repite el 1:N completo.
+//
+// Reglas por texto, guardadas en NVS (namespace "policy", clave "rules"):
+//   "*:100/40/2,z1:120,u12:60/30/3,h22-6:150"
+//   ámbito:accept[/floor[/agree]]; lo que falta sale de la regla "*"
+//   ámbitos: "*" por defecto, "u<usuario>", "z<zona de SearchEngine>",
+//            "h<desde>-<hasta>" horas locales [desde, hasta), cruza medianoche
+// Gana la más específica: usuario > zona > horario > "*". Las reglas de
+// horario no aplican mientras SNTP no sincronizó la hora.
+//
+// decide() corre en la tarea del sensor; configure() y las estadísticas
+// pueden llamarse desde cualquier tarea.
+struct PolicyRule {
+  uint16_t accept;
+  uint16_t floor;
+  uint8_t  agree;        // slots que tienen que coincidir en la zona gris (1..MAX_PER_USER)
+};
+
+enum class PolicyReason : uint8_t {
+  None,          // sin veredicto: el sensor no encontró, error o sin política
+  Accept,        // score >= accept
+  Confirmed,     // zona gris, `agree` slots del usuario coincidieron
+  LowScore,      // score < floor
+  NoAgreement,   // zona gris sin suficientes slots que coincidan
+  COUNT
+};
+const char* policyReasonName(PolicyReason r);
+
+struct PolicyVerdict {
+  bool         accept;
+  PolicyReason reason;
+  uint8_t      agree;    // slots que coincidieron (incluye el del hit)
+  uint8_t      checks;   // búsquedas 1:1 extra
+};
+
+class MatchPolicy {
+public:
+  static constexpr uint8_t MAX_RULES = 16;
+  static constexpr size_t  SPEC_MAX  = 192;
+  static constexpr PolicyRule DEFAULT_RULE = {100, 40, 2};
+
+  MatchPolicy(FingerprintModel& fp, SlotMap& slots) : _fp(fp), _slots(slots) {}
+
+  // Carga las reglas de NVS
+  void begin();
+
+  // false (y no cambia nada) si no parsea. Reinicia estadísticas.
+  bool configure(const char* spec, bool persist = true);
+  void spec(char* out, size_t n);
+
+  // Regla efectiva; user/zone/hour < 0 = desconocido
+  PolicyRule ruleFor(int user, int zone, int hour);
+  // Hora local 0..23; -1 sin hora (SNTP no sincronizó)
+  static int localHour();
+
+  // Hit de `page` con `score` para las características de CharBuffer `buf`
+  // (zone = la de SearchEngine, -1 verify o base completa). Usa la UART.
+  PolicyVerdict decide(uint8_t buf, uint16_t page, uint16_t score, int zone);
+
+  // {"rules","accept","confirmed","low_score","no_agreement","checks","checkAvgMs"}
+  // y con `user`/`zone`/`hour` >= -1 la regla efectiva. 0 si no entra en `n`.
+  size_t statsJson(char* out, size_t n, bool effective = false, int user = -1, int zone = -1, int hour = -1);
+  void resetStats();
+
+private:
+  enum class Scope : uint8_t { Default, User, Zone, Hours };
+  struct Rule {
+    Scope    scope;
+    uint16_t a, b;         // usuario / zona / horas [a, b)
+    uint16_t accept;
+    int32_t  floor;        // -1 = el de "*"
+    int16_t  agree;        // -1 = el de "*"
+  };
+  static bool parse(const char* s, Rule* out, uint8_t& n);
+  void lockInit();
+
+  FingerprintModel& _fp;
+  SlotMap&          _slots;
+  SemaphoreHandle_t _lock = nullptr;
+
+  Rule    _rules[MAX_RULES];
+  uint8_t _ruleCount = 0;
+  char    _spec[SPEC_MAX] = "";
+
+  uint32_t _reasons[(uint8_t)PolicyReason::COUNT] = {};
+  uint32_t _checks = 0, _checkMs = 0;
+};
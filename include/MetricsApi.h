@@ -0,0 +1,9 @@
+#pragma once
+#include <ESPAsyncWebServer.h>
+#include "SensorWorker.h"
+
+// GET /fp/metrics: ScanMetrics en formato de texto Prometheus, más la cola
+// del sensor y el bus de eventos SSE. ?reset=1 reinicia histogramas y
+// contadores de scan después de responder. Llamar antes de
+// initFingerprintApi(): el handler de /fp también atiende /fp/*.
+void initMetricsApi(AsyncWebServer& server, SensorWorker& worker);
@@ -0,0 +1,8 @@
+#pragma once
+#include <ESPAsyncWebServer.h>
+#include "NamesModel.h"
+
+// GET/POST /fp/users: exportar/importar el directorio de nombres en CSV o
+// NDJSON, en streaming (ver NamesCodec.h). Llamar antes de
+// initFingerprintApi(): el handler de /fp también atiende /fp/*.
+void initNamesApi(AsyncWebServer& server, NamesModel& names);
@@ -0,0 +1,67 @@
+#pragma once
+#include <Arduino.h>
+#include "NamesModel.h"
+
+// Importación/exportación del directorio de nombres en CSV (`id,nombre`) o
+// NDJSON (`{"id":N,"name":"..."}` por línea), de a pedazos y con memoria
+// constante: ni el parser ni el generador guardan más de una línea.
+
+enum class NamesFormat : uint8_t { Csv, Ndjson };
+
+// Parser incremental: feed() con cada pedazo del cuerpo, finish() al final
+// (procesa la última línea sin '\n'). Cada nombre que cambia es una escritura
+// NVS; los que ya estaban iguales no tocan la flash.
+// Trivialmente destruible: /fp/users lo guarda en _tempObject del request,
+// que la librería libera con free().
+class NamesImporter {
+public:
+  static constexpr size_t LINE_MAX = 256;
+
+  void begin(NamesModel& names, NamesFormat fmt);
+  void feed(const uint8_t* data, size_t len);
+  void finish();
+  // Cuerpo cortado (cliente desconectado): descarta la línea a medias
+  void abort();
+  bool active() const { return _active; }
+
+  NamesFormat format() const { return _fmt; }
+  uint16_t imported() const { return _imported; }
+  uint16_t errors() const { return _errors; }
+  uint32_t lines() const { return _lines; }
+  uint32_t firstErrorLine() const { return _firstError; }
+
+private:
+  void line();
+
+  NamesModel* _names = nullptr;
+  NamesFormat _fmt = NamesFormat::Csv;
+  char     _buf[LINE_MAX];
+  size_t   _len = 0;
+  bool     _overflow = false;
+  bool     _active = false;      // entre begin() y finish()/abort()
+  uint16_t _imported = 0;
+  uint16_t _errors = 0;
+  uint32_t _lines = 0;
+  uint32_t _firstError = 0;
+};
+
+// Generador para respuestas chunked: fill() escribe hasta maxLen bytes y
+// devuelve 0 al terminar. Una línea que no entra sigue en el próximo fill().
+class NamesExporter {
+public:
+  NamesExporter(NamesModel& names, NamesFormat fmt) : _names(names), _fmt(fmt) {}
+  size_t fill(uint8_t* out, size_t maxLen);
+
+private:
+  NamesModel& _names;
+  NamesFormat _fmt;
+  uint16_t _nextId = 0;
+  bool     _header = true;       // CSV: "id,name"
+  char     _line[NamesImporter::LINE_MAX];
+  size_t   _lineLen = 0, _lineOff = 0;
+};
+
+// Una línea (sin '\n'). false si no es válida.
+bool parseNameLine(NamesFormat fmt, const char* line, uint16_t& id, char* name, size_t n);
+// Escribe la línea con '\n'; devuelve su longitud.
+size_t formatNameLine(NamesFormat fmt, uint16_t id, const char* name, char* out, size_t n);
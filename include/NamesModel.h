@@ -1,18 +1,68 @@
 #pragma once
 #include <Arduino.h>
 #include <Preferences.h>
+#include <nvs.h>
+#include "Types.h"
 
+#ifndef FP_NAMES_ARENA
+  #define FP_NAMES_ARENA 16384      // bytes de RAM para los nombres (~1000 de 12 letras)
+#endif
+
+// Directorio id -> nombre. Los nombres viven en NVS (namespace "users", claves
+// "id%03u") y se cargan una sola vez en begin() a una arena en RAM; set()
+// escribe en ambos. get() es O(1) y no asigna memoria.
+//
+// Registro en la arena: [id:2][len:1][len bytes]['\0']. Un nombre reemplazado
+// queda muerto hasta que la arena se llena y se compacta. Si aun compactada no
+// entra, el id queda "derramado" y get() lo lee de NVS.
+//
+// set()/copy()/next() toman un mutex: la importación por HTTP escribe desde la
+// tarea AsyncTCP. get() no lo toma y compactar mueve los punteros que devuelve:
+// usarlo sólo si ninguna otra tarea escribe; si no, copy().
 class NamesModel {
 public:
-  bool begin() { return _prefs.begin("users", false); }
-  String get(uint16_t id) {
-    char key[8]; snprintf(key, sizeof(key), "id%03u", id);
-    return _prefs.getString(key, "");
-  }
-  void set(uint16_t id, const String& name) {
-    char key[8]; snprintf(key, sizeof(key), "id%03u", id);
-    _prefs.putString(key, name);
-  }
+  static constexpr uint16_t MAX_ID   = FP_MAX_USERS;   // ids 0..MAX_ID-1
+  static constexpr size_t   NAME_MAX = 31;     // se trunca al guardar
+
+  bool begin();
+
+  // "" si el id no tiene nombre. Válido hasta el próximo set()/begin() (un id
+  // derramado se lee a un buffer interno: hasta el próximo get()).
+  const char* get(uint16_t id);
+  // Copia el nombre a `out` (con lock). false si el id no tiene nombre.
+  bool copy(uint16_t id, char* out, size_t n);
+  // Primer id >= from con nombre (copiado a `out`); MAX_ID si no hay más.
+  uint16_t next(uint16_t from, char* out, size_t n);
+  // Nombre vacío = borrar. Se trunca a NAME_MAX sin cortar un carácter UTF-8.
+  bool set(uint16_t id, const char* name);
+  bool set(uint16_t id, const String& name) { return set(id, name.c_str()); }
+
+  uint16_t count() const { return _count; }
+  uint16_t spilled() const { return _spilled; }    // ids que no entraron en la arena
+  size_t arenaUsed() const { return _used; }
+  size_t arenaLive() const { return _live; }
+
 private:
+  static constexpr uint16_t NONE  = 0xFFFF;
+  static constexpr uint16_t SPILL = 0xFFFE;
+  static constexpr size_t   HDR   = 3;
+  static_assert(FP_NAMES_ARENA < SPILL, "offsets de 16 bits");
+
+  static void keyFor(uint16_t id, char (&key)[8]) { snprintf(key, sizeof(key), "id%03u", id); }
+  void loadAll();
+  const char* lookup(uint16_t id);
+  bool store(uint16_t id, const char* name, size_t len);
+  void drop(uint16_t id);
+  void compact();
+
   Preferences _prefs;
+  SemaphoreHandle_t _lock = nullptr;
+
+  uint16_t _off[MAX_ID];
+  char     _arena[FP_NAMES_ARENA];
+  size_t   _used = 0;          // bytes ocupados (incluye registros muertos)
+  size_t   _live = 0;          // bytes de registros vigentes
+  uint16_t _count = 0;
+  uint16_t _spilled = 0;
+  char     _scratch[NAME_MAX + 1];   // lectura de ids derramados
 };
@@ -0,0 +1,10 @@
+#pragma once
+#include <ESPAsyncWebServer.h>
+#include "MatchPolicy.h"
+
+// GET /fp/policy: reglas de MatchPolicy y veredictos por motivo. Con
+// ?rules=.. las cambia (se guardan en NVS y reinician las estadísticas; 400
+// si no parsean); ?reset=1 sólo reinicia estadísticas. Con ?user=..&zone=..
+// &hour=.. (cualquiera) agrega la regla efectiva para ese caso ("effective").
+// Llamar antes de initFingerprintApi(): el handler de /fp también atiende /fp/*.
+void initPolicyApi(AsyncWebServer& server, MatchPolicy& policy);
@@ -0,0 +1,62 @@
+#pragma once
+#include <Arduino.h>
+
+// Política de polling del sensor mientras se espera un dedo (GenImg).
+// Intervalo fijo `fastMs` justo después del prompt, durante `fastWindowMs`;
+// después backoff exponencial (x2) hasta `maxMs`, siempre acotado por el
+// timeout de la captura. Se ajusta por sitio con build_flags (-DFP_POLL_...)
+// o en runtime con setPollPolicy().
+#ifndef FP_POLL_FAST_MS
+  #define FP_POLL_FAST_MS 20
+#endif
+#ifndef FP_POLL_FAST_WINDOW_MS
+  #define FP_POLL_FAST_WINDOW_MS 2000
+#endif
+#ifndef FP_POLL_MAX_MS
+  #define FP_POLL_MAX_MS 160
+#endif
+#ifndef FP_POLL_LIFT_MS
+  #define FP_POLL_LIFT_MS 40
+#endif
+#ifndef FP_POLL_LIFT_TIMEOUT_MS
+  #define FP_POLL_LIFT_TIMEOUT_MS 1500
+#endif
+
+struct PollPolicy {
+  uint16_t fastMs        = FP_POLL_FAST_MS;
+  uint16_t fastWindowMs  = FP_POLL_FAST_WINDOW_MS;
+  uint16_t maxMs         = FP_POLL_MAX_MS;
+  uint16_t liftMs        = FP_POLL_LIFT_MS;          // esperando que levante el dedo
+  uint16_t liftTimeoutMs = FP_POLL_LIFT_TIMEOUT_MS;
+};
+
+// Resultado de la última captura (para ajustar la política en cada sitio)
+struct PollStats {
+  uint16_t polls        = 0;     // GenImg hasta tener imagen (incluye el OK)
+  uint16_t liftPolls    = 0;     // GenImg esperando que levante (antes y después)
+  uint32_t firstImageMs = 0;     // prompt -> imagen OK (0 = no hubo)
+  bool     timedOut     = false;
+};
+
+// Reloj de un bucle de polling: next() duerme hasta el próximo intento y
+// devuelve false cuando se venció el plazo.
+class PollScheduler {
+public:
+  PollScheduler(uint16_t fastMs, uint16_t fastWindowMs, uint16_t maxMs, uint32_t timeoutMs)
+    : _t0(millis()), _interval(fastMs ? fastMs : 1), _fastWindowMs(fastWindowMs),
+      _maxMs(max<uint32_t>(maxMs, _interval)), _timeoutMs(timeoutMs) {}
+
+  bool next() {
+    const uint32_t el = elapsedMs();
+    if (el >= _timeoutMs) return false;
+    const uint32_t wait = min(_interval, _timeoutMs - el);
+    if (el >= _fastWindowMs) _interval = min<uint32_t>(_interval * 2, _maxMs);
+    delay(wait);
+    return true;
+  }
+
+  uint32_t elapsedMs() const { return millis() - _t0; }
+
+private:
+  uint32_t _t0, _interval, _fastWindowMs, _maxMs, _timeoutMs;
+};
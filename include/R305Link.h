@@ -0,0 +1,36 @@
+#pragma once
+#include <Arduino.h>
+
+// Capa de paquetes del protocolo R305 sobre la UART, para lo que
+// Adafruit_Fingerprint no cubre: paquetes de datos (UpChar/DownChar) de
+// cualquier tamaño (la librería corta en 64 bytes) y comandos sin método
+// propio (ReadIndexTable, DownChar).
+//
+// Paquete: EF 01 | dirección:4 | pid:1 | largo:2 (datos + 2) | datos | suma:2
+class R305Link {
+public:
+  static constexpr uint8_t PID_COMMAND = 0x01;
+  static constexpr uint8_t PID_DATA    = 0x02;
+  static constexpr uint8_t PID_ACK     = 0x07;
+  static constexpr uint8_t PID_END     = 0x08;
+
+  explicit R305Link(Stream& s, uint32_t address = 0xFFFFFFFF) : _s(s), _addr(address) {}
+
+  void writePacket(uint8_t pid, const uint8_t* data, uint16_t len);
+  // false en timeout, cabecera inválida, datos > cap o suma incorrecta.
+  bool readPacket(uint8_t& pid, uint8_t* data, uint16_t cap, uint16_t& len, uint32_t timeoutMs);
+
+  // Envía un comando y espera su ACK. Devuelve el código de confirmación
+  // (FINGERPRINT_*) y copia el resto del ACK a `reply` (si no es nullptr).
+  uint8_t command(const uint8_t* cmd, uint16_t n, uint8_t* reply = nullptr, uint16_t cap = 0,
+                  uint16_t* replyLen = nullptr, uint32_t timeoutMs = 1000);
+
+  uint32_t badPackets() const { return _bad; }
+
+private:
+  int readByte(unsigned long deadline);
+
+  Stream&  _s;
+  uint32_t _addr;
+  uint32_t _bad = 0;
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// Latencias del pipeline de scan en µs (esp_timer) sobre histogramas de
+// buckets fijos, más contadores de resultados. Registran loop(), la tarea del
+// sensor y los handlers HTTP; se leen como texto Prometheus (GET /fp/metrics)
+// o con el comando serie `metrics`.
+//
+// Etapas:
+//   finger_wait  requestScan/requestVerify -> dedo detectado (pollFinger)
+//   queue        submit del job -> empieza en la tarea del sensor
+//   get_image    GenImg
+//   image2tz     Img2Tz
+//   search       HiSpeedSearch (1:N por zonas o verify 1:1)
+//   job          job completo en la tarea del sensor
+//   deliver      requestScan -> resultado entregado (SSE, relé), sin minScanMs
+//   result       dedo detectado -> resultado en pantalla (incluye minScanMs)
+//   total        requestScan -> resultado en pantalla
+enum class MetricStage : uint8_t {
+  FingerWait, Queue, GetImage, Image2Tz, Search, Job, Deliver, Result, Total, COUNT
+};
+
+enum class MetricCounter : uint8_t {
+  Requests,         // requestScan / requestVerify encolados
+  Match,            // resultado ok
+  NoMatch,          // sin coincidencia (NOTFOUND)
+  SensorError,      // otro código del sensor (imagen, UART...)
+  MatchTimeout,     // el job no terminó antes de matchingDeadline
+  RequestExpired,   // la petición venció sin dedo
+  QueueDrop,        // cola de SensorWorker o de peticiones (ScanRequest) llena
+  CaptureRetry,     // recaptura dentro del job (IMAGEMESS/FEATUREFAIL o NOTFOUND)
+  RetryRecovered,   // match después de al menos una recaptura
+  COUNT
+};
+
+// Modo de AutoMode que atendió a la persona (throughput por modo)
+enum class MetricMode : uint8_t { Interactive, FreeRun, COUNT };
+
+// Crea el mutex; llamar en setup() antes de arrancar las tareas
+void fpMetricsBegin();
+
+inline int64_t fpMetricsNow() { return esp_timer_get_time(); }
+void fpMetricsRecord(MetricStage stage, uint32_t us);
+// Tiempo desde `t0Us` (fpMetricsNow()); t0Us = 0 no registra
+inline void fpMetricsSince(MetricStage stage, int64_t t0Us) {
+  if (t0Us) fpMetricsRecord(stage, (uint32_t)(esp_timer_get_time() - t0Us));
+}
+void fpMetricsCount(MetricCounter c);
+
+// Cuantil estimado interpolando dentro del bucket (como histogram_quantile
+// de Prometheus). 0 sin muestras.
+uint32_t fpMetricsQuantileUs(MetricStage stage, float q);
+uint32_t fpMetricsSamples(MetricStage stage);
+
+// Throughput: una persona atendida (resultado en pantalla, ok o no).
+// Personas/min sobre las últimas PEOPLE_WINDOW de los últimos 5 min, entre
+// la primera y la última (ritmo mientras hay fila, sin contar el tiempo
+// ocioso); 0 con menos de 2.
+static constexpr uint8_t PEOPLE_WINDOW = 32;
+void fpMetricsPerson(MetricMode mode);
+float fpMetricsPeoplePerMin(MetricMode mode);
+uint32_t fpMetricsPeople(MetricMode mode);
+void fpMetricsReset();
+
+// fp_stage_seconds (histogram, label stage), fp_scans_total (label result),
+// fp_people_total y fp_people_per_minute (label mode)
+void fpMetricsPrometheus(Print& out);
+// Tabla para el CLI: n, p50, p99 y máximo por etapa, contadores y personas/min
+void fpMetricsPrint(Print& out);
@@ -1,12 +1,46 @@
 #pragma once
 #include <Arduino.h>
 
-// Solicita modo escaneo: muestra "Ponga su huella" y espera el dedo.
-// timeoutMs = 0 => sin timeout (se puede cancelar manualmente con cancelScan)
-void requestScan(unsigned long timeoutMs = 15000);
+// Cola de peticiones de scan. Cualquier tarea encola (serie, handlers HTTP)
+// sin locks; AutoMode (loop) las atiende en orden, una a la vez. Cada
+// petición lleva id (correlación: vuelve en el event SSE "result"), origen,
+// modo y vencimiento propio: una petición que vence esperando en la cola se
+// descarta sin ocupar el sensor (contador request_expired).
+enum class ScanOrigin : uint8_t { Serial, Http, Remote };
+enum class ScanMode : uint8_t { Identify, Verify };
 
-// Cancela la petición de escaneo
-void cancelScan();
+struct ScanTicket {
+  uint32_t      id;            // 1.. creciente; 0 = ninguna
+  ScanOrigin    origin;
+  ScanMode      mode;
+  int           claimed;       // verify 1:1: usuario declarado; -1 = 1:N
+  unsigned long deadline;      // millis() de vencimiento; 0 = sin timeout
+  int64_t       requestedUs;   // esp_timer al encolar (ScanMetrics)
+};
+
+static constexpr size_t SCAN_QUEUE_LEN = 8;   // peticiones en espera (potencia de 2)
+
+// Encola un scan 1:N. timeoutMs = 0 => sin timeout (hasta cancelScan).
+// Devuelve el id de la petición; 0 si la cola está llena.
+uint32_t requestScan(unsigned long timeoutMs = 15000, ScanOrigin origin = ScanOrigin::Serial);
 
-// Consultar si está activo el modo "esperando dedo"
-bool isScanRequested();
\ No newline at end of file
+// Igual que requestScan pero 1:1 (badge + dedo): el dedo se compara sólo
+// contra los slots del usuario declarado.
+uint32_t requestVerify(uint16_t userId, unsigned long timeoutMs = 15000,
+                       ScanOrigin origin = ScanOrigin::Serial);
+
+// Peticiones en espera (sin contar la activa); aproximado con productores concurrentes
+size_t scanQueueDepth();
+
+// ---- Sólo loop() (AutoMode / CLI): la petición activa
+// ¿Hay petición activa sin vencer? Si no hay, toma la próxima de la cola
+// (descartando las vencidas).
+bool isScanRequested();
+// Id de la petición activa; 0 = ninguna
+uint32_t activeRequestId();
+// Usuario declarado de la petición activa; -1 = identificación 1:N
+int claimedUser();
+// esp_timer_get_time() de la petición activa; 0 = ninguna
+int64_t scanRequestedAtUs();
+// Termina la petición activa (atendida o cancelada); las encoladas siguen
+void cancelScan();
@@ -0,0 +1,9 @@
+#pragma once
+#include <ESPAsyncWebServer.h>
+#include "SearchEngine.h"
+
+// GET /fp/search: zonas, orden de búsqueda y estadísticas por zona (ver
+// SearchEngine.h). Con ?zones=..&order=.. cambia la configuración (se guarda
+// en NVS y reinicia las estadísticas); ?reset=1 sólo reinicia estadísticas.
+// Llamar antes de initFingerprintApi(): el handler de /fp también atiende /fp/*.
+void initSearchApi(AsyncWebServer& server, SearchEngine& engine);
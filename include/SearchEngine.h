@@ -0,0 +1,77 @@
+#pragma once
+#include <Arduino.h>
+#include "Util.h"
+#include "FingerprintModel.h"
+
+// Búsqueda 1:N por rangos de slots (zonas). Cada equipo tiene un mapa
+// zona -> rango y una lista ordenada de zonas a probar: primero la propia
+// (la puerta), después los fallbacks. Un HiSpeedSearch por zona hasta la
+// primera coincidencia.
+//
+// Configuración por texto, guardada en NVS (namespace "search"):
+//   zonas  "0-199,200-499,500-999"   zona i = i-ésimo rango (slots inclusive)
+//   orden  "1,0"                     zonas a recorrer; vacío = todas en orden
+// Sin zonas se busca toda la base (0..capacidad), no sólo las 164 páginas
+// que recorre fingerFastSearch().
+//
+// search() corre en la tarea del sensor; configure() y las estadísticas
+// pueden llamarse desde cualquier tarea.
+struct SearchRange {
+  uint16_t start = 0;
+  uint16_t count = 0;
+};
+
+// Por zona. `searches` cuenta las veces que se buscó en ella (llegar a una
+// zona de fallback implica haber fallado en las anteriores).
+struct SearchStats {
+  uint32_t searches = 0;
+  uint32_t hits     = 0;
+  uint32_t totalMs  = 0;
+  uint32_t maxMs    = 0;
+};
+
+class SearchEngine {
+public:
+  static constexpr uint8_t  MAX_ZONES = 8;
+  static constexpr uint16_t DEFAULT_CAPACITY = 1000;   // si ReadSysPara no respondió
+  static constexpr size_t   SPEC_MAX = 96;
+
+  explicit SearchEngine(FingerprintModel& fp) : _fp(fp) {}
+
+  // Carga la configuración de NVS
+  void begin();
+
+  // false (y no cambia nada) si alguna lista no parsea. Reinicia estadísticas.
+  bool configure(const char* zones, const char* order, bool persist = true);
+
+  // Busca CharBuffer `buf`. Con FINGERPRINT_OK: `page`, `score` y la zona
+  // (-1 = base completa). Un error distinto de NOTFOUND corta el recorrido.
+  uint8_t search(uint8_t buf, uint16_t& page, uint16_t& score, int& zone);
+
+  // {"capacity","zones":[{zone,start,count,searches,hits,hitRate,avgMs,maxMs}],
+  //  "order":[...],"searches","misses","avgMs"}. 0 si no entra en `n`.
+  size_t statsJson(char* out, size_t n);
+  void resetStats();
+
+  // Configuración actual en el formato de configure()
+  void zonesSpec(char* out, size_t n);
+  void orderSpec(char* out, size_t n);
+
+private:
+  static bool parseZones(const char* s, SearchRange* out, uint8_t& n);
+  static bool parseOrder(const char* s, uint8_t zones, uint8_t* out, uint8_t& n);
+  void lockInit();
+  uint16_t capacity();
+
+  FingerprintModel& _fp;
+  SemaphoreHandle_t _lock = nullptr;
+
+  SearchRange _zones[MAX_ZONES];
+  uint8_t     _zoneCount = 0;
+  uint8_t     _order[MAX_ZONES];
+  uint8_t     _orderCount = 0;          // 0 = todas las zonas en orden
+
+  SearchStats _stats[MAX_ZONES + 1];    // [MAX_ZONES] = base completa (sin zonas)
+  uint32_t    _searches = 0, _misses = 0, _totalMs = 0;
+  uint16_t    _capacity = 0;            // base completa, la fija search()
+};
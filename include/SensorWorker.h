@@ -0,0 +1,56 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// Resultado de un trabajo del sensor (lo completa la función del job).
+struct SensorResult {
+  uint32_t seq   = 0;     // número de job que lo produjo
+  uint8_t  rc    = 0;     // último código FINGERPRINT_* relevante
+  bool     ok    = false;
+  int      id    = -1;
+  int      score = 0;
+};
+
+typedef void (*SensorJobFn)(void* ctx, SensorResult& out);
+typedef void (*SensorDoneFn)(void* ctx, const SensorResult& res);
+
+struct SensorJob {
+  uint32_t     seq;
+  SensorJobFn  run;    // corre en la tarea del sensor, con la UART tomada
+  SensorDoneFn done;   // aviso de completado, también en la tarea del sensor
+  void*        ctx;
+};
+
+// Tarea única y persistente que ejecuta los trabajos del R305 en orden.
+// Se crea una vez (cola + stack fijos), así cada scan no paga la creación de
+// una tarea ni fragmenta el heap.
+//
+// begin(false) no crea la tarea: modo cooperativo, el llamador ejecuta pump()
+// desde su propio loop (lo usa el benchmark `native`).
+//
+// Con `uartLock` (FingerprintModel::uartLock()) cada job corre con la UART
+// tomada: ni el polling de AutoMode ni el CLI se intercalan en sus paquetes.
+class SensorWorker {
+public:
+  bool begin(bool spawnTask = true, UBaseType_t queueLen = 4, SemaphoreHandle_t uartLock = nullptr);
+
+  // Encola un trabajo. Devuelve su número de secuencia o 0 si la cola está llena.
+  uint32_t submit(SensorJobFn run, SensorDoneFn done, void* ctx);
+
+  // Ejecuta a lo sumo un trabajo; espera hasta `wait` ticks si la cola está vacía.
+  bool pump(TickType_t wait = 0);
+
+  uint32_t completed() const { return _completed.load(std::memory_order_relaxed); }
+  uint32_t rejected() const  { return _rejected.load(std::memory_order_relaxed); }
+  UBaseType_t pending() const { return _queue ? uxQueueMessagesWaiting(_queue) : 0; }
+
+private:
+  static void taskEntry(void* arg);
+
+  QueueHandle_t _queue = nullptr;
+  SemaphoreHandle_t _uartLock = nullptr;
+  TaskHandle_t  _task  = nullptr;
+  std::atomic<uint32_t> _seq{0};
+  std::atomic<uint32_t> _completed{0};
+  std::atomic<uint32_t> _rejected{0};
+};
@@ -4,6 +4,10 @@
 #include "DisplayModel.h"
 #include "FingerprintModel.h"
 #include "NamesModel.h"
+#include "SearchEngine.h"
+#include "SlotMap.h"
+#include "MatchPolicy.h"
+#include "ScanMetrics.h"
 
 #ifndef MAX_ENROLL_ATTEMPTS
   #define MAX_ENROLL_ATTEMPTS 5
@@ -22,12 +26,8 @@ namespace {
     d.clearDisplay();
     const int xOffset = 32; // desplazar 32 píxeles a la derecha
     const int yOffset = 0;
-  #if FP_BITMAP_IS_XBM
-    d.drawXBitmap(xOffset, yOffset, icon, ICON_W, ICON_H, SH110X_WHITE);
-  #else
-    d.drawBitmap(xOffset, yOffset, icon, ICON_W, ICON_H, SH110X_WHITE);
-  #endif
-    d.display();
+    display.drawImage(xOffset, yOffset, icon, ICON_W, ICON_H);
+    display.flush();
   }
 }
 
@@ -47,17 +47,37 @@ static inline String readLineWithTimeout(uint32_t ms) {
   s.trim(); return s;
 }
 
+// Los comandos que usan el sensor corren en loop(), fuera de SensorWorker:
+// toman la UART (FingerprintModel::UartGuard) y esperan a lo sumo esto a que
+// el job en curso la suelte (una exportación de plantillas tarda minutos).
+static const TickType_t CLI_UART_WAIT = pdMS_TO_TICKS(2000);
+
+static inline bool cliUartReady(const FingerprintModel::UartGuard& g) {
+  if (!g) Serial.println("Sensor ocupado (scan o transferencia en curso), reintentá");
+  return (bool)g;
+}
+
 static inline void printHelp() {
   Serial.println();
   Serial.println(F("Comandos:"));
-  Serial.println(F("  e <id>           Enrolar en ID (0..999)"));
-  Serial.println(F("    (nuevo) guarda 5 posiciones por ID: center, top, bottom, left, right"));
+  Serial.println(F("  e <id> [n]       Enrolar usuario ID con n plantillas (def. 5)"));
+  Serial.println(F("    posiciones: center, top, bottom, left, right; slots libres de SlotMap"));
   Serial.println(F("  s                Match 1:N manual"));
-  Serial.println(F("  d <id>           Borrar ID"));
+  Serial.println(F("  v <id>           Verify 1:1 contra los slots del usuario"));
+  Serial.println(F("  d <slot>         Borrar plantilla (slot)"));
+  Serial.println(F("  du <id>          Borrar todas las plantillas del usuario"));
+  Serial.println(F("  slots / compact  Ocupación de la base / compactar (usuarios contiguos)"));
+  Serial.println(F("  zones [r [o]]    Zonas de búsqueda 1:N (ej. zones 0-199,200-999 1,0) y estadísticas"));
+  Serial.println(F("  policy [reglas]  Umbrales de score (ej. policy *:100/40/2,u12:60,h22-6:150) y veredictos"));
   Serial.println(F("  c                Contar plantillas"));
   Serial.println(F("  x                Vaciar base"));
   Serial.println(F("  i                Info (ReadSysPara)"));
+  Serial.println(F("  link [b [p]]     Negociar baud (máx. b) y paquete (máx. p bytes) con el sensor"));
+  Serial.println(F("  metrics [reset]  Latencias por etapa del scan (p50/p99) y contadores"));
   Serial.println(F("  n <id> <nombre>  Setear nombre para ID"));
+  Serial.println(F("  poll [f w m]     Ver/ajustar polling de captura (fast ms, ventana ms, max ms)"));
+  Serial.println(F("  timing [m r p]   Ver/ajustar animación mínima, resultado en pantalla y pulso del relé (ms)"));
+  Serial.println(F("  mode [i|f]       Modo interactivo (por petición) o free-run (continuo), personas/min"));
   Serial.println(F("  ok / err / panel Pruebas de UI"));
   Serial.println(F("  anim             Animar 5s las 4 huellas"));
   Serial.println();
@@ -68,16 +88,32 @@ inline void handleSerialCommand(
   DisplayModel& display,        // <- se usa adentro
   FingerprintModel& fpModel,
   NamesModel& names,
-  AutoMode& autoMode
+  AutoMode& autoMode,
+  SearchEngine& search,
+  SlotMap& slots,
+  MatchPolicy& policy
 ) {
   if (line == "s") {
     // solicitar scan (misma acción que API) -> comportamiento idéntico
-    Serial.println("Solicitud scan -> esperando dedo...");
-    requestScan(15000); // mismo comportamiento que el API
+    const uint32_t id = requestScan(15000); // mismo comportamiento que el API
+    if (id) Serial.printf("Solicitud scan #%u -> esperando dedo (%u en cola)\n", (unsigned)id, (unsigned)scanQueueDepth());
+    else Serial.println("Cola de scans llena");
+    return;
+  }
+
+  if (line.startsWith("v ")) {
+    // verify 1:1 (badge + dedo): sólo los slots del usuario indicado
+    const long id = line.substring(2).toInt();
+    if (id < 0 || id > SlotMap::MAX_USER) { Serial.printf("Uso: v <0..%u>\n", SlotMap::MAX_USER); return; }
+    const uint32_t req = requestVerify((uint16_t)id, 15000);
+    if (req) Serial.printf("Solicitud verify #%u user=%ld -> esperando dedo...\n", (unsigned)req, id);
+    else Serial.println("Cola de scans llena");
     return;
   }
 
   if (line == "c") {
+    FingerprintModel::UartGuard uart(fpModel, CLI_UART_WAIT);
+    if (!cliUartReady(uart)) return;
     if (fpModel.chip().getTemplateCount() == FINGERPRINT_OK)
       Serial.println(fpModel.chip().templateCount);
     else
@@ -86,53 +122,201 @@ inline void handleSerialCommand(
   }
 
   if (line == "x") {
-    Serial.println(fpModel.chip().emptyDatabase() == FINGERPRINT_OK ? "OK" : "ERR");
+    FingerprintModel::UartGuard uart(fpModel, CLI_UART_WAIT);
+    if (!cliUartReady(uart)) return;
+    const bool ok = fpModel.chip().emptyDatabase() == FINGERPRINT_OK;
+    if (ok) slots.clear();
+    Serial.println(ok ? "OK" : "ERR");
     return;
   }
 
   if (line == "i") {
+    FingerprintModel::UartGuard uart(fpModel, CLI_UART_WAIT);
+    if (!cliUartReady(uart)) return;
     if (fpModel.chip().getParameters() == FINGERPRINT_OK) {
       Serial.print("capacity=");    Serial.println(fpModel.chip().capacity);
       Serial.print("security=");    Serial.println(fpModel.chip().security_level);
       Serial.print("system_id=0x"); Serial.println(fpModel.chip().system_id, HEX);
-      Serial.print("baud=");        Serial.println(fpModel.chip().baud_rate);
+      Serial.print("baud=");        Serial.println(fpModel.detectedBaud());   // baud_rate es uint16_t
       Serial.print("packet_len=");  Serial.println(fpModel.chip().packet_len);
     } else Serial.println("getParameters FAIL");
     return;
   }
 
+  if (line == "metrics" || line == "metrics reset") {
+    fpMetricsPrint(Serial);
+    if (line.length() > 7) { fpMetricsReset(); Serial.println("reset"); }
+    return;
+  }
+
+  if (line == "link" || line.startsWith("link ")) {
+    // link [baud [paquete]]: con argumentos reintenta también un baud que falló antes
+    uint32_t baud = 115200;
+    uint16_t pkt = 256;
+    const bool retry = line.length() > 5;
+    if (retry) {
+      String args = line.substring(5); args.trim();
+      const int sp = args.indexOf(' ');
+      baud = (uint32_t)args.substring(0, sp < 0 ? args.length() : sp).toInt();
+      if (sp >= 0) pkt = (uint16_t)args.substring(sp + 1).toInt();
+    }
+    if (baud < 9600 || pkt < 32) { Serial.println("Uso: link [baud [32|64|128|256]]"); return; }
+    FingerprintModel::UartGuard uart(fpModel, CLI_UART_WAIT);
+    if (!cliUartReady(uart)) return;
+    const uint8_t rc = fpModel.negotiate(baud, pkt, retry);
+    Serial.printf("%s baud=%lu paquete=%u\n", rc == FINGERPRINT_OK ? "OK" : fpModel.err(rc),
+                  (unsigned long)fpModel.detectedBaud(), fpModel.packetSize());
+    return;
+  }
+
+  if (line == "zones" || line.startsWith("zones ")) {
+    if (line.length() > 6) {
+      // zones <rangos> [orden]  |  zones -  (toda la base)
+      String zones = line.substring(6), order;
+      zones.trim();
+      const int sp = zones.indexOf(' ');
+      if (sp >= 0) { order = zones.substring(sp + 1); order.trim(); zones = zones.substring(0, sp); }
+      if (zones == "-") zones = "";
+      if (!search.configure(zones.c_str(), order.c_str())) {
+        Serial.println("Uso: zones <a-b,c-d,...> [i,j,...]  (zones - = toda la base)");
+        return;
+      }
+    }
+    char buf[1280];
+    search.statsJson(buf, sizeof(buf));
+    Serial.println(buf);
+    return;
+  }
+
+  if (line == "policy" || line.startsWith("policy ")) {
+    if (line.length() > 7) {
+      // policy <reglas>  |  policy -  (sólo la regla por defecto)
+      String rules = line.substring(7);
+      rules.trim();
+      if (rules == "-") rules = "";
+      if (!policy.configure(rules.c_str())) {
+        Serial.println("Uso: policy <ámbito:accept[/floor[/agree]],...>  ámbito = * | u<id> | z<zona> | h<desde>-<hasta>");
+        return;
+      }
+    }
+    char buf[512];
+    policy.statsJson(buf, sizeof(buf), true, -1, -1, MatchPolicy::localHour());
+    Serial.println(buf);
+    return;
+  }
+
   if (line.startsWith("d ")) {
     uint16_t id = line.substring(2).toInt();
-    Serial.println(fpModel.chip().deleteModel(id) == FINGERPRINT_OK ? "OK" : "ERR");
+    FingerprintModel::UartGuard uart(fpModel, CLI_UART_WAIT);
+    if (!cliUartReady(uart)) return;
+    const bool ok = fpModel.chip().deleteModel(id) == FINGERPRINT_OK;
+    if (ok) { slots.release(id); slots.save(); }
+    Serial.println(ok ? "OK" : "ERR");
+    return;
+  }
+
+  if (line.startsWith("du ")) {
+    uint16_t id = line.substring(3).toInt();
+    FingerprintModel::UartGuard uart(fpModel, CLI_UART_WAIT);
+    if (!cliUartReady(uart)) return;
+    Serial.println(slots.removeUser(id) == FINGERPRINT_OK ? "OK" : "ERR");
+    return;
+  }
+
+  if (line == "slots") {
+    Serial.printf("capacidad=%u ocupados=%u huerfanos=%u hueco_libre=%u\n",
+                  slots.capacity(), slots.used(), slots.orphans(), slots.largestFree());
+    return;
+  }
+
+  if (line == "compact") {
+    FingerprintModel::UartGuard uart(fpModel, CLI_UART_WAIT);
+    if (!cliUartReady(uart)) return;
+    uint16_t moves = 0;
+    const uint8_t rc = slots.compact(&moves);
+    Serial.printf("%s: %u plantillas movidas, hueco libre=%u\n",
+                  rc == FINGERPRINT_OK ? "OK" : fpModel.err(rc), moves, slots.largestFree());
+    return;
+  }
+
+  if (line == "poll" || line.startsWith("poll ")) {
+    int f = 0, w = 0, m = 0;
+    const bool change = line.length() > 5;
+    if (change && (sscanf(line.c_str() + 5, "%d %d %d", &f, &w, &m) != 3 || f <= 0 || w < 0 || m < f ||
+                   w > UINT16_MAX || m > UINT16_MAX)) {
+      Serial.println("Uso: poll <fast_ms 1..65535> <ventana_ms 0..65535> <max_ms fast..65535>");
+      return;
+    }
+    // la tarea del sensor lee la política y escribe lastCapture() con la UART
+    // tomada: se cambian y copian con la UART
+    FingerprintModel::UartGuard uart(fpModel, CLI_UART_WAIT);
+    if (!cliUartReady(uart)) return;
+    PollPolicy p = fpModel.pollPolicy();
+    if (change) {
+      p.fastMs = (uint16_t)f; p.fastWindowMs = (uint16_t)w; p.maxMs = (uint16_t)m;
+      fpModel.setPollPolicy(p);
+    }
+    const PollStats st = fpModel.lastCapture();
+    uart.release();
+    Serial.printf("poll fast=%u ventana=%u max=%u lift=%u/%u\n",
+                  p.fastMs, p.fastWindowMs, p.maxMs, p.liftMs, p.liftTimeoutMs);
+    Serial.printf("ultima captura: polls=%u lift=%u primera_imagen=%lums timeout=%d\n",
+                  st.polls, st.liftPolls, (unsigned long)st.firstImageMs, st.timedOut ? 1 : 0);
+    return;
+  }
+
+  if (line == "timing" || line.startsWith("timing ")) {
+    AutoTiming t = autoMode.timing();
+    if (line.length() > 7) {
+      unsigned m = 0, r = 0, p = 0;
+      if (sscanf(line.c_str() + 7, "%u %u %u", &m, &r, &p) != 3) {
+        Serial.println("Uso: timing <min_scan_ms> <result_ms> <relay_ms>");
+        return;
+      }
+      t.minScanMs = m; t.resultMs = r; t.relayMs = p;
+      if (!autoMode.setTiming(t)) { Serial.println("Fuera de rango (result >= 200, todos <= 10000)"); return; }
+    }
+    Serial.printf("timing minScan=%u result=%u relay=%u ms\n",
+                  (unsigned)t.minScanMs, (unsigned)t.resultMs, (unsigned)t.relayMs);
+    return;
+  }
+
+  if (line == "mode" || line == "mode i" || line == "mode f") {
+    if (line.length() > 5) autoMode.setFreeRun(line[5] == 'f');
+    Serial.printf("modo %s (aplica entre scans); personas/min interactivo=%.1f free-run=%.1f\n",
+                  autoMode.freeRun() ? "free-run" : "interactivo",
+                  fpMetricsPeoplePerMin(MetricMode::Interactive), fpMetricsPeoplePerMin(MetricMode::FreeRun));
     return;
   }
 
   if (line.startsWith("n ")) {
     int sp = line.indexOf(' ', 2);
     if (sp < 0) { Serial.println("Uso: n <id> <nombre>"); return; }
-    uint16_t id = line.substring(2, sp).toInt();
+    const long id = line.substring(2, sp).toInt();
     String name = line.substring(sp + 1); name.trim();
-    names.set(id, name);
-    Serial.println("Nombre guardado");
+    if (id < 0 || id >= NamesModel::MAX_ID) { Serial.printf("Uso: n <0..%u> <nombre>\n", NamesModel::MAX_ID - 1); return; }
+    Serial.println(names.set((uint16_t)id, name) ? "Nombre guardado" : "ERR: no se pudo guardar en NVS");
     return;
   }
 
   if (line.startsWith("e ")) {
-    uint16_t id = line.substring(2).toInt();
-    // Nuevo enrol multi-posiciones (5 imágenes): center, top, bottom, left, right
-    Serial.print("Enrolando ID "); Serial.println(id);
-
-    // comprobar capacidad
-    if (fpModel.chip().getParameters() != FINGERPRINT_OK) {
-      Serial.println("Error leyendo parámetros del sensor");
+    // e <id> [plantillas]: enrol multi-posición (por defecto 5: center, top, bottom, left, right)
+    int id = -1, count = FingerprintModel::SLOTS_PER_USER;
+    sscanf(line.c_str() + 2, "%d %d", &id, &count);
+    if (id < 0 || id > SlotMap::MAX_USER || count < 1 || count > SlotMap::MAX_PER_USER) {
+      Serial.printf("Uso: e <0..%u> [1..%u]\n", SlotMap::MAX_USER, SlotMap::MAX_PER_USER);
       return;
     }
-    const int capacity = fpModel.chip().capacity;
-    const int neededSlots = 5;
-    const long baseSlot = (long)id * neededSlots;
-    if (baseSlot + (neededSlots - 1) >= capacity) {
-      Serial.printf("No hay espacio: capacity=%d, id*%d+4=%ld\n", capacity, neededSlots, baseSlot + 4);
-      Serial.println("El ID supera la capacidad disponible para 5-templates por usuario.");
+    FingerprintModel::UartGuard uart(fpModel, CLI_UART_WAIT);
+    if (!cliUartReady(uart)) return;
+    Serial.print("Enrolando ID "); Serial.println(id);
+
+    // slots libres (o los que ya tenía el usuario), contiguos si hay hueco
+    uint16_t slotList[SlotMap::MAX_PER_USER];
+    const int neededSlots = count;
+    if (!slots.allocate((uint16_t)id, (uint8_t)neededSlots, slotList)) {
+      Serial.printf("No hay espacio: capacidad=%u ocupados=%u, faltan %d slots libres\n",
+                    slots.capacity(), slots.used(), neededSlots);
       return;
     }
 
@@ -141,8 +325,9 @@ inline void handleSerialCommand(
    gBlinkDisp = &display;
    const int maxAttempts = MAX_ENROLL_ATTEMPTS;
    for (int p = 0; p < neededSlots; ++p) {
-     uint16_t slot = baseSlot + p;
-     Serial.printf("Coloque el dedo en posición %s -> guardando slot %u\n", posNames[p], slot);
+     uint16_t slot = slotList[p];
+     const char* pos = posNames[p % 5];
+     Serial.printf("Coloque el dedo en posición %s -> guardando slot %u\n", pos, slot);
      int attempt = 0;
      bool ok = false;
      while (attempt < maxAttempts && !ok) {
@@ -155,23 +340,29 @@ inline void handleSerialCommand(
          d.setTextSize(1);
          d.setTextColor(SH110X_WHITE);
          d.setCursor(0, 0);
-         d.print(posNames[p]);
-         d.display();
+         d.print(pos);
+         display.flush();
        }
        // intentar enroll en este slot
        ok = fpModel.enroll(slot, &BlinkCbThunk);
+       {
+         const PollStats& st = fpModel.lastCapture();
+         Serial.printf("  captura: polls=%u primera_imagen=%lums\n",
+                       st.polls, (unsigned long)st.firstImageMs);
+       }
        if (!ok) {
-         Serial.printf("Intento %d falló en slot %u (pos %s)\n", attempt, slot, posNames[p]);
+         Serial.printf("Intento %d falló en slot %u (pos %s)\n", attempt, slot, pos);
          // mostrar sólo icono de error centrado
          showCenteredIcon(display, ICON_ERR_64);
          delay(700);
        } else {
-         Serial.printf("Slot %u guardado correctamente (pos %s)\n", slot, posNames[p]);
+         slots.assign(slot, (uint16_t)id);
+         Serial.printf("Slot %u guardado correctamente (pos %s)\n", slot, pos);
        }
        delay(200);
      }
      if (!ok) {
-       Serial.printf("Enrolamiento falló en slot %u tras %d intentos (pos %s)\n", slot, maxAttempts, posNames[p]);
+       Serial.printf("Enrolamiento falló en slot %u tras %d intentos (pos %s)\n", slot, maxAttempts, pos);
        allOk = false;
        break; // no reiniciamos posiciones previas, sólo abortamos el flujo
      }
@@ -179,6 +370,19 @@ inline void handleSerialCommand(
    }
     gBlinkDisp = nullptr;
 
+    if (allOk) {
+      // re-enrol con menos plantillas que antes: liberar las que sobran
+      uint16_t had[SlotMap::MAX_PER_USER];
+      const uint8_t n = slots.slotsOf((uint16_t)id, had, SlotMap::MAX_PER_USER);
+      for (uint8_t i = 0; i < n; ++i) {
+        bool keep = false;
+        for (int p = 0; p < neededSlots; ++p) keep |= had[i] == slotList[p];
+        if (!keep && fpModel.chip().deleteModel(had[i]) == FINGERPRINT_OK) slots.release(had[i]);
+      }
+    }
+    slots.save();
+    uart.release();                  // el nombre puede tardar 30 s: no frenar a SensorWorker
+
     if (allOk) {
       // pedir nombre
       Serial.print("Ingresá nombre para ID "); Serial.print(id); Serial.println(": ");
@@ -193,8 +397,9 @@ inline void handleSerialCommand(
         delay(1);
       }
       name.trim();
-      if (name.length()) { names.set(id, name); Serial.println("Nombre guardado."); }
-      else Serial.println("Sin nombre (timeout).");
+      if (!name.length()) Serial.println("Sin nombre (timeout).");
+      else if (names.set((uint16_t)id, name)) Serial.println("Nombre guardado.");
+      else Serial.println("ERR: no se pudo guardar el nombre en NVS");
       showCenteredIcon(display, ICON_OK_64);
       delay(1200);
     } else {
@@ -0,0 +1,99 @@
+#pragma once
+#include <Arduino.h>
+#include "Util.h"
+#include "FingerprintModel.h"
+#include "SearchEngine.h"
+#include "Types.h"
+
+// Ocupación de la biblioteca del sensor y dueño de cada slot.
+//
+// - Bitmap de slots ocupados, sincronizado con ReadIndexTable en begin().
+// - Tabla slot -> usuario (2 bytes por slot) guardada en NVS (namespace
+//   "slots", blob "owner"): userOf() es una lectura, sin dividir por 5.
+// - Un usuario puede tener cualquier cantidad de plantillas (1..MAX_PER_USER);
+//   allocate() busca primero un hueco contiguo, así el verify 1:1 es un solo
+//   HiSpeedSearch, y si no hay, toma slots sueltos.
+// - compact() mueve plantillas (UpChar/DownChar) para dejar a cada usuario
+//   contiguo y todo el espacio libre al final.
+//
+// Sin tabla en NVS (equipo enrolado con la versión anterior) los slots
+// ocupados se asignan al layout clásico: slot s -> usuario s / SLOTS_PER_USER.
+//
+// Los métodos que tocan el sensor (begin, sync, removeUser, compact,
+// verify) usan la UART: llamarlos desde la tarea dueña del sensor.
+class SlotMap {
+public:
+  static constexpr uint16_t MAX_SLOTS    = 1024;     // 4 páginas de ReadIndexTable
+  static constexpr uint16_t NONE         = 0xFFFF;   // slot sin dueño
+  static constexpr uint16_t ORPHAN       = 0xFFFE;   // ocupado en el sensor, sin dueño conocido
+  static constexpr uint16_t MAX_USER     = FP_MAX_USERS - 1;   // el mismo tope que NamesModel
+  static constexpr uint8_t  MAX_PER_USER = 16;
+  static constexpr uint8_t  MAX_RUNS     = 4;        // tramos que verify() junta por vuelta
+
+  static_assert(FP_MAX_USERS >= 1 && FP_MAX_USERS - 1 < ORPHAN, "FP_MAX_USERS choca con NONE/ORPHAN");
+
+  explicit SlotMap(FingerprintModel& fp) : _fp(fp) {}
+
+  // Carga la tabla de NVS y la concilia con ReadIndexTable. Devuelve FINGERPRINT_*.
+  uint8_t begin();
+  // Vuelve a leer ReadIndexTable: slots vacíos pierden dueño; ocupados sin
+  // dueño quedan ORPHAN o, con `legacy` (plantillas restauradas de un equipo
+  // con el layout clásico), pasan al usuario s / SLOTS_PER_USER. Guarda si
+  // cambió algo.
+  uint8_t sync(bool legacy = false);
+
+  // Usuario dueño del slot; -1 si está libre o sin dueño. O(1).
+  int userOf(uint16_t slot) const {
+    const uint16_t u = slot < _capacity ? _owner[slot] : NONE;
+    return u <= MAX_USER ? (int)u : -1;
+  }
+  bool occupied(uint16_t slot) const { return slot < _capacity && (_occ[slot / 8] & (1u << (slot % 8))); }
+
+  // Slots del usuario en orden ascendente (hasta `max`)
+  uint8_t slotsOf(uint16_t user, uint16_t* out, uint8_t max) const;
+  // Los mismos, agrupados en tramos contiguos, desde el slot `from` (para
+  // seguir después del último tramo cuando se llenó `out`)
+  uint8_t runsOf(uint16_t user, SearchRange* out, uint8_t max, uint16_t from = 0) const;
+
+  // Elige `n` slots para enrolar al usuario sin marcarlos: reutiliza los que
+  // ya tiene y completa con un hueco contiguo o, si no hay, con sueltos.
+  // false si no alcanza el espacio.
+  bool allocate(uint16_t user, uint8_t n, uint16_t* out) const;
+  // Plantilla grabada en `slot` para `user` / slot borrado en el sensor
+  void assign(uint16_t slot, uint16_t user);
+  void release(uint16_t slot);
+  // Borra del sensor (DeletChar) todas las plantillas del usuario
+  uint8_t removeUser(uint16_t user);
+  void clear();                      // después de vaciar la base del sensor
+  bool save();                       // NVS, sólo si hubo cambios
+
+  // 1:1: HiSpeedSearch en todos los tramos del usuario. FINGERPRINT_NOTFOUND si no
+  // tiene plantillas o ninguna coincide.
+  uint8_t verify(uint16_t user, uint8_t buf, uint16_t& page, uint16_t& score);
+
+  // Deja a cada usuario contiguo desde el slot 0 y el espacio libre al final.
+  // Primero llena huecos con usuarios enteros del final; lo que no entra se
+  // corre hacia adelante. Con la base llena se detiene donde no hay slot
+  // libre para correr una plantilla. Devuelve FINGERPRINT_*; `moves` =
+  // plantillas copiadas (~0,35 s cada una a 57600 baud).
+  uint8_t compact(uint16_t* moves = nullptr);
+
+  uint16_t capacity() const { return _capacity; }
+  uint16_t used() const { return _used; }
+  uint16_t orphans() const;
+  uint16_t largestFree() const;      // hueco contiguo más grande
+
+private:
+  uint8_t reconcile(bool legacy);
+  void setOwner(uint16_t slot, uint16_t owner);
+  uint8_t move(uint16_t from, uint16_t to, uint8_t* tpl);
+  bool firstHole(uint16_t& start, uint16_t& len) const;
+
+  FingerprintModel& _fp;
+  SemaphoreHandle_t _lock = nullptr;
+  uint16_t _capacity = 0;
+  uint16_t _used = 0;
+  bool     _dirty = false;
+  uint8_t  _occ[MAX_SLOTS / 8] = {};
+  uint16_t _owner[MAX_SLOTS];
+};
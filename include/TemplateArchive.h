@@ -0,0 +1,73 @@
+#pragma once
+#include <Arduino.h>
+
+// Archivo de plantillas (respaldo / migración), little endian:
+//
+//   cabecera  "FPTA" | versión:1 | flags:1 | cantidad:2 | capacidad:2 | bytesTpl:2   (12 B)
+//   registro  slot:2 | usuario:2 | largo:2 | datos[largo] | crc32:4 (de la cabecera del registro y datos)
+//   fin       0xFFFF | registros:2
+//
+// `cantidad` es la que anunció quien lo escribió (0 = desconocida); el lector
+// confía en el registro de fin. Un archivo sin fin está truncado.
+// `usuario` es el dueño del slot (NO_USER = sin dueño). La versión 1 no lo
+// tenía (registro slot:2 | largo:2 | ...): se sigue leyendo y onRecord recibe -1.
+namespace fpta {
+
+static constexpr uint8_t  VERSION     = 2;
+static constexpr uint8_t  VERSION_V1  = 1;
+static constexpr size_t   HEADER      = 12;
+static constexpr size_t   RECORD_HEAD = 6;
+static constexpr size_t   RECORD_HEAD_V1 = 4;
+static constexpr size_t   RECORD_TAIL = 4;
+static constexpr size_t   END         = 4;   // = RECORD_HEAD_V1: primer tramo de cada registro
+static constexpr uint16_t END_SLOT    = 0xFFFF;
+static constexpr uint16_t NO_USER     = 0xFFFF;
+static constexpr uint16_t MAX_DATA    = 512;
+
+uint32_t crc32(uint32_t crc, const uint8_t* p, size_t n);
+
+size_t writeHeader(uint8_t* out, uint16_t count, uint16_t capacity, uint16_t tplBytes);
+// out necesita RECORD_HEAD + len + RECORD_TAIL bytes
+size_t writeRecord(uint8_t* out, uint16_t slot, uint16_t user, const uint8_t* data, uint16_t len);
+size_t writeEnd(uint8_t* out, uint16_t records);
+
+// Lector incremental: feed() con pedazos de cualquier tamaño; por cada
+// registro íntegro llama onRecord. Memoria fija: un registro.
+// `user` en onRecord: dueño del archivo, NO_USER si no tenía, -1 en versión 1.
+class Reader {
+public:
+  enum class State : uint8_t { Header, RecordHead, Data, Done, Error };
+  typedef bool (*RecordFn)(void* ctx, uint16_t slot, int user, const uint8_t* data, uint16_t len);
+
+  void begin(RecordFn fn, void* ctx);
+  // Devuelve los bytes consumidos (menos que len sólo en Done/Error).
+  size_t feed(const uint8_t* data, size_t len);
+
+  State state() const { return _state; }
+  bool done() const { return _state == State::Done; }
+  const char* error() const { return _error; }
+  uint8_t version() const { return _version; }
+  uint16_t announced() const { return _announced; }
+  uint16_t capacity() const { return _capacity; }
+  uint16_t records() const { return _records; }     // íntegros
+  uint16_t badCrc() const { return _badCrc; }
+  uint16_t rejected() const { return _rejected; }   // onRecord devolvió false
+
+private:
+  void fail(const char* why) { _state = State::Error; _error = why; }
+  void onField();
+  size_t recordHead() const { return _version == VERSION_V1 ? RECORD_HEAD_V1 : RECORD_HEAD; }
+
+  RecordFn _fn = nullptr;
+  void*    _ctx = nullptr;
+  State    _state = State::Header;
+  const char* _error = nullptr;
+  uint8_t  _buf[MAX_DATA + RECORD_TAIL];   // datos + crc de un registro
+  size_t   _have = 0, _need = HEADER;
+  uint8_t  _version = 0;
+  uint16_t _slot = 0, _user = NO_USER, _len = 0;
+  uint16_t _announced = 0, _capacity = 0;
+  uint16_t _records = 0, _badCrc = 0, _rejected = 0;
+};
+
+}  // namespace fpta
@@ -0,0 +1,17 @@
+#pragma once
+#include <ESPAsyncWebServer.h>
+#include "FingerprintModel.h"
+#include "SensorWorker.h"
+#include "SlotMap.h"
+
+// GET/POST /fp/templates: respaldo y restauración de las plantillas del
+// sensor como archivo FPTA (ver TemplateArchive.h), en streaming.
+// La UART la usa sólo SensorWorker: el handler HTTP y el job se pasan los
+// bytes por un StreamBuffer y la ventana TCP frena al cliente mientras el
+// sensor escribe. El job tiene la UART tomada (FingerprintModel::lockUart)
+// durante toda la transferencia: el polling de AutoMode devuelve NOFINGER y
+// los comandos del CLI contestan "ocupado" hasta que termina, y los scans
+// pedidos esperan en la cola. Una transferencia a la vez. Tras una importación se
+// resincroniza SlotMap: los slots nuevos sin dueño pasan al layout clásico
+// id*5. Llamar antes de initFingerprintApi().
+void initTemplatesApi(AsyncWebServer& server, FingerprintModel& fp, SensorWorker& worker, SlotMap& slots);
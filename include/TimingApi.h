@@ -0,0 +1,11 @@
+#pragma once
+#include <ESPAsyncWebServer.h>
+#include "AutoMode.h"
+
+// GET /fp/timing: tiempos de AutoMode (minScanMs, resultMs, relayMs). Con
+// cualquiera de ellos como parámetro los cambia (los que faltan se mantienen)
+// y los guarda en NVS; 400 si alguno está fuera de rango.
+// mode=freerun|interactive cambia el modo de AutoMode (también en NVS); la
+// respuesta incluye el modo y personas/min de cada uno.
+// Llamar antes de initFingerprintApi(): el handler de /fp también atiende /fp/*.
+void initTimingApi(AsyncWebServer& server, AutoMode& autoMode);
@@ -1,6 +1,12 @@
 #pragma once
 #include <Arduino.h>
 
+// Ids de usuario: 0..FP_MAX_USERS-1. Un solo tope para SlotMap (dueño de cada
+// slot), NamesModel, `e <id>` / `v <id>`, /fp/command verify y las reglas u<id>.
+#ifndef FP_MAX_USERS
+  #define FP_MAX_USERS 1000
+#endif
+
 enum class FPResult : uint8_t { Ok, Timeout, ImageFail, NoMatch, Error };
 struct FPMatch { bool ok; int id; int score; String err; };
 
@@ -0,0 +1,22 @@
+#pragma once
+#include <Arduino.h>
+#include <time.h>
+
+// Piezas chicas que comparten varios módulos.
+
+// Toma el mutex (si existe) durante el bloque
+struct MutexGuard {
+  explicit MutexGuard(SemaphoreHandle_t m) : m(m) { if (m) xSemaphoreTake(m, portMAX_DELAY); }
+  ~MutexGuard() { if (m) xSemaphoreGive(m); }
+  MutexGuard(const MutexGuard&) = delete;
+  MutexGuard& operator=(const MutexGuard&) = delete;
+  SemaphoreHandle_t m;
+};
+
+// snprintf a continuación de out[w]; `w` avanza. Si no entra, w = n y las
+// llamadas siguientes no escriben (out queda terminado en '\0').
+void appendf(char* out, size_t n, size_t& w, const char* fmt, ...) __attribute__((format(printf, 4, 5)));
+
+// Antes de esto (sep. 2020) el reloj no está en hora: sin SNTP arranca en 1970
+static constexpr time_t CLOCK_VALID_UNIX = 1600000000;
+inline bool clockValid(time_t now) { return now >= CLOCK_VALID_UNIX; }
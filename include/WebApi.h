@@ -1,14 +1,98 @@
 #pragma once
 #include <ESPAsyncWebServer.h>
+#include <atomic>
 #include "FingerprintService.h"
+#include "SensorWorker.h"
+#include "SlotMap.h"
+#include "SearchEngine.h"
+#include "MatchPolicy.h"
 
+// API REST sobre FingerprintService. Las operaciones que usan la UART del
+// sensor (enroll, match, empty, delete) no corren en el handler: se encolan en
+// SensorWorker, el handler responde 202 con el número de job y el resultado se
+// consulta con GET /api/job?id= o llega por SSE (/api/events, evento "job").
+// Los jobs corren con la UART tomada, como los de AutoMode y /fp/templates.
+// Con `slots` los id de /api/enroll y /api/id son usuarios, como en la CLI:
+// el enroll toma el slot con SlotMap::allocate() y deja las plantillas
+// anteriores del usuario borradas; el delete borra todas las del usuario.
+// Con `search`, /api/match hace el mismo camino que AutoMode (zonas de
+// SearchEngine, veredicto de `policy`) y devuelve el usuario dueño del slot.
+// Sin ellos los id son slots del sensor.
 class WebApi {
 public:
-  WebApi(FingerprintService& fp);
-  void begin(uint16_t port=80);
+  WebApi(AsyncWebServer& server, FingerprintService& fp, SensorWorker& worker, SlotMap* slots = nullptr,
+         SearchEngine* search = nullptr, MatchPolicy* policy = nullptr);
+  // Rutas /api/* y /api/events en el server compartido. Llamar antes de
+  // initFingerprintApi() y de server.begin().
+  void begin();
+  // Llamar desde loop(): publica por SSE los jobs terminados
+  void loop();
+  AsyncEventSource& events() { return events_; }
+
 private:
-  AsyncWebServer server_;
+  enum class JobKind : uint8_t { Enroll, Match, Empty, Remove };
+
+  // Slot de la tabla de jobs. El handler (tarea AsyncTCP) escribe kind/arg/seq
+  // antes de encolar; la tarea del sensor escribe el resultado y publica
+  // `doneSeq` con release. Se lee con acquire, igual que MatchJob en AutoMode.
+  struct ApiJob {
+    WebApi*  api    = nullptr;
+    JobKind  kind   = JobKind::Match;
+    uint16_t arg    = 0;
+    uint32_t seq    = 0;           // 0 = slot libre
+    bool     ok     = false;
+    int      id     = -1;
+    int      score  = 0;
+    char     err[16] = {0};
+    bool     notified = false;     // SSE ya enviado (sólo loop())
+    std::atomic<bool>     running{false};
+    std::atomic<uint32_t> doneSeq{0};
+
+    bool done() const { return seq != 0 && doneSeq.load(std::memory_order_acquire) == seq; }
+  };
+  static constexpr int MAX_JOBS = 8;
+
+  // Copia de un job tomada bajo mux_: el JSON se arma fuera de la sección crítica
+  struct JobView {
+    uint32_t seq;
+    JobKind  kind;
+    uint8_t  state;                // 0 queued, 1 running, 2 done
+    bool     ok;
+    int      id;
+    int      score;
+    char     err[16];
+  };
+
+  AsyncWebServer& server_;
+  AsyncEventSource events_;
   FingerprintService& fp_;
+  SensorWorker& worker_;
+  SlotMap* slots_;
+  SearchEngine* search_;
+  MatchPolicy* policy_;
+  ApiJob jobs_[MAX_JOBS];
+  int nextSlot_ = 0;
+  portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;   // slots: handlers vs loop()
+
+  // caché que actualiza la tarea del sensor (los GET no tocan la UART)
+  std::atomic<int> count_{-1};
+  std::atomic<int> capacity_{-1};
+  std::atomic<int> security_{-1};
+
   void cors(AsyncWebServerRequest *req);
   void routes();
+  void startJob(AsyncWebServerRequest *r, JobKind kind, uint16_t arg = 0);
+  ApiJob* allocJob();
+  ApiJob* findJob(uint32_t seq);
+  static void viewOf(const ApiJob& j, JobView& v);
+  static size_t jobJson(const JobView& v, char* out, size_t n);
+  static const char* kindName(JobKind k);
+  static void runJob(void* ctx, SensorResult& r);
+  static void jobDone(void* ctx, const SensorResult& r);
+  static void refreshRun(void* ctx, SensorResult& r);
+  void refreshCache();
+  // en la tarea del sensor
+  bool enrollUser(uint16_t user, String& err);
+  bool removeUser(uint16_t user);
+  FPMatch matchUser();
 };
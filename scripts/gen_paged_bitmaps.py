@@ -0,0 +1,158 @@
+# Genera BitmapsPaged.h: los bitmaps de src/Bitmaps.cpp convertidos al formato
+# nativo del SH1106 (páginas de 8 filas, 1 byte = 8 píxeles verticales, LSB
+# arriba), listos para copiarse con memcpy al frame buffer de Adafruit_GrayOLED.
+#
+# PlatformIO lo corre como `extra_scripts = pre:...` y deja el header en
+# $BUILD_DIR/generated (se agrega a CPPPATH). También se puede correr a mano:
+#   python3 scripts/gen_paged_bitmaps.py <dir_salida> [--xbm]
+import os
+import re
+import sys
+
+# Bitmaps a convertir: nombre en Bitmaps.cpp -> (ancho, alto)
+ASSETS = {
+    "FP_64x64":          (64, 64),
+    "FP_64x64_75":       (64, 64),
+    "FP_64x64_50":       (64, 64),
+    "FP_64x64_25":       (64, 64),
+    "FP_64x64_1":        (64, 64),
+    "ICON_OK_64":        (64, 64),
+    "ICON_ERR_64":       (64, 64),
+    "ICON_PERMAQUIM_64": (64, 64),
+}
+
+ARRAY_RE = re.compile(
+    r"const\s+(?:uint8_t|unsigned\s+char)\s+(\w+)\s*\[[^\]]*\]\s*PROGMEM\s*=\s*\{(.*?)\}\s*;",
+    re.S)
+
+
+def parse_bitmaps(path):
+    with open(path, encoding="utf-8") as f:
+        src = f.read()
+    src = re.sub(r"//[^\n]*", "", src)
+    src = re.sub(r"/\*.*?\*/", "", src, flags=re.S)
+    arrays = {}
+    for name, body in ARRAY_RE.findall(src):
+        arrays[name] = [int(v, 0) for v in re.findall(r"0[xX][0-9a-fA-F]+|\d+", body)]
+    return arrays
+
+
+def to_pages(rows, w, h, lsb_first):
+    # rows: row-major 1bpp como lo leen drawBitmap (MSB-first) / drawXBitmap (LSB-first)
+    stride = (w + 7) // 8
+
+    def pixel(x, y):
+        b = rows[y * stride + x // 8]
+        return (b >> (x & 7)) & 1 if lsb_first else (b >> (7 - (x & 7))) & 1
+
+    out = []
+    for p in range((h + 7) // 8):
+        for x in range(w):
+            v = 0
+            for bit in range(8):
+                y = p * 8 + bit
+                if y < h and pixel(x, y):
+                    v |= 1 << bit
+            out.append(v)
+    return out
+
+
+def render(arrays, lsb_first):
+    lines = [
+        "// Generado por scripts/gen_paged_bitmaps.py a partir de src/Bitmaps.cpp. No editar.",
+        "//",
+        "// Formato SH1106: pages x w bytes, byte = 8 filas verticales (LSB arriba).",
+        "// Sólo lo incluye DisplayModel.cpp (las tablas constexpr quedan en ese TU).",
+        "#pragma once",
+        "#include <stdint.h>",
+        '#include "Bitmaps.h"',
+        "",
+        "#define FP_PAGED_BITMAPS_XBM %d" % (1 if lsb_first else 0),
+        "",
+        "namespace paged {",
+        "",
+    ]
+    entries = []
+    for name, (w, h) in ASSETS.items():
+        rows = arrays.get(name)
+        if rows is None:
+            raise SystemExit("gen_paged_bitmaps: falta %s en Bitmaps.cpp" % name)
+        need = ((w + 7) // 8) * h
+        if len(rows) < need:
+            # igual que en el equipo: lo que falta se lee como 0 (negro)
+            print("gen_paged_bitmaps: %s tiene %d bytes, se completan %d con 0"
+                  % (name, len(rows), need - len(rows)))
+            rows = rows + [0] * (need - len(rows))
+        data = to_pages(rows, w, h, lsb_first)
+        lines.append("constexpr uint8_t %s[%d] = {" % (name, len(data)))
+        for i in range(0, len(data), 16):
+            lines.append("  " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+        lines.append("};")
+        lines.append("")
+        lit = sum(bin(b).count("1") for b in data)
+        if lit == 0:
+            print("gen_paged_bitmaps: aviso: %s está vacío (todo negro)" % name)
+        entries.append((name, w, (h + 7) // 8, lit))
+
+    lines += [
+        "struct Entry {",
+        "  const uint8_t* src;    // bitmap original (Bitmaps.h)",
+        "  const uint8_t* data;   // versión en páginas",
+        "  uint8_t w, pages;",
+        "  uint16_t lit;          // píxeles encendidos (0 = bitmap vacío)",
+        "};",
+        "",
+        "constexpr Entry TABLE[] = {",
+    ]
+    for name, w, pages, lit in entries:
+        lines.append("  { ::%s, %s, %d, %d, %d }," % (name, name, w, pages, lit))
+    lines += [
+        "};",
+        "",
+        "inline const Entry* find(const uint8_t* src) {",
+        "  for (const Entry& e : TABLE) if (e.src == src) return &e;",
+        "  return nullptr;",
+        "}",
+        "",
+        "}  // namespace paged",
+        "",
+    ]
+    return "\n".join(lines)
+
+
+def generate(project_dir, out_dir, lsb_first):
+    src = os.path.join(project_dir, "src", "Bitmaps.cpp")
+    out = os.path.join(out_dir, "BitmapsPaged.h")
+    text = render(parse_bitmaps(src), lsb_first)
+    os.makedirs(out_dir, exist_ok=True)
+    if os.path.exists(out):
+        with open(out, encoding="utf-8") as f:
+            if f.read() == text:
+                return out          # sin cambios: no forzar recompilación
+    with open(out, "w", encoding="utf-8") as f:
+        f.write(text)
+    return out
+
+
+def xbm_from_flags(flags):
+    if isinstance(flags, (list, tuple)):
+        flags = " ".join(flags)
+    m = re.search(r"-DFP_BITMAP_IS_XBM(?:=(\d+))?", flags or "")
+    return bool(m) and (m.group(1) is None or m.group(1) != "0")
+
+
+try:
+    Import("env")  # noqa: F821 (lo inyecta SCons/PlatformIO)
+except NameError:
+    env = None
+
+if env is not None:
+    gen_dir = os.path.join(env.subst("$BUILD_DIR"), "generated")
+    generate(env.subst("$PROJECT_DIR"), gen_dir,
+             xbm_from_flags(env.GetProjectOption("build_flags", "")))
+    env.Append(CPPPATH=[gen_dir])
+elif __name__ == "__main__":
+    args = [a for a in sys.argv[1:] if a != "--xbm"]
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    print(generate(root, args[0] if args else os.path.join(root, ".pio", "generated"),
+                   "--xbm" in sys.argv))
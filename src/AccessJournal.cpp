@@ -0,0 +1,251 @@
+#include "AccessJournal.h"
+#include <time.h>
+#include "TemplateArchive.h"
+
+static constexpr uint32_t EMPTY_SEQ = 0xFFFFFFFF;
+static constexpr size_t   CRC_LEN   = offsetof(JournalRecord, crc);
+static constexpr size_t   BATCH     = 8;                 // registros por lectura de flash (256 B)
+
+static uint32_t recordCrc(const JournalRecord& r) {
+  return fpta::crc32(0, (const uint8_t*)&r, CRC_LEN);
+}
+
+AccessJournal::Slot AccessJournal::check(const JournalRecord& r) {
+  if (r.crc == recordCrc(r) && r.seq != EMPTY_SEQ && r.seq) return Slot::Valid;
+  const uint8_t* p = (const uint8_t*)&r;
+  for (size_t i = 0; i < sizeof(r); ++i)
+    if (p[i] != 0xFF) return Slot::Bad;
+  return Slot::Empty;
+}
+
+// Primer registro válido del sector; normalmente es el primero (escritura en
+// orden). Cuenta los dañados que encuentra antes.
+uint32_t AccessJournal::scanFirst(uint32_t sector) {
+  JournalRecord r;
+  for (uint32_t i = 0; i < PER_SECTOR; ++i) {
+    if (esp_partition_read(_part, sector * SECTOR + i * sizeof(r), &r, sizeof(r)) != ESP_OK) return 0;
+    const Slot s = check(r);
+    if (s == Slot::Valid) return r.seq;
+    if (s == Slot::Empty) return 0;
+    ++_badRecords;
+  }
+  return 0;
+}
+
+bool AccessJournal::blank(uint32_t sector) {
+  uint32_t buf[64];
+  for (uint32_t off = 0; off < SECTOR; off += sizeof(buf)) {
+    if (esp_partition_read(_part, sector * SECTOR + off, buf, sizeof(buf)) != ESP_OK) return false;
+    for (uint32_t w : buf)
+      if (w != 0xFFFFFFFF) return false;
+  }
+  return true;
+}
+
+bool AccessJournal::begin() {
+  if (!_lock) _lock = xSemaphoreCreateMutex();
+  _part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "journal");
+  if (!_part) _part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, nullptr);
+  if (!_part || _part->size < 2 * SECTOR) {
+    _part = nullptr;
+    Serial.println("[journal] sin partición de datos");
+    return false;
+  }
+  MutexGuard g(_lock);
+  _sectors = _part->size / SECTOR;
+  delete[] _firstSeq;
+  _firstSeq = new uint32_t[_sectors];
+  _badRecords = 0;
+
+  // el sector más nuevo es el de mayor primer seq
+  uint32_t newest = 0, newestSeq = 0;
+  for (uint32_t s = 0; s < _sectors; ++s) {
+    _firstSeq[s] = scanFirst(s);
+    if (_firstSeq[s] > newestSeq) { newestSeq = _firstSeq[s]; newest = s; }
+  }
+  _headSector = newest;
+  _headIndex = 0;
+  _nextSeq = newestSeq + 1;
+  if (newestSeq) {
+    // escribir después del último lugar usado; los dañados se saltean
+    JournalRecord r;
+    bool seen = false;                   // los dañados antes del primero válido ya los contó scanFirst
+    for (; _headIndex < PER_SECTOR; ++_headIndex) {
+      if (esp_partition_read(_part, newest * SECTOR + _headIndex * sizeof(r), &r, sizeof(r)) != ESP_OK) break;
+      const Slot s = check(r);
+      if (s == Slot::Empty) break;
+      if (s == Slot::Bad && seen) ++_badRecords;
+      if (s == Slot::Valid) {
+        seen = true;
+        if (r.seq >= _nextSeq) _nextSeq = r.seq + 1;
+      }
+    }
+  }
+  Serial.printf("[journal] %s %u KB: próximo seq=%u sector=%u/%u dañados=%u\n", _part->label,
+                (unsigned)(_part->size / 1024), (unsigned)_nextSeq, (unsigned)_headSector,
+                (unsigned)_sectors, (unsigned)_badRecords);
+  return true;
+}
+
+bool AccessJournal::log(const JournalRecord& in) {
+  JournalRecord r = in;
+  const time_t now = time(nullptr);
+  r.time = clockValid(now) ? (uint32_t)now : 0;
+  r.uptimeMs = millis();
+  if (!_part || !_pending.push(r)) { _dropped.fetch_add(1, std::memory_order_relaxed); return false; }
+  return true;
+}
+
+void AccessJournal::flush() {
+  JournalRecord r;
+  while (_pending.pop(r)) {
+    MutexGuard g(_lock);
+    if (!append(r)) _dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+// Con el lock tomado
+bool AccessJournal::append(JournalRecord& r) {
+  if (_headIndex == PER_SECTOR) {
+    _headSector = (_headSector + 1) % _sectors;
+    _headIndex = 0;
+  }
+  const uint32_t sector = _headSector;
+  if (_headIndex == 0 && (_firstSeq[sector] || !blank(sector))) {
+    // la vuelta del anillo pisa los 128 registros más viejos
+    _firstSeq[sector] = 0;
+    if (esp_partition_erase_range(_part, sector * SECTOR, SECTOR) != ESP_OK) return false;
+    ++_erases;
+  }
+  r.seq = _nextSeq;
+  r.crc = recordCrc(r);
+  // el lugar se consume aunque falle: puede haber quedado a medio grabar
+  const esp_err_t err = esp_partition_write(_part, sector * SECTOR + _headIndex * sizeof(r), &r, sizeof(r));
+  ++_headIndex;
+  if (err != ESP_OK) return false;
+  if (!_firstSeq[sector]) _firstSeq[sector] = r.seq;
+  ++_nextSeq;
+  ++_appended;
+  return true;
+}
+
+size_t AccessJournal::read(uint32_t fromSeq, JournalRecord* out, size_t max) {
+  if (!_part || !max) return 0;
+  MutexGuard g(_lock);
+  // sector de arranque: el de mayor primer seq <= fromSeq; si fromSeq es
+  // anterior a todo lo que queda, el más viejo
+  uint32_t start = _sectors, startSeq = 0, oldest = _sectors, oldestSeq = EMPTY_SEQ;
+  for (uint32_t s = 0; s < _sectors; ++s) {
+    const uint32_t f = _firstSeq[s];
+    if (!f) continue;
+    if (f <= fromSeq && f >= startSeq) { start = s; startSeq = f; }
+    if (f < oldestSeq) { oldest = s; oldestSeq = f; }
+  }
+  if (start == _sectors) start = oldest;
+  if (start == _sectors) return 0;
+
+  size_t n = 0;
+  uint32_t lastSeq = 0;
+  JournalRecord batch[BATCH];
+  for (uint32_t k = 0, s = start; k < _sectors && n < max; ++k, s = (s + 1) % _sectors) {
+    // el anillo sigue sólo si el sector es más nuevo que lo ya leído
+    if (k && (!_firstSeq[s] || _firstSeq[s] <= lastSeq)) break;
+    const uint32_t used = s == _headSector ? _headIndex : PER_SECTOR;
+    for (uint32_t i = 0; i < used && n < max; i += BATCH) {
+      const uint32_t cnt = min<uint32_t>(BATCH, used - i);
+      if (esp_partition_read(_part, s * SECTOR + i * sizeof(JournalRecord), batch,
+                             cnt * sizeof(JournalRecord)) != ESP_OK)
+        return n;
+      for (uint32_t j = 0; j < cnt && n < max; ++j) {
+        if (check(batch[j]) != Slot::Valid) continue;
+        lastSeq = batch[j].seq;
+        if (batch[j].seq >= fromSeq) out[n++] = batch[j];
+      }
+    }
+    if (s == _headSector) break;
+  }
+  return n;
+}
+
+JournalStats AccessJournal::stats() {
+  JournalStats st = {};
+  st.dropped = _dropped.load(std::memory_order_relaxed);
+  if (!_part) return st;
+  MutexGuard g(_lock);
+  uint32_t oldest = EMPTY_SEQ;
+  for (uint32_t s = 0; s < _sectors; ++s)
+    if (_firstSeq[s] && _firstSeq[s] < oldest) oldest = _firstSeq[s];
+  st.oldest     = oldest == EMPTY_SEQ ? 0 : oldest;
+  st.newest     = _nextSeq - 1;
+  st.capacity   = _sectors * PER_SECTOR;
+  st.appended   = _appended;
+  st.badRecords = _badRecords;
+  st.erases     = _erases;
+  return st;
+}
+
+// ===================== exportación =====================
+static const char* outcomeName(uint8_t o) {
+  switch ((JournalOutcome)o) {
+    case JournalOutcome::Match:       return "match";
+    case JournalOutcome::NoMatch:     return "no_match";
+    case JournalOutcome::SensorError: return "sensor_error";
+    case JournalOutcome::LowScore:    return "low_score";
+    case JournalOutcome::NoAgreement: return "no_agreement";
+    case JournalOutcome::Confirmed:   return "confirmed";
+  }
+  return "?";
+}
+
+bool JournalExporter::nextRecord(JournalRecord& r) {
+  while (!_end) {
+    if (_batchPos == _batchLen) {
+      _batchLen = _journal.read(_next, _batch, BATCH);
+      _batchPos = 0;
+      if (!_batchLen) { _end = true; break; }
+      _next = _batch[_batchLen - 1].seq + 1;
+    }
+    r = _batch[_batchPos++];
+    if (_q.since && r.time < _q.since) continue;
+    if (_q.until && (!r.time || r.time > _q.until)) continue;
+    return true;
+  }
+  return false;
+}
+
+size_t JournalExporter::fill(uint8_t* out, size_t maxLen) {
+  size_t o = 0;
+  while (o < maxLen) {
+    if (_lineOff == _lineLen) {
+      _lineOff = _lineLen = 0;
+      if (_header) {
+        _header = false;
+        if (_q.format == JournalFormat::Csv) {
+          _lineLen = strlcpy(_line, "seq,time,uptime_ms,user,slot,score,claimed,outcome,rc,latency_ms,req,retries\n",
+                             sizeof(_line));
+          continue;
+        }
+      }
+      JournalRecord r;
+      if (_sent >= _q.limit || !nextRecord(r)) break;
+      ++_sent;
+      const int n = _q.format == JournalFormat::Csv
+        ? snprintf(_line, sizeof(_line), "%u,%u,%u,%d,%d,%u,%d,%s,%u,%u,%u,%u\n", (unsigned)r.seq,
+                   (unsigned)r.time, (unsigned)r.uptimeMs, r.user, r.slot, r.score, r.claimed,
+                   outcomeName(r.outcome), r.rc, r.latencyMs, (unsigned)r.request, (unsigned)r.retries)
+        : snprintf(_line, sizeof(_line),
+                   "{\"seq\":%u,\"time\":%u,\"uptimeMs\":%u,\"user\":%d,\"slot\":%d,\"score\":%u,"
+                   "\"claimed\":%d,\"outcome\":\"%s\",\"rc\":%u,\"latencyMs\":%u,\"req\":%u,\"retries\":%u}\n",
+                   (unsigned)r.seq, (unsigned)r.time, (unsigned)r.uptimeMs, r.user, r.slot, r.score,
+                   r.claimed, outcomeName(r.outcome), r.rc, r.latencyMs, (unsigned)r.request,
+                   (unsigned)r.retries);
+      _lineLen = min<size_t>((size_t)n, sizeof(_line) - 1);
+      continue;
+    }
+    const size_t c = min(maxLen - o, _lineLen - _lineOff);
+    memcpy(out + o, _line + _lineOff, c);
+    o += c;
+    _lineOff += c;
+  }
+  return o;
+}
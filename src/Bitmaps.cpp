@@ -261,8 +261,8 @@ const uint8_t ICON_ERR_64[] PROGMEM = {
 };
 
 // ICON_PERMAQUIM_64: pega aquí los 512 bytes de la imagen 64x64 (1bpp).
-// Asegúrate del formato: si FP_BITMAP_IS_XBM==0 use drawBitmap (LSB-first),
-// si FP_BITMAP_IS_XBM==1 use drawXBitmap (MSB-first/XBM).
+// Asegúrate del formato: si FP_BITMAP_IS_XBM==0 use drawBitmap (MSB-first),
+// si FP_BITMAP_IS_XBM==1 use drawXBitmap (LSB-first/XBM).
 const uint8_t ICON_PERMAQUIM_64[512] PROGMEM = {
  	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
 	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
@@ -1,34 +1,112 @@
 #include "DisplayModel.h"
+#include "Log.h"
 #include "Bitmaps.h"
+#include "BitmapsPaged.h"   // generado en build (scripts/gen_paged_bitmaps.py)
 
-// ===== helper con (w, h) — debe ir ANTES de usarlo =====
-static inline void drawBitmapAny(Adafruit_SH1106G& disp, int x, int y, const uint8_t* img, int w, int h) {
-#if FP_BITMAP_IS_XBM
-  disp.drawXBitmap(x, y, img, w, h, 1);                 // XBM no tiene bg
-#else
-  disp.drawBitmap (x, y, img, w, h, SH110X_WHITE, SH110X_BLACK);  // <-- color y fondo
-#endif
-}
+static_assert(FP_PAGED_BITMAPS_XBM == FP_BITMAP_IS_XBM,
+              "BitmapsPaged.h generado con otro FP_BITMAP_IS_XBM: revisar build_flags");
 
 Adafruit_SH1106G& DisplayModel::raw() { return _display; }
 
 // ---------- init ----------
 bool DisplayModel::begin(uint8_t addr, bool reset) {
   if (!_display.begin(addr, reset)) return false;
+  _addr = addr;
+  renderIdleFrame();          // una vez por arranque; idle() sólo lo copia
   _display.clearDisplay();
-  _display.display();
+  invalidate();
+  flush();
+  return true;
+}
+
+// ---------- flush parcial ----------
+void DisplayModel::sendPage(uint8_t page, uint8_t x0, uint8_t x1, const uint8_t* row) {
+  const uint8_t col = x0 + COL_OFFSET;
+  _wire.beginTransmission(_addr);
+  _wire.write((uint8_t)0x00);                    // stream de comandos
+  _wire.write((uint8_t)(0xB0 | page));           // página
+  _wire.write((uint8_t)(0x10 | (col >> 4)));     // columna (nibble alto)
+  _wire.write((uint8_t)(col & 0x0F));            // columna (nibble bajo)
+  _wire.endTransmission();
+
+  for (int x = x0; x <= x1; ) {
+    const int n = min((int)I2C_CHUNK, x1 - x + 1);
+    _wire.beginTransmission(_addr);
+    _wire.write((uint8_t)0x40);                  // stream de datos
+    _wire.write(row + x, n);
+    _wire.endTransmission();
+    x += n;
+  }
+}
+
+void DisplayModel::flush() {
+  const uint8_t* buf = _display.getBuffer();
+  if (!buf) return;
+
+  uint32_t bytes = 0;
+  uint8_t pages = 0;
+  for (uint8_t p = 0; p < PAGES; ++p) {
+    const uint8_t* row = buf + p * WIDTH;
+    uint8_t* shadow = _shadow + p * WIDTH;
+    int x0 = 0, x1 = WIDTH - 1;
+    if (_shadowValid) {
+      while (x0 < WIDTH && row[x0] == shadow[x0]) ++x0;
+      if (x0 == WIDTH) continue;                 // página sin cambios
+      while (row[x1] == shadow[x1]) --x1;
+    }
+    sendPage(p, (uint8_t)x0, (uint8_t)x1, row);
+    memcpy(shadow + x0, row + x0, x1 - x0 + 1);
+    bytes += x1 - x0 + 1;
+    pages |= (uint8_t)(1u << p);
+  }
+  _shadowValid = true;
+
+  if (!pages) return;
+  _stats.frames++;
+  _stats.lastBytes = bytes;
+  _stats.lastPages = pages;
+  _stats.totalBytes += bytes;
+}
+
+
+// ---------- bitmaps ----------
+bool DisplayModel::blitPaged(int x, int y, const uint8_t* img, int w, int h, bool opaque) {
+  if (y < 0 || (y & 7) || _display.getRotation() != 0) return false;
+  const paged::Entry* e = paged::find(img);
+  if (!e || e->w != w || e->pages * 8 != h) return false;
+  uint8_t* buf = _display.getBuffer();
+  if (!buf) return false;
+
+  // recorte horizontal (el panel derecho con _xoff se pasa del borde)
+  const int x0 = max(x, 0), x1 = min(x + w, WIDTH);
+  const int p0 = y >> 3;
+  for (int p = 0; p < e->pages && p0 + p < PAGES && x0 < x1; ++p) {
+    uint8_t* dst = buf + (p0 + p) * WIDTH + x0;
+    const uint8_t* src = e->data + p * e->w + (x0 - x);
+    if (opaque) memcpy(dst, src, x1 - x0);
+    else for (int i = 0; i < x1 - x0; ++i) dst[i] |= src[i];
+  }
   return true;
 }
 
+void DisplayModel::drawImage(int x, int y, const uint8_t* img, int w, int h, bool opaque) {
+  if (blitPaged(x, y, img, w, h, opaque)) return;
+  if (opaque) _display.fillRect(x, y, w, h, SH110X_BLACK);
+#if FP_BITMAP_IS_XBM
+  _display.drawXBitmap(x, y, img, w, h, SH110X_WHITE);
+#else
+  _display.drawBitmap(x, y, img, w, h, SH110X_WHITE);
+#endif
+}
 
 // ---------- dibujos ----------
 void DisplayModel::drawFp64Right() {
   const int x = 64 + _xoff;
   const int y = 0;
-  drawBitmapAny(_display, x, y, FP_64x64, FP64_W, FP64_H);
+  drawImage(x, y, FP_64x64, FP64_W, FP64_H);
 }
 
-void DisplayModel::drawFpPhase(uint8_t phase) {
+void DisplayModel::drawFpPhase(uint8_t phase, bool flushNow) {
   const int x = 64 + _xoff, y = 0;
 
   // Secuencia de “respiración”: 25% → 1 → 50% → 75% → 100%
@@ -44,58 +122,56 @@ void DisplayModel::drawFpPhase(uint8_t phase) {
   if (phase >= FRAME_COUNT) phase = FRAME_COUNT - 1;
   const uint8_t* img = FRAMES[phase];
 
-  
-#if FP_BITMAP_IS_XBM
-  _display.drawXBitmap(x, y, img, FP64_W, FP64_H, 1);
-#else
-  drawBitmapAny(_display, x, y, img, FP64_W, FP64_H);
-#endif
-  _display.display();
+  drawImage(x, y, img, FP64_W, FP64_H, true);   // el frame anterior era más grande
+  if (flushNow) flush();
 }
 
 
 void DisplayModel::drawOkRight() {
   const int paneX = 64, paneY = 0;
-  _display.fillRect(paneX, paneY, 64, 64, SH110X_BLACK);
-#if FP_BITMAP_IS_XBM
-  _display.drawXBitmap(paneX, paneY, ICON_OK_64, ICON_W, ICON_H, 1);
-#else
-  _display.drawBitmap (paneX, paneY, ICON_OK_64, ICON_W, ICON_H, 1);
-#endif
-  _display.display();
+  drawImage(paneX, paneY, ICON_OK_64, ICON_W, ICON_H, true);
+  flush();
 }
 
 void DisplayModel::drawErrRight() {
   const int paneX = 64, paneY = 0;
-  _display.fillRect(paneX, paneY, 64, 64, SH110X_BLACK);
-#if FP_BITMAP_IS_XBM
-  _display.drawXBitmap(paneX, paneY, ICON_ERR_64, ICON_W, ICON_H, 1);
-#else
-  _display.drawBitmap (paneX, paneY, ICON_ERR_64, ICON_W, ICON_H, 1);
-#endif
-  _display.display();
+  drawImage(paneX, paneY, ICON_ERR_64, ICON_W, ICON_H, true);
+  flush();
 }
 
 
 void DisplayModel::scanBlinkTick(bool on) {
   // ON=100%, OFF=limpio (compat con código viejo)
   const int x = 64 + _xoff, y = 0;
-  _display.fillRect(x, y, FP64_W, FP64_H, SH110X_BLACK);
-  if (on) drawBitmapAny(_display, x, y, FP_64x64, FP64_W, FP64_H);
-  _display.display();
+  if (on) drawImage(x, y, FP_64x64, FP64_W, FP64_H, true);
+  else    _display.fillRect(x, y, FP64_W, FP64_H, SH110X_BLACK);
+  flush();
 }
 
 // ---------- pantallas ----------
+void DisplayModel::renderIdleFrame() {
+  _display.clearDisplay();
+  const paged::Entry* logo = paged::find(ICON_PERMAQUIM_64);
+  if (logo && logo->lit) {
+    drawImage(32, 0, ICON_PERMAQUIM_64, ICON_W, ICON_H);
+  } else {
+    // ICON_PERMAQUIM_64 sin contenido en Bitmaps.cpp: texto centrado
+    LOGI("[Display] ICON_PERMAQUIM_64 vacio, idle con texto");
+    _display.setTextSize(1);
+    _display.setTextColor(SH110X_WHITE);
+    _display.setCursor(0, 28);
+    _display.print("Waiting command");
+  }
+  const uint8_t* buf = _display.getBuffer();
+  if (!buf) return;
+  memcpy(_idleFrame, buf, sizeof(_idleFrame));
+  _idleValid = true;
+}
+
 void DisplayModel::idle() {
-  // nuevo: dibujar logo en idle (ICON_PERMAQUIM_64 debe estar definido en Bitmaps.cpp)
-  auto& d = raw();
-  d.clearDisplay();
-  #if FP_BITMAP_IS_XBM
-    d.drawXBitmap(32, 0, ICON_PERMAQUIM_64, ICON_W, ICON_H, SH110X_WHITE);
-  #else
-    d.drawBitmap(32, 0, ICON_PERMAQUIM_64, ICON_W, ICON_H, SH110X_WHITE);
-  #endif
-  d.display();
+  if (_idleValid) memcpy(_display.getBuffer(), _idleFrame, sizeof(_idleFrame));
+  else            renderIdleFrame();
+  flush();
 }
 
 void DisplayModel::scanning() {
@@ -104,7 +180,7 @@ void DisplayModel::scanning() {
   _display.setTextSize(1);
   _display.setCursor(0, 8);  _display.println("Escaneando...");
   _display.setCursor(0, 20); _display.println("mantener");
-  _display.display();
+  flush();
 }
 
 void DisplayModel::welcome(const String& nombre, uint16_t id, int score) {
@@ -130,7 +206,7 @@ void DisplayModel::welcome(const String& nombre, uint16_t id, int score) {
   // LIMPIEZA EXPLÍCITA DEL PANEL DERECHO + TILDE
   _display.fillRect(64, 0, 64, 64, SH110X_BLACK);
   drawOkRight();
-  _display.display();
+  flush();
 }
 
 void DisplayModel::errorMsg(const String& msg) {
@@ -144,7 +220,7 @@ void DisplayModel::errorMsg(const String& msg) {
   // LIMPIEZA EXPLÍCITA DEL PANEL DERECHO + CRUZ
   _display.fillRect(64, 0, 64, 64, SH110X_BLACK);
   drawErrRight();
-  _display.display();
+  flush();
 }
 
 void DisplayModel::okMsg(const String& l2) {
@@ -155,7 +231,7 @@ void DisplayModel::okMsg(const String& l2) {
   _display.setTextSize(1);
   _display.setCursor(0, 24); _display.println(l2);
   drawFp64Right();
-  _display.display();
+  flush();
 }
 
 void DisplayModel::drawFpPhaseLabeled(uint8_t phase, uint8_t label) {
@@ -166,15 +242,8 @@ void DisplayModel::drawFpPhaseLabeled(uint8_t phase, uint8_t label) {
     : (phase == 1) ? FP_64x64_50
                    : FP_64x64_25;
 
-  // panel derecho
-  _display.fillRect(x, y, FP64_W, FP64_H, SH110X_BLACK);
-
-  // huella del frame
-  #if FP_BITMAP_IS_XBM
-    _display.drawXBitmap(x, y, img, FP64_W, FP64_H, 1);
-  #else
-    _display.drawBitmap (x, y, img, FP64_W, FP64_H, 1);
-  #endif
+  // panel derecho: huella del frame (pinta también el fondo)
+  drawImage(x, y, img, FP64_W, FP64_H, true);
 
   // badge con número (esquina sup-izquierda del panel)
   _display.fillRect(x+2, y+2, 12, 10, SH110X_WHITE);
@@ -183,5 +252,5 @@ void DisplayModel::drawFpPhaseLabeled(uint8_t phase, uint8_t label) {
   _display.setCursor(x+4, y+3);
   _display.print(label);  // 1..4
 
-  _display.display();
+  flush();
 }
@@ -0,0 +1,27 @@
+#include "DoorRelay.h"
+
+void DoorRelay::begin() {
+  if (_pin < 0) return;
+  write(false);                       // nivel de reposo antes de habilitar la salida
+  pinMode(_pin, OUTPUT);
+}
+
+void DoorRelay::write(bool on) {
+  digitalWrite(_pin, on == _activeHigh ? HIGH : LOW);
+}
+
+void DoorRelay::pulse(uint32_t ms) {
+  if (_pin < 0 || !ms) return;
+  _offAt.store((millis() + ms) | 1u, std::memory_order_release);   // nunca 0 (= apagado)
+  write(true);
+  _pulses.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DoorRelay::loop() {
+  uint32_t at = _offAt.load(std::memory_order_acquire);
+  if (!at || (long)(millis() - at) < 0) return;
+  if (!_offAt.compare_exchange_strong(at, 0, std::memory_order_acq_rel)) return;   // llegó otro pulso
+  write(false);
+  // un pulse() entre el CAS y write(false) ya dejó su plazo: no cortarlo
+  if (_offAt.load(std::memory_order_acquire)) write(true);
+}
@@ -2,42 +2,140 @@
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h>
 #include <WiFi.h>
+#include <atomic>
 #include "FingerprintApi.h"
 #include "ScanRequest.h"
+#include "EventBus.h"
+#include "Types.h"
 
 // helpers estáticos
 static AsyncEventSource* s_fpEvents = nullptr;
 static AsyncWebServer*    s_server   = nullptr;
 
-// Ring buffer para eventos pendientes
-static constexpr int MAX_PENDING = 16;
-struct PendingEvent {
-  char type[20];
-  char data[256];
+// Eventos pendientes: registros compactos en un bus sin locks; el JSON se
+// arma recién al enviar en fpApiLoop(). Prompts/avisos van en la cola de baja
+// prioridad y resultados en la de alta, así un prompt nunca desplaza un
+// resultado. Con la cola llena se descarta el más viejo de esa prioridad y
+// se cuenta en fpApiStats().
+enum class FpEventType : uint8_t { Prompt, Result, Enroll, Erase };
+enum class FpStage : uint8_t { None, Start, Abort, Request, Result };
+
+struct FpEvent {
+  uint32_t    seq;     // número de evento (id SSE)
+  FpEventType type;
+  FpStage     stage;
+  uint8_t     ok;
+  PolicyReason reason; // resultados de scan
+  int16_t     id;
+  int16_t     score;
+  uint32_t    req;     // petición de ScanRequest (prompt/result); 0 = ninguna
 };
-static PendingEvent s_queue[MAX_PENDING];
-static int s_qHead = 0;
-static int s_qTail = 0;
-
-// Mutex para proteger la cola entre tasks/loop
-static portMUX_TYPE s_fpMux = portMUX_INITIALIZER_UNLOCKED;
-
-static inline bool queueEmpty() { return s_qHead == s_qTail; }
-static inline bool queueFull()  { return ((s_qTail + 1) % MAX_PENDING) == s_qHead; }
-
-static void enqueueEvent(const char* type, const char* json) {
-  portENTER_CRITICAL(&s_fpMux);
-  int next = (s_qTail + 1) % MAX_PENDING;
-  if (next == s_qHead) {
-    // cola llena: descartar el más viejo (avanzar head) para hacer sitio
-    s_qHead = (s_qHead + 1) % MAX_PENDING;
+
+static constexpr size_t MAX_PENDING = 16;      // por prioridad
+typedef EventBus<FpEvent, MAX_PENDING> FpEventBus;
+static FpEventBus s_bus(DropPolicy::DropOldest, DropPolicy::DropOldest);
+static std::atomic<uint32_t> s_eventSeq{0};
+
+static void publish(FpEventType type, FpStage stage, bool ok = false, int id = -1, int score = 0,
+                    uint32_t req = 0, PolicyReason reason = PolicyReason::None) {
+  FpEvent ev;
+  ev.seq   = s_eventSeq.fetch_add(1, std::memory_order_relaxed) + 1;
+  ev.type  = type;
+  ev.stage = stage;
+  ev.ok    = ok ? 1 : 0;
+  ev.reason = reason;
+  ev.id    = (int16_t)id;
+  ev.score = (int16_t)score;
+  ev.req   = req;
+  const bool high = type == FpEventType::Result || stage == FpStage::Result;
+  s_bus.publish(ev, high ? FpEventBus::HIGH_PRIO : FpEventBus::LOW_PRIO);
+}
+
+static const char* eventName(FpEventType t) {
+  switch (t) {
+    case FpEventType::Prompt: return "prompt";
+    case FpEventType::Result: return "result";
+    case FpEventType::Enroll: return "enroll";
+    case FpEventType::Erase:  return "erase";
+  }
+  return "?";
+}
+
+static const char* stageName(FpStage s) {
+  switch (s) {
+    case FpStage::Start:   return "start";
+    case FpStage::Abort:   return "abort";
+    case FpStage::Request: return "request";
+    case FpStage::Result:  return "result";
+    default:               return "";
+  }
+}
+
+// Mismo JSON que antes armaban los fpApiEmit*
+static void formatEvent(const FpEvent& ev, char* out, size_t n) {
+  const char* okStr = ev.ok ? "true" : "false";
+  switch (ev.type) {
+    case FpEventType::Prompt:
+      snprintf(out, n, "{\"event\":\"prompt\",\"msg\":\"Ponga su huella\",\"req\":%u}", (unsigned)ev.req);
+      break;
+    case FpEventType::Result:
+      if (ev.reason == PolicyReason::None)
+        snprintf(out, n, "{\"event\":\"result\",\"ok\":%s,\"id\":%d,\"score\":%d,\"req\":%u}",
+                 okStr, ev.id, ev.score, (unsigned)ev.req);
+      else
+        snprintf(out, n, "{\"event\":\"result\",\"ok\":%s,\"id\":%d,\"score\":%d,\"req\":%u,\"reason\":\"%s\"}",
+                 okStr, ev.id, ev.score, (unsigned)ev.req, policyReasonName(ev.reason));
+      break;
+    case FpEventType::Enroll:
+    case FpEventType::Erase:
+      if (ev.stage == FpStage::Result)
+        snprintf(out, n, "{\"event\":\"%s\",\"stage\":\"result\",\"ok\":%s,\"id\":%d}",
+                 eventName(ev.type), okStr, ev.id);
+      else if (ev.type == FpEventType::Erase)
+        snprintf(out, n, "{\"event\":\"erase\",\"stage\":\"%s\",\"id\":%d}",
+                 stageName(ev.stage), ev.id);
+      else
+        snprintf(out, n, "{\"event\":\"enroll\",\"stage\":\"%s\"}", stageName(ev.stage));
+      break;
+  }
+}
+
+// Log de reenvío: los últimos REPLAY_LEN eventos enviados (16 bytes c/u). Un
+// cliente que se reconecta con Last-Event-ID recibe los que se perdió. El
+// mutex serializa el envío en vivo (fpApiLoop, loop) y el reenvío (onConnect,
+// tarea AsyncTCP); un evento puede llegar dos veces, el cliente deduplica por id.
+static constexpr size_t REPLAY_LEN = 64;
+static FpEvent  s_replay[REPLAY_LEN];
+static uint32_t s_replayTotal = 0;              // eventos agregados desde el arranque
+static SemaphoreHandle_t s_sendMutex = nullptr;
+
+static void replayAppend(const FpEvent& ev) {
+  s_replay[s_replayTotal % REPLAY_LEN] = ev;
+  ++s_replayTotal;
+}
+
+// Con s_sendMutex tomado
+static void replayTo(AsyncEventSourceClient* client, uint32_t lastId) {
+  const uint32_t n = min<uint32_t>(s_replayTotal, REPLAY_LEN);
+  if (!n) return;
+  const uint32_t newest = s_replay[(s_replayTotal - 1) % REPLAY_LEN].seq;
+  // id más nuevo que lo emitido: el equipo se reinició, reenviar todo el log
+  if (lastId > newest) lastId = 0;
+
+  char data[128];
+  const uint32_t oldest = s_replay[(s_replayTotal - n) % REPLAY_LEN].seq;
+  if (lastId + 1 < oldest) {
+    // hueco: el cliente perdió más de lo que guarda el log
+    snprintf(data, sizeof(data), "{\"event\":\"gap\",\"from\":%u,\"to\":%u}",
+             (unsigned)(lastId + 1), (unsigned)(oldest - 1));
+    client->send(data, "gap", oldest - 1);
+  }
+  for (uint32_t i = s_replayTotal - n; i < s_replayTotal; ++i) {
+    const FpEvent& ev = s_replay[i % REPLAY_LEN];
+    if (ev.seq <= lastId) continue;
+    formatEvent(ev, data, sizeof(data));
+    client->send(data, eventName(ev.type), ev.seq);
   }
-  strncpy(s_queue[s_qTail].type, type, sizeof(s_queue[s_qTail].type)-1);
-  s_queue[s_qTail].type[sizeof(s_queue[s_qTail].type)-1] = '\0';
-  strncpy(s_queue[s_qTail].data, json, sizeof(s_queue[s_qTail].data)-1);
-  s_queue[s_qTail].data[sizeof(s_queue[s_qTail].data)-1] = '\0';
-  s_qTail = next;
-  portEXIT_CRITICAL(&s_fpMux);
 }
 
 static inline bool canSendEvents() {
@@ -47,17 +145,61 @@ static inline bool canSendEvents() {
 void initFingerprintApi(AsyncWebServer& server, AsyncEventSource& events) {
   s_server = &server;
   s_fpEvents = &events;
+  if (!s_sendMutex) s_sendMutex = xSemaphoreCreateMutex();
+
+  // Reconexión: reenviar lo posterior a Last-Event-ID
+  events.onConnect([](AsyncEventSourceClient* client) {
+    const uint32_t lastId = client->lastId();
+    if (!lastId || !s_sendMutex) return;
+    xSemaphoreTake(s_sendMutex, portMAX_DELAY);
+    replayTo(client, lastId);
+    xSemaphoreGive(s_sendMutex);
+  });
 
   server.on("/fp/command", HTTP_GET, [](AsyncWebServerRequest *req){
     String action;
     if (req->hasParam("action")) action = req->getParam("action")->value();
     String idParam = req->hasParam("id") ? req->getParam("id")->value() : "";
 
+    // encolar scan/verify: timeoutMs propio (def. 15000) y origin=remote para
+    // backends que encadenan pedidos; la respuesta trae el id que vuelve en "result"
+    const unsigned long timeoutMs = req->hasParam("timeoutMs")
+      ? (unsigned long)constrain(req->getParam("timeoutMs")->value().toInt(), 0L, 600000L) : 15000UL;
+    const ScanOrigin origin = req->hasParam("origin") && req->getParam("origin")->value() == "remote"
+      ? ScanOrigin::Remote : ScanOrigin::Http;
+
     if (action == "scan") {
-      // instruir UI para pedir huella (SSE) y solicitar a AutoMode que inicie MATCHING
-      fpApiEmitPrompt();
-      requestScan();
-      req->send(202, "application/json", "{\"status\":\"ok\",\"action\":\"scan\"}");
+      // encolar para AutoMode; el prompt (SSE) lleva el id de la petición
+      const uint32_t reqId = requestScan(timeoutMs, origin);
+      if (!reqId) {
+        req->send(503, "application/json", "{\"error\":\"scan queue full\"}");
+        return;
+      }
+      fpApiEmitPrompt(reqId);
+      char body[96];
+      snprintf(body, sizeof(body), "{\"status\":\"ok\",\"action\":\"scan\",\"request\":%u,\"queued\":%u}",
+               (unsigned)reqId, (unsigned)scanQueueDepth());
+      req->send(202, "application/json", body);
+      return;
+    }
+    if (action == "verify") {
+      // 1:1: el dedo se compara sólo con los slots del usuario `id`
+      const long id = idParam.toInt();
+      if (idParam.length() == 0 || id < 0 || id >= FP_MAX_USERS || (id == 0 && idParam != "0")) {
+        req->send(400, "application/json", "{\"error\":\"missing id\"}");
+        return;
+      }
+      const uint32_t reqId = requestVerify((uint16_t)id, timeoutMs, origin);
+      if (!reqId) {
+        req->send(503, "application/json", "{\"error\":\"scan queue full\"}");
+        return;
+      }
+      fpApiEmitPrompt(reqId);
+      char body[112];
+      snprintf(body, sizeof(body),
+               "{\"status\":\"ok\",\"action\":\"verify\",\"id\":%ld,\"request\":%u,\"queued\":%u}",
+               id, (unsigned)reqId, (unsigned)scanQueueDepth());
+      req->send(202, "application/json", body);
       return;
     }
     if (action == "enrollStart") {
@@ -80,7 +222,14 @@ void initFingerprintApi(AsyncWebServer& server, AsyncEventSource& events) {
       return;
     }
     if (action == "status") {
-      const char *body = "{\"status\":\"idle\",\"scanBar\":true}";
+      const FpApiStats st = fpApiStats();
+      char body[224];
+      snprintf(body, sizeof(body),
+               "{\"status\":\"idle\",\"scanBar\":true,\"scanQueue\":%u,\"events\":{\"queued\":%u,"
+               "\"published\":%u,\"dropped\":%u,\"droppedResults\":%u,\"lastId\":%u,"
+               "\"replay\":%u}}",
+               (unsigned)scanQueueDepth(), (unsigned)st.queued, (unsigned)st.published, (unsigned)st.dropped,
+               (unsigned)st.droppedResults, (unsigned)st.lastSeq, (unsigned)st.replayLen);
       req->send(200, "application/json", body);
       return;
     }
@@ -95,71 +244,57 @@ void initFingerprintApi(AsyncWebServer& server, AsyncEventSource& events) {
 }
 
 // Encolado (ya no envían inmediatamente)
-void fpApiEmitPrompt() {
-  enqueueEvent("prompt", "{\"event\":\"prompt\",\"msg\":\"Ponga su huella\"}");
-}
-void fpApiEmitResult(bool ok, int id, int score) {
-  char buf[128];
-  snprintf(buf, sizeof(buf), "{\"event\":\"result\",\"ok\":%s,\"id\":%d,\"score\":%d}",
-           ok ? "true" : "false", id, score);
-  enqueueEvent("result", buf);
-}
-void fpApiEmitEnrollStart() {
-  enqueueEvent("enroll", "{\"event\":\"enroll\",\"stage\":\"start\"}");
-}
-void fpApiEmitEnrollAbort() {
-  enqueueEvent("enroll", "{\"event\":\"enroll\",\"stage\":\"abort\"}");
-}
-void fpApiEmitEnrollResult(bool ok, int id) {
-  char buf[80];
-  snprintf(buf, sizeof(buf), "{\"event\":\"enroll\",\"stage\":\"result\",\"ok\":%s,\"id\":%d}",
-           ok ? "true" : "false", id);
-  enqueueEvent("enroll", buf);
-}
-void fpApiEmitEraseRequest(int id) {
-  char buf[80];
-  snprintf(buf, sizeof(buf), "{\"event\":\"erase\",\"stage\":\"request\",\"id\":%d}", id);
-  enqueueEvent("erase", buf);
+void fpApiEmitPrompt(uint32_t req)         { publish(FpEventType::Prompt, FpStage::None, false, -1, 0, req); }
+void fpApiEmitResult(bool ok, int id, int score, uint32_t req, PolicyReason reason) {
+  publish(FpEventType::Result, FpStage::None, ok, id, score, req, reason);
 }
-void fpApiEmitEraseResult(bool ok, int id) {
-  char buf[80];
-  snprintf(buf, sizeof(buf), "{\"event\":\"erase\",\"stage\":\"result\",\"ok\":%s,\"id\":%d}",
-           ok ? "true" : "false", id);
-  enqueueEvent("erase", buf);
+void fpApiEmitEnrollStart()                { publish(FpEventType::Enroll, FpStage::Start); }
+void fpApiEmitEnrollAbort()                { publish(FpEventType::Enroll, FpStage::Abort); }
+void fpApiEmitEnrollResult(bool ok, int id){ publish(FpEventType::Enroll, FpStage::Result, ok, id); }
+void fpApiEmitEraseRequest(int id)         { publish(FpEventType::Erase, FpStage::Request, false, id); }
+void fpApiEmitEraseResult(bool ok, int id) { publish(FpEventType::Erase, FpStage::Result, ok, id); }
+
+FpApiStats fpApiStats() {
+  const FpEventBus::Stats b = s_bus.stats();
+  FpApiStats st;
+  st.queued         = (uint32_t)b.queued;
+  st.published      = b.published[0] + b.published[1];
+  st.dropped        = b.dropped[0] + b.dropped[1];
+  st.droppedResults = b.dropped[FpEventBus::HIGH_PRIO];
+  st.lastSeq        = s_eventSeq.load(std::memory_order_relaxed);
+  st.replayLen      = min<uint32_t>(s_replayTotal, REPLAY_LEN);
+  return st;
 }
 
 // Llamar periódicamente desde loop() para enviar lo encolado de forma segura
 void fpApiLoop() {
   // nada que hacer si no hay eventos en cola
-  if (queueEmpty()) return;
+  const FpEvent* ev = s_bus.peek();
+  if (!ev) return;
 
   // si hay eventos pero no se puede enviar, imprimir aviso con rate limit
   if (!canSendEvents()) {
     static unsigned long lastWarn = 0;
     unsigned long now = millis();
     if (now - lastWarn > 5000) {
-      Serial.printf("[fpapi] eventos pendientes=%d, esperando WiFi/SSE\n",
-                    (s_qTail - s_qHead + MAX_PENDING) % MAX_PENDING);
+      const FpApiStats st = fpApiStats();
+      Serial.printf("[fpapi] eventos pendientes=%u descartados=%u, esperando WiFi/SSE\n",
+                    (unsigned)st.queued, (unsigned)st.dropped);
       lastWarn = now;
     }
     return;
   }
 
-  // enviar encolados
-  while (true) {
-    portENTER_CRITICAL(&s_fpMux);
-    if (s_qHead == s_qTail) {
-      portEXIT_CRITICAL(&s_fpMux);
-      break;
-    }
-    PendingEvent ev = s_queue[s_qHead];
-    s_qHead = (s_qHead + 1) % MAX_PENDING;
-    portEXIT_CRITICAL(&s_fpMux);
-
-    if (s_fpEvents) {
-      s_fpEvents->send(ev.data, ev.type, millis());
-      // yield to allow background tasks to run
-      delay(0);
-    }
+  // enviar encolados (en orden de seq entre ambas prioridades)
+  char data[128];
+  for (; ev; ev = s_bus.peek()) {
+    formatEvent(*ev, data, sizeof(data));
+    xSemaphoreTake(s_sendMutex, portMAX_DELAY);
+    s_fpEvents->send(data, eventName(ev->type), ev->seq);
+    replayAppend(*ev);
+    xSemaphoreGive(s_sendMutex);
+    s_bus.consume();
+    // yield to allow background tasks to run
+    delay(0);
   }
-}
\ No newline at end of file
+}
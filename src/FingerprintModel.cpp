@@ -1,29 +1,210 @@
 #include "FingerprintModel.h"
+#include <Preferences.h>
+
+static const char* NVS_NS = "fp";
+
+void FingerprintModel::lockInit() {
+  if (!_uartLock) _uartLock = xSemaphoreCreateRecursiveMutex();
+}
+
+bool FingerprintModel::lockUart(TickType_t wait) {
+  lockInit();
+  return _uartLock && xSemaphoreTakeRecursive(_uartLock, wait) == pdTRUE;
+}
+
+void FingerprintModel::unlockUart() {
+  if (_uartLock) xSemaphoreGiveRecursive(_uartLock);
+}
 
 void FingerprintModel::begin(uint32_t initialBaud) {
-  _ser.begin(initialBaud, SERIAL_8N1, _pinRx, _pinTx);
-  delay(60);
-  autoDetect();
+  UartGuard g(*this);
+  attachTouch();
+  Preferences p;
+  uint32_t cached = 0;
+  if (p.begin(NVS_NS, true)) { cached = p.getUInt("baud", 0); p.end(); }
+  const uint32_t first = cached ? cached : initialBaud;
+  _ser.setRxBufferSize(RX_BUFFER);             // antes de begin()
+  _ser.begin(first, SERIAL_8N1, _pinRx, _pinTx);
+  autoDetect(first);
   if (_detectedBaud) {
-    _finger.setPacketSize(FINGERPRINT_PACKET_SIZE_32);
+    // el tamaño de paquete es el que tenga el sensor: lo ajusta negotiate()
     _finger.getParameters(); // best-effort
+    if (_detectedBaud != cached && p.begin(NVS_NS, false)) { p.putUInt("baud", _detectedBaud); p.end(); }
   }
 }
 
+// VfyPwd crudo con timeout corto: a un baud equivocado el sensor no contesta
+// y Adafruit esperaría 1 s (y su begin() suma otro segundo de delay).
 bool FingerprintModel::tryAt(uint32_t b) {
-  _ser.updateBaudRate(b); delay(40);
-  _finger.begin(b);       delay(40);
-  return _finger.verifyPassword();
+  _ser.updateBaudRate(b);
+  while (_ser.available()) _ser.read();        // basura del baud anterior
+  const uint8_t cmd[5] = {FINGERPRINT_VERIFYPASSWORD, 0, 0, 0, 0};
+  return _link.command(cmd, sizeof(cmd), nullptr, 0, nullptr, HANDSHAKE_MS) == FINGERPRINT_OK;
 }
 
-void FingerprintModel::autoDetect() {
+// `first` (el último baud bueno, de NVS) se reintenta mientras el sensor
+// pueda estar arrancando; recién después se prueban los demás.
+void FingerprintModel::autoDetect(uint32_t first) {
+  const unsigned long t0 = millis();
+  do {
+    if (tryAt(first)) { _detectedBaud = first; return; }
+  } while (millis() - t0 < SENSOR_BOOT_MS);
+
   uint32_t bauds[] = {57600,115200,38400,19200};
   for (uint8_t i=0;i<sizeof(bauds)/sizeof(bauds[0]);++i) {
-    if (tryAt(bauds[i])) { _detectedBaud=bauds[i]; return; }
+    if (bauds[i] != first && tryAt(bauds[i])) { _detectedBaud=bauds[i]; return; }
   }
   _detectedBaud=0;
 }
 
+// ---------- baud / tamaño de paquete ----------
+// Escalones que prueba negotiate(), de mayor a menor
+static const uint32_t BAUD_LADDER[] = {115200, 57600, 38400, 19200};
+
+static uint8_t packetCode(uint16_t bytes) {        // 0=32 1=64 2=128 3=256
+  uint8_t c = 0;
+  while (c < 3 && (32u << (c + 1)) <= bytes) ++c;
+  return c;
+}
+
+uint8_t FingerprintModel::setSysPara(uint8_t reg, uint8_t value) {
+  const uint8_t cmd[3] = {FINGERPRINT_WRITE_REG, reg, value};
+  return _link.command(cmd, sizeof(cmd));
+}
+
+// Enlace sano con lo esperado: VERIFY_ROUNDS VfyPwd seguidos, ReadSysPara
+// con ese baud y paquete y, si hay una plantilla en la página 0 del índice,
+// su UpChar completo (paquetes de datos del tamaño nuevo).
+bool FingerprintModel::verifyLink(uint32_t baud, uint16_t packet) {
+  const uint8_t vfy[5] = {FINGERPRINT_VERIFYPASSWORD, 0, 0, 0, 0};
+  for (uint8_t i = 0; i < VERIFY_ROUNDS; ++i)
+    if (_link.command(vfy, sizeof(vfy), nullptr, 0, nullptr, HANDSHAKE_MS) != FINGERPRINT_OK) return false;
+  if (_finger.getParameters() != FINGERPRINT_OK) return false;
+  // Adafruit guarda baud_rate en uint16_t: 115200 llega truncado
+  if (_finger.baud_rate != (uint16_t)baud || _finger.packet_len != packet) return false;
+
+  uint8_t bits[256 / 8];
+  if (readIndex(bits, 256) != FINGERPRINT_OK) return false;
+  for (uint16_t s = 0; s < 256; ++s) {
+    if (!(bits[s / 8] & (1u << (s % 8)))) continue;
+    uint8_t tpl[TEMPLATE_MAX];
+    uint16_t len = 0;
+    return readTemplate(s, tpl, len) == FINGERPRINT_OK && len > 0;
+  }
+  return true;                                     // base vacía: no hay qué subir
+}
+
+// El sensor contesta SetSysPara al baud viejo y recién ahí cambia. Si el
+// enlace no pasa la verificación al baud nuevo, se lo devuelve al viejo.
+bool FingerprintModel::switchBaud(uint32_t baud) {
+  const uint32_t old = _detectedBaud;
+  const uint16_t packet = _finger.packet_len;
+  if (setSysPara(FINGERPRINT_BAUD_REG_ADDR, (uint8_t)(baud / 9600)) != FINGERPRINT_OK) return false;
+  _ser.flush();
+  bool up = false;
+  for (uint8_t i = 0; i < VERIFY_ROUNDS && !up; ++i) up = tryAt(baud);
+  if (up && verifyLink(baud, packet)) { _detectedBaud = baud; return true; }
+
+  // al baud nuevo se pierden bytes: insistir hasta que llegue la vuelta (si
+  // el sensor no llegó a cambiar, esto es basura para él y autoDetect lo halla)
+  for (uint8_t i = 0; i < VERIFY_ROUNDS; ++i) {
+    _ser.updateBaudRate(baud);
+    while (_ser.available()) _ser.read();
+    if (setSysPara(FINGERPRINT_BAUD_REG_ADDR, (uint8_t)(old / 9600)) == FINGERPRINT_OK) break;
+  }
+  _ser.flush();
+  autoDetect(old);
+  if (_detectedBaud) _finger.getParameters();
+  return false;
+}
+
+uint8_t FingerprintModel::negotiate(uint32_t maxBaud, uint16_t maxPacket, bool retryFailed) {
+  UartGuard g(*this);
+  if (!ready() || _finger.getParameters() != FINGERPRINT_OK) return FINGERPRINT_PACKETRECIEVEERR;
+  Preferences p;
+  uint32_t cached = 0, cap0 = 0;
+  if (p.begin(NVS_NS, true)) {
+    cached = p.getUInt("baud", 0);
+    cap0 = p.getUInt("baudCap", 0);
+    p.end();
+  }
+  uint32_t cap = retryFailed ? 0 : cap0;
+
+  // 1) paquete, al baud actual (que ya anda): del objetivo hacia abajo
+  uint16_t cur = _finger.packet_len;               // lo que tiene el sensor
+  for (int8_t code = packetCode(maxPacket); code >= 0; --code) {
+    const uint16_t size = (uint16_t)(32u << code);
+    if (size == cur) break;                        // ya probado (o era el de antes)
+    if (setSysPara(FINGERPRINT_PACKET_REG_ADDR, (uint8_t)code) != FINGERPRINT_OK) continue;   // clon sin ese tamaño
+    cur = size;
+    if (verifyLink(_detectedBaud, size)) break;
+  }
+
+  // 2) baud: el escalón más alto permitido; si no pasa, el siguiente
+  for (uint32_t b : BAUD_LADDER) {
+    if (b > maxBaud || (cap && b >= cap)) continue;
+    if (b == _detectedBaud || !ready()) break;
+    if (switchBaud(b)) break;
+    cap = b;
+    Serial.printf("[fp] %lu baud no verifica: queda %lu\n", (unsigned long)b, (unsigned long)_detectedBaud);
+  }
+  if (!ready()) return FINGERPRINT_PACKETRECIEVEERR;
+  _finger.getParameters();
+
+  if ((_detectedBaud != cached || cap != cap0) && p.begin(NVS_NS, false)) {
+    p.putUInt("baud", _detectedBaud);
+    if (cap) p.putUInt("baudCap", cap);
+    else p.remove("baudCap");
+    p.end();
+  }
+  Serial.printf("[fp] enlace: %lu baud, paquete %u bytes\n", (unsigned long)_detectedBaud, _finger.packet_len);
+  return FINGERPRINT_OK;
+}
+
+// ---------- línea touch ----------
+void IRAM_ATTR FingerprintModel::onTouchIsr(void* arg) {
+  FingerprintModel* self = static_cast<FingerprintModel*>(arg);
+  self->_touchFlag = true;
+  self->_touchEdges = self->_touchEdges + 1;
+}
+
+void FingerprintModel::attachTouch() {
+  if (_pinTouch < 0) return;
+  pinMode(_pinTouch, _touchActiveHigh ? INPUT_PULLDOWN : INPUT_PULLUP);
+  attachInterruptArg(digitalPinToInterrupt(_pinTouch), &FingerprintModel::onTouchIsr, this,
+                     _touchActiveHigh ? RISING : FALLING);
+}
+
+bool FingerprintModel::touchActive() const {
+  return digitalRead(_pinTouch) == (_touchActiveHigh ? HIGH : LOW);
+}
+
+uint8_t FingerprintModel::pollFinger() {
+  const unsigned long now = millis();
+  if (_pinTouch >= 0) {
+    _touch.edges = _touchEdges;
+    const bool touched = _touchFlag || touchActive();
+    if (!touched && now - _lastPollMs < FALLBACK_POLL_MS) {
+      // sin dedo: contar un GenImg evitado por cada intervalo que habría
+      // ocupado el polling continuo
+      if (now - _lastSavedMs >= _pollCostMs) { _touch.uartSaved++; _lastSavedMs = now; }
+      return FINGERPRINT_NOFINGER;
+    }
+  }
+
+  // un job (exportación, match, enrol) o el CLI tienen la UART: no intercalar
+  UartGuard g(*this, 0);
+  if (!g) return FINGERPRINT_NOFINGER;
+  if (_pinTouch >= 0) _touchFlag = false;
+
+  _touch.uartPolls++;
+  const uint8_t rc = _finger.getImage();
+  const unsigned long end = millis();
+  if (rc == FINGERPRINT_NOFINGER && end > now) _pollCostMs = end - now;
+  _lastPollMs = _lastSavedMs = end;
+  return rc;
+}
+
 const char* FingerprintModel::err(uint8_t code) const {
   switch (code) {
     case FINGERPRINT_OK:               return "OK";
@@ -34,6 +215,7 @@ const char* FingerprintModel::err(uint8_t code) const {
     case FINGERPRINT_FEATUREFAIL:      return "feature_fail";
     case FINGERPRINT_INVALIDIMAGE:     return "invalid_image";
     case FINGERPRINT_ENROLLMISMATCH:   return "enroll_mismatch";
+    case FINGERPRINT_NOTFOUND:         return "not_found";
     case FINGERPRINT_BADLOCATION:      return "bad_location";
     case FINGERPRINT_DBCLEARFAIL:      return "db_clear_fail";
     case FINGERPRINT_UPLOADFEATUREFAIL:return "upload_feature_fail";
@@ -43,31 +225,38 @@ const char* FingerprintModel::err(uint8_t code) const {
   }
 }
 
+uint16_t FingerprintModel::waitLift() {
+  PollScheduler sched(_poll.liftMs, _poll.liftTimeoutMs, _poll.liftMs, _poll.liftTimeoutMs);
+  uint16_t polls = 0;
+  do { ++polls; } while (_finger.getImage() != FINGERPRINT_NOFINGER && sched.next());
+  return polls;
+}
+
 bool FingerprintModel::captureToBuffer(uint8_t buf, uint32_t timeoutMs,
                                        void (*blinkCb)(bool)) {
-  unsigned long t0=millis();
-  while (_finger.getImage()!=FINGERPRINT_NOFINGER && millis()-t0<1500) delay(40);
+  _lastCapture = PollStats{};
+  _lastCapture.liftPolls = waitLift();
 
-  unsigned long start = millis();
+  PollScheduler sched(_poll.fastMs, _poll.fastWindowMs, _poll.maxMs, timeoutMs);
   bool blink=false; unsigned long lastToggle=0;
 
   while (true) {
     unsigned long now = millis();
     if (blinkCb && now-lastToggle>180) { lastToggle=now; blink=!blink; blinkCb(blink); }
 
+    _lastCapture.polls++;
     uint8_t rc = _finger.getImage();
     if (rc == FINGERPRINT_OK) { if (blinkCb) blinkCb(true); break; }
     if (rc != FINGERPRINT_NOFINGER) { /* ruido; continuar */ }
 
-    if (millis()-start > timeoutMs) return false;
-    delay(20);
+    if (!sched.next()) { _lastCapture.timedOut = true; return false; }
   }
+  _lastCapture.firstImageMs = sched.elapsedMs();
 
   uint8_t rc = _finger.image2Tz(buf);
   if (rc != FINGERPRINT_OK) return false;
 
-  unsigned long t2=millis();
-  while (_finger.getImage()!=FINGERPRINT_NOFINGER && millis()-t2<1500) delay(40);
+  _lastCapture.liftPolls += waitLift();
   return true;
 }
 
@@ -91,3 +280,72 @@ MatchRes FingerprintModel::fastMatch(void (*blinkCb)(bool)) {
   }
   return r;
 }
+
+uint8_t FingerprintModel::searchRange(uint8_t buf, uint16_t start, uint16_t count,
+                                      uint16_t& page, uint16_t& score) {
+  // fingerFastSearch() fija el rango 0..0xA3; acá va explícito
+  const uint8_t cmd[6] = {FINGERPRINT_HISPEEDSEARCH, buf, (uint8_t)(start >> 8), (uint8_t)start,
+                          (uint8_t)(count >> 8), (uint8_t)count};
+  uint8_t reply[4];
+  uint16_t n = 0;
+  const uint8_t rc = _link.command(cmd, sizeof(cmd), reply, sizeof(reply), &n);
+  if (rc != FINGERPRINT_OK) return rc;
+  if (n < 4) return FINGERPRINT_PACKETRECIEVEERR;
+  page  = (uint16_t)((reply[0] << 8) | reply[1]);
+  score = (uint16_t)((reply[2] << 8) | reply[3]);
+  return FINGERPRINT_OK;
+}
+
+// ---------- plantillas (UpChar / DownChar) ----------
+uint16_t FingerprintModel::packetBytes() {
+  if (_finger.packet_len < 32) _finger.getParameters();
+  return _finger.packet_len >= 32 ? _finger.packet_len : 32;
+}
+
+uint8_t FingerprintModel::readIndex(uint8_t* bits, uint16_t capacity) {
+  memset(bits, 0, (capacity + 7) / 8);
+  for (uint16_t base = 0; base < capacity; base += 256) {
+    const uint8_t cmd[2] = {0x1F, (uint8_t)(base / 256)};   // ReadIndexTable(página)
+    uint8_t page[32];
+    uint16_t n = 0;
+    const uint8_t rc = _link.command(cmd, sizeof(cmd), page, sizeof(page), &n);
+    if (rc != FINGERPRINT_OK) return rc;
+    const uint16_t bytes = min<uint16_t>(n, (capacity - base + 7) / 8);
+    memcpy(bits + base / 8, page, bytes);
+  }
+  // el último byte puede traer bits fuera de capacidad
+  if (capacity % 8) bits[capacity / 8] &= (uint8_t)((1u << (capacity % 8)) - 1);
+  return FINGERPRINT_OK;
+}
+
+uint8_t FingerprintModel::readTemplate(uint16_t slot, uint8_t* out, uint16_t& len) {
+  len = 0;
+  uint8_t rc = _finger.loadModel(slot);
+  if (rc != FINGERPRINT_OK) return rc;
+  const uint8_t cmd[2] = {0x08, 0x01};                       // UpChar(CharBuffer1)
+  rc = _link.command(cmd, sizeof(cmd));
+  if (rc != FINGERPRINT_OK) return rc;
+  // siguen paquetes de datos (0x02) hasta el de fin (0x08)
+  for (;;) {
+    uint8_t pid;
+    uint16_t n;
+    if (!_link.readPacket(pid, out + len, TEMPLATE_MAX - len, n, 1000)) return FINGERPRINT_UPLOADFAIL;
+    len += n;
+    if (pid == R305Link::PID_END) return FINGERPRINT_OK;
+    if (pid != R305Link::PID_DATA) return FINGERPRINT_PACKETRECIEVEERR;
+  }
+}
+
+uint8_t FingerprintModel::writeTemplate(uint16_t slot, const uint8_t* data, uint16_t len) {
+  if (!len || len > TEMPLATE_MAX) return FINGERPRINT_PACKETRECIEVEERR;
+  const uint16_t chunk = packetBytes();
+  const uint8_t cmd[2] = {0x09, 0x01};                       // DownChar(CharBuffer1)
+  uint8_t rc = _link.command(cmd, sizeof(cmd));
+  if (rc != FINGERPRINT_OK) return rc;
+  // el sensor no responde los paquetes de datos
+  for (uint16_t off = 0; off < len; off += chunk) {
+    const uint16_t n = min<uint16_t>(chunk, len - off);
+    _link.writePacket(off + n >= len ? R305Link::PID_END : R305Link::PID_DATA, data + off, n);
+  }
+  return _finger.storeModel(slot);
+}
@@ -1,7 +1,6 @@
 
 #include <FingerprintService.h>
 #include <WebApi.h>
-#include <OledUi.h>
 #include "Log.h"
 
 FingerprintService::FingerprintService(HardwareSerial& s, int rx, int tx)
@@ -41,6 +40,13 @@ String FingerprintService::infoJson() {
   return j;
 }
 
+bool FingerprintService::params(int& capacity, int& securityLevel) {
+  if (fp_.getParameters() != FINGERPRINT_OK) return false;
+  capacity = fp_.capacity;
+  securityLevel = fp_.security_level;
+  return true;
+}
+
 int FingerprintService::count() {
   return (fp_.getTemplateCount()==FINGERPRINT_OK) ? fp_.templateCount : -1;
 }
@@ -49,12 +55,17 @@ bool FingerprintService::empty() { return fp_.emptyDatabase()==FINGERPRINT_OK; }
 bool FingerprintService::remove(uint16_t id) { return fp_.deleteModel(id)==FINGERPRINT_OK; }
 
 bool FingerprintService::captureTo(uint8_t buf) {
-  uint32_t t0 = millis();
-  while (fp_.getImage() != FINGERPRINT_OK) {
-    if (millis()-t0 > 15000) return false;
-    delay(60);
-  }
-  return fp_.image2Tz(buf) == FINGERPRINT_OK;
+  lastCapture_ = PollStats{};
+  PollScheduler sched(poll_.fastMs, poll_.fastWindowMs, poll_.maxMs, 15000);
+  do {
+    lastCapture_.polls++;
+    if (fp_.getImage() == FINGERPRINT_OK) {
+      lastCapture_.firstImageMs = sched.elapsedMs();
+      return fp_.image2Tz(buf) == FINGERPRINT_OK;
+    }
+  } while (sched.next());
+  lastCapture_.timedOut = true;
+  return false;
 }
 
 bool FingerprintService::enroll(uint16_t id, String& err) {
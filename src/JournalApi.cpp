@@ -0,0 +1,64 @@
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <memory>
+#include "JournalApi.h"
+
+static AccessJournal* s_journal = nullptr;
+static constexpr uint32_t MAX_LIMIT = 10000;
+
+// Entero sin signo; si falta queda `out`, false si no es un número
+static bool readU32(AsyncWebServerRequest* req, const char* name, uint32_t& out) {
+  if (!req->hasParam(name)) return true;
+  const String v = req->getParam(name)->value();
+  if (!v.length() || v.length() > 10) return false;
+  for (size_t i = 0; i < v.length(); ++i)
+    if (!isDigit(v[i])) return false;
+  out = (uint32_t)strtoul(v.c_str(), nullptr, 10);
+  return true;
+}
+
+static void onJournal(AsyncWebServerRequest* req) {
+  if (!s_journal->ready()) {
+    req->send(503, "application/json", "{\"error\":\"no journal partition\"}");
+    return;
+  }
+  const JournalStats st = s_journal->stats();
+  if (req->hasParam("stats") && req->getParam("stats")->value() == "1") {
+    char body[200];
+    snprintf(body, sizeof(body),
+             "{\"oldest\":%u,\"newest\":%u,\"capacity\":%u,\"appended\":%u,\"dropped\":%u,"
+             "\"badRecords\":%u,\"erases\":%u}",
+             (unsigned)st.oldest, (unsigned)st.newest, (unsigned)st.capacity, (unsigned)st.appended,
+             (unsigned)st.dropped, (unsigned)st.badRecords, (unsigned)st.erases);
+    req->send(200, "application/json", body);
+    return;
+  }
+
+  JournalQuery q;
+  if (!readU32(req, "from", q.fromSeq) || !readU32(req, "limit", q.limit) ||
+      !readU32(req, "since", q.since) || !readU32(req, "until", q.until) ||
+      !q.limit || q.limit > MAX_LIMIT) {
+    req->send(400, "application/json", "{\"error\":\"bad from/limit/since/until\"}");
+    return;
+  }
+  if (req->hasParam("format")) {
+    const String f = req->getParam("format")->value();
+    if (f == "ndjson") q.format = JournalFormat::Ndjson;
+    else if (f != "csv") {
+      req->send(400, "application/json", "{\"error\":\"format must be csv or ndjson\"}");
+      return;
+    }
+  }
+  std::shared_ptr<JournalExporter> exp(new JournalExporter(*s_journal, q));
+  AsyncWebServerResponse* res = req->beginChunkedResponse(
+    q.format == JournalFormat::Csv ? "text/csv" : "application/x-ndjson",
+    [exp](uint8_t* buf, size_t maxLen, size_t) -> size_t { return exp->fill(buf, maxLen); });
+  res->addHeader("X-Journal-Oldest", String(st.oldest));
+  res->addHeader("X-Journal-Newest", String(st.newest));
+  req->send(res);
+}
+
+void initJournalApi(AsyncWebServer& server, AccessJournal& journal) {
+  s_journal = &journal;
+  server.on("/fp/journal", HTTP_GET, onJournal);
+}
@@ -0,0 +1,222 @@
+#include "MatchPolicy.h"
+#include <Preferences.h>
+#include <time.h>
+
+static const char* NVS_NS = "policy";
+
+constexpr PolicyRule MatchPolicy::DEFAULT_RULE;
+
+static const char* const REASON_NAMES[(uint8_t)PolicyReason::COUNT] = {
+  "none", "accept", "confirmed", "low_score", "no_agreement"};
+
+const char* policyReasonName(PolicyReason r) {
+  return r < PolicyReason::COUNT ? REASON_NAMES[(uint8_t)r] : "?";
+}
+
+void MatchPolicy::lockInit() {
+  if (!_lock) _lock = xSemaphoreCreateMutex();
+}
+
+void MatchPolicy::begin() {
+  lockInit();
+  Preferences p;
+  if (!p.begin(NVS_NS, true)) return;        // primera vez: sin namespace
+  char spec[SPEC_MAX] = "";
+  p.getString("rules", spec, sizeof(spec));
+  p.end();
+  if (!configure(spec, false)) Serial.printf("[policy] reglas NVS inválidas: '%s'\n", spec);
+}
+
+// "ámbito:accept[/floor[/agree]],..." Vacío = sólo la regla por defecto.
+bool MatchPolicy::parse(const char* s, Rule* out, uint8_t& n) {
+  n = 0;
+  while (*s) {
+    if (n == MAX_RULES) return false;
+    Rule& r = out[n];
+    char* end;
+    r.a = r.b = 0;
+    const char kind = *s++;
+    if (kind == '*') {
+      r.scope = Scope::Default;
+    } else if (kind == 'u' || kind == 'z') {
+      r.scope = kind == 'u' ? Scope::User : Scope::Zone;
+      const unsigned long v = strtoul(s, &end, 10);
+      if (end == s || v > SlotMap::MAX_USER) return false;
+      r.a = (uint16_t)v;
+      s = end;
+    } else if (kind == 'h') {
+      r.scope = Scope::Hours;
+      const unsigned long a = strtoul(s, &end, 10);
+      if (end == s || *end != '-' || a > 23) return false;
+      s = end + 1;
+      const unsigned long b = strtoul(s, &end, 10);
+      if (end == s || b > 24 || b == a) return false;
+      r.a = (uint16_t)a;
+      r.b = (uint16_t)b;
+      s = end;
+    } else {
+      return false;
+    }
+    if (*s++ != ':') return false;
+    const unsigned long acc = strtoul(s, &end, 10);
+    if (end == s || acc > 0xFFFF) return false;
+    r.accept = (uint16_t)acc;
+    r.floor = r.agree = -1;
+    s = end;
+    if (*s == '/') {
+      ++s;
+      const unsigned long f = strtoul(s, &end, 10);
+      if (end == s || f > acc) return false;
+      r.floor = (int32_t)f;
+      s = end;
+      if (*s == '/') {
+        ++s;
+        const unsigned long k = strtoul(s, &end, 10);
+        if (end == s || k < 1 || k > SlotMap::MAX_PER_USER) return false;
+        r.agree = (int16_t)k;
+        s = end;
+      }
+    }
+    ++n;
+    if (*s == ',') ++s;
+    else if (*s) return false;
+  }
+  return true;
+}
+
+bool MatchPolicy::configure(const char* spec, bool persist) {
+  Rule rules[MAX_RULES];
+  uint8_t n = 0;
+  if (!spec) spec = "";
+  if (strlen(spec) >= SPEC_MAX || !parse(spec, rules, n)) return false;
+
+  lockInit();
+  {
+    MutexGuard g(_lock);
+    memcpy(_rules, rules, sizeof(rules));
+    _ruleCount = n;
+    strlcpy(_spec, spec, sizeof(_spec));
+    memset(_reasons, 0, sizeof(_reasons));
+    _checks = _checkMs = 0;
+  }
+  if (persist) {
+    Preferences p;
+    if (p.begin(NVS_NS, false)) {
+      p.putString("rules", spec);
+      p.end();
+    }
+  }
+  return true;
+}
+
+void MatchPolicy::spec(char* out, size_t n) {
+  MutexGuard g(_lock);
+  strlcpy(out, _spec, n);
+}
+
+int MatchPolicy::localHour() {
+  const time_t now = time(nullptr);
+  if (!clockValid(now)) return -1;           // sin SNTP: 1970
+  struct tm t;
+  localtime_r(&now, &t);
+  return t.tm_hour;
+}
+
+PolicyRule MatchPolicy::ruleFor(int user, int zone, int hour) {
+  lockInit();
+  MutexGuard g(_lock);
+  PolicyRule base = DEFAULT_RULE;
+  const Rule* best = nullptr;
+  uint8_t bestRank = 0;
+  for (uint8_t i = 0; i < _ruleCount; ++i) {
+    const Rule& r = _rules[i];
+    uint8_t rank = 0;
+    switch (r.scope) {
+      case Scope::Default:
+        base.accept = r.accept;
+        if (r.floor >= 0) base.floor = (uint16_t)r.floor;
+        if (r.agree > 0) base.agree = (uint8_t)r.agree;
+        break;
+      case Scope::User:  rank = user >= 0 && r.a == user ? 3 : 0; break;
+      case Scope::Zone:  rank = zone >= 0 && r.a == zone ? 2 : 0; break;
+      case Scope::Hours:
+        if (hour >= 0) rank = (r.a < r.b ? hour >= r.a && hour < r.b : hour >= r.a || hour < r.b) ? 1 : 0;
+        break;
+    }
+    // la primera de cada nivel
+    if (rank > bestRank) { best = &r; bestRank = rank; }
+  }
+  PolicyRule out = base;
+  if (best) {
+    out.accept = best->accept;
+    if (best->floor >= 0) out.floor = (uint16_t)best->floor;
+    if (best->agree > 0) out.agree = (uint8_t)best->agree;
+  }
+  if (out.floor > out.accept) out.floor = out.accept;   // floor heredado más alto que accept
+  return out;
+}
+
+PolicyVerdict MatchPolicy::decide(uint8_t buf, uint16_t page, uint16_t score, int zone) {
+  PolicyVerdict v = {false, PolicyReason::None, 1, 0};
+  const int user = _slots.userOf(page);
+  const PolicyRule r = ruleFor(user, zone, localHour());
+  uint32_t ms = 0;
+
+  if (score >= r.accept) {
+    v.accept = true;
+    v.reason = PolicyReason::Accept;
+  } else if (score < r.floor) {
+    v.reason = PolicyReason::LowScore;
+  } else {
+    // zona gris: el mismo CharBuffer contra los otros slots del usuario
+    uint16_t mine[SlotMap::MAX_PER_USER];
+    const uint8_t n = user >= 0 ? _slots.slotsOf((uint16_t)user, mine, SlotMap::MAX_PER_USER) : 0;
+    uint8_t left = 0;
+    for (uint8_t i = 0; i < n; ++i) left += mine[i] != page;
+    const unsigned long t0 = millis();
+    for (uint8_t i = 0; i < n && v.agree < r.agree && v.agree + left >= r.agree; ++i) {
+      if (mine[i] == page) continue;
+      --left;
+      ++v.checks;
+      uint16_t p = 0, s = 0;
+      if (_fp.searchRange(buf, mine[i], 1, p, s) == FINGERPRINT_OK && s >= r.floor) ++v.agree;
+    }
+    ms = millis() - t0;
+    v.accept = v.agree >= r.agree;
+    v.reason = v.accept ? PolicyReason::Confirmed : PolicyReason::NoAgreement;
+    Serial.printf("[policy] slot=%u user=%d score=%u (%u/%u) -> %s %u/%u en %u 1:1\n", page, user, score,
+                  r.floor, r.accept, policyReasonName(v.reason), v.agree, r.agree, v.checks);
+  }
+
+  MutexGuard g(_lock);
+  ++_reasons[(uint8_t)v.reason];
+  _checks += v.checks;
+  _checkMs += ms;
+  return v;
+}
+
+void MatchPolicy::resetStats() {
+  lockInit();
+  MutexGuard g(_lock);
+  memset(_reasons, 0, sizeof(_reasons));
+  _checks = _checkMs = 0;
+}
+
+size_t MatchPolicy::statsJson(char* out, size_t n, bool effective, int user, int zone, int hour) {
+  PolicyRule r = DEFAULT_RULE;
+  if (effective) r = ruleFor(user, zone, hour);
+  lockInit();
+  MutexGuard g(_lock);
+  size_t w = 0;
+  appendf(out, n, w, "{\"rules\":\"%s\"", _spec);
+  for (uint8_t i = 1; i < (uint8_t)PolicyReason::COUNT; ++i)
+    appendf(out, n, w, ",\"%s\":%u", REASON_NAMES[i], (unsigned)_reasons[i]);
+  const uint32_t gray = _reasons[(uint8_t)PolicyReason::Confirmed] + _reasons[(uint8_t)PolicyReason::NoAgreement];
+  appendf(out, n, w, ",\"checks\":%u,\"checkAvgMs\":%.1f", (unsigned)_checks,
+          gray ? (double)_checkMs / gray : 0.0);
+  if (effective)
+    appendf(out, n, w, ",\"effective\":{\"user\":%d,\"zone\":%d,\"hour\":%d,\"accept\":%u,\"floor\":%u,\"agree\":%u}",
+            user, zone, hour, r.accept, r.floor, r.agree);
+  appendf(out, n, w, "}");
+  return w < n ? w : 0;
+}
@@ -0,0 +1,40 @@
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "MetricsApi.h"
+#include "ScanMetrics.h"
+#include "FingerprintApi.h"
+
+static SensorWorker* s_worker = nullptr;
+
+static void onMetrics(AsyncWebServerRequest* req) {
+  // ~14 KB de texto: AsyncResponseStream lo junta en un cbuf que crece
+  AsyncResponseStream* res = req->beginResponseStream("text/plain; version=0.0.4");
+  fpMetricsPrometheus(*res);
+
+  res->print(F("# HELP fp_sensor_jobs_total Trabajos de SensorWorker.\n"
+               "# TYPE fp_sensor_jobs_total counter\n"));
+  res->printf("fp_sensor_jobs_total{state=\"completed\"} %u\n", (unsigned)s_worker->completed());
+  res->printf("fp_sensor_jobs_total{state=\"rejected\"} %u\n", (unsigned)s_worker->rejected());
+  res->print(F("# TYPE fp_sensor_queue_pending gauge\n"));
+  res->printf("fp_sensor_queue_pending %u\n", (unsigned)s_worker->pending());
+
+  const FpApiStats st = fpApiStats();
+  res->print(F("# HELP fp_events_total Eventos SSE aceptados y descartados por cola llena.\n"
+               "# TYPE fp_events_total counter\n"));
+  res->printf("fp_events_total{state=\"published\"} %u\n", (unsigned)st.published);
+  res->printf("fp_events_total{state=\"dropped\"} %u\n", (unsigned)st.dropped);
+  res->printf("fp_events_total{state=\"dropped_result\"} %u\n", (unsigned)st.droppedResults);
+  res->print(F("# TYPE fp_events_queued gauge\n"));
+  res->printf("fp_events_queued %u\n", (unsigned)st.queued);
+
+  res->print(F("# TYPE fp_uptime_seconds gauge\n"));
+  res->printf("fp_uptime_seconds %.3f\n", fpMetricsNow() / 1e6);
+  req->send(res);
+
+  if (req->hasParam("reset") && req->getParam("reset")->value() == "1") fpMetricsReset();
+}
+
+void initMetricsApi(AsyncWebServer& server, SensorWorker& worker) {
+  s_worker = &worker;
+  server.on("/fp/metrics", HTTP_GET, onMetrics);
+}
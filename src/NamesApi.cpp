@@ -0,0 +1,93 @@
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include "NamesApi.h"
+#include "NamesCodec.h"
+
+static NamesModel* s_names = nullptr;
+static std::atomic<bool> s_importBusy{false};   // una importación a la vez
+
+// El request libera _tempObject con free(): el importador no puede tener destructor
+static_assert(std::is_trivially_destructible<NamesImporter>::value, "NamesImporter en _tempObject");
+
+// ?format=csv|ndjson manda; si no, el Content-Type (POST) o Accept (GET).
+// false si no se reconoce.
+static bool requestFormat(AsyncWebServerRequest* req, const String& type, NamesFormat& fmt) {
+  String f = req->hasParam("format") ? req->getParam("format")->value() : type;
+  f.toLowerCase();
+  if (f.indexOf("ndjson") >= 0 || f.indexOf("json") >= 0) { fmt = NamesFormat::Ndjson; return true; }
+  if (f.indexOf("csv") >= 0 || f.length() == 0 || f.indexOf("*/*") >= 0) { fmt = NamesFormat::Csv; return true; }
+  return false;
+}
+
+static const char* mimeOf(NamesFormat fmt) {
+  return fmt == NamesFormat::Csv ? "text/csv" : "application/x-ndjson";
+}
+
+static void onExport(AsyncWebServerRequest* req) {
+  const String accept = req->hasHeader("Accept") ? req->getHeader("Accept")->value() : String();
+  NamesFormat fmt;
+  if (!requestFormat(req, accept, fmt)) fmt = NamesFormat::Csv;
+  std::shared_ptr<NamesExporter> exp(new NamesExporter(*s_names, fmt));
+  AsyncWebServerResponse* res = req->beginChunkedResponse(mimeOf(fmt),
+    [exp](uint8_t* buf, size_t maxLen, size_t) -> size_t { return exp->fill(buf, maxLen); });
+  req->send(res);
+}
+
+// Cada pedazo del cuerpo (tarea AsyncTCP). Sólo se guarda la línea en curso.
+static void onImportBody(AsyncWebServerRequest* req, uint8_t* data, size_t len,
+                         size_t index, size_t total) {
+  NamesImporter* imp = (NamesImporter*)req->_tempObject;
+  if (index == 0 && !imp) {
+    NamesFormat fmt;
+    // text/plain y form-urlencoded no llegan acá: la librería los parsea como parámetros
+    if (!requestFormat(req, req->contentType(), fmt)) return;          // 415 en onImport
+    if (s_importBusy.exchange(true)) return;                          // 409 en onImport
+    void* mem = malloc(sizeof(NamesImporter));
+    if (!mem) { s_importBusy = false; return; }
+    imp = new (mem) NamesImporter();
+    imp->begin(*s_names, fmt);
+    req->_tempObject = imp;
+    // cliente cortado a mitad del cuerpo: liberar el turno
+    req->onDisconnect([req]() {
+      NamesImporter* i = (NamesImporter*)req->_tempObject;
+      if (i && i->active()) { i->abort(); s_importBusy = false; }
+    });
+  }
+  if (!imp || !imp->active()) return;
+  imp->feed(data, len);
+  if (index + len >= total) {
+    imp->finish();
+    s_importBusy = false;
+  }
+}
+
+static void onImport(AsyncWebServerRequest* req) {
+  NamesImporter* imp = (NamesImporter*)req->_tempObject;
+  if (!imp) {
+    NamesFormat fmt;
+    if (!requestFormat(req, req->contentType(), fmt))
+      req->send(415, "application/json", "{\"error\":\"use Content-Type text/csv or application/x-ndjson\"}");
+    else if (s_importBusy)
+      req->send(409, "application/json", "{\"error\":\"import in progress\"}");
+    else
+      req->send(400, "application/json", "{\"error\":\"empty body\"}");
+    return;
+  }
+  char body[160];
+  snprintf(body, sizeof(body),
+           "{\"format\":\"%s\",\"lines\":%u,\"imported\":%u,\"errors\":%u,\"firstErrorLine\":%u}",
+           imp->format() == NamesFormat::Csv ? "csv" : "ndjson", (unsigned)imp->lines(),
+           (unsigned)imp->imported(), (unsigned)imp->errors(), (unsigned)imp->firstErrorLine());
+  const bool none = imp->imported() == 0 && imp->errors() > 0;
+  req->send(none ? 400 : 200, "application/json", body);
+}
+
+void initNamesApi(AsyncWebServer& server, NamesModel& names) {
+  s_names = &names;
+  server.on("/fp/users", HTTP_GET, onExport);
+  server.on("/fp/users", HTTP_POST, onImport, nullptr, onImportBody);
+}
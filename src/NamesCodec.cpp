@@ -0,0 +1,263 @@
+#include "NamesCodec.h"
+
+// ===================== parseo =====================
+static const char* skipWs(const char* p) {
+  while (*p == ' ' || *p == '\t') ++p;
+  return p;
+}
+
+static bool parseId(const char*& p, uint16_t& id) {
+  p = skipWs(p);
+  if (*p < '0' || *p > '9') return false;
+  uint32_t v = 0;
+  while (*p >= '0' && *p <= '9') {
+    v = v * 10 + (uint32_t)(*p++ - '0');
+    if (v >= NamesModel::MAX_ID) return false;
+  }
+  id = (uint16_t)v;
+  return true;
+}
+
+// Agrega un byte a `name` respetando el tamaño; los bytes que no entran se
+// descartan (NamesModel::set trunca igual a NAME_MAX).
+static inline void put(char* name, size_t n, size_t& k, char c) {
+  if (k + 1 < n) name[k++] = c;
+}
+
+// CSV: `id,nombre` o `id,"nombre, con ""comillas"""`
+static bool parseCsv(const char* p, uint16_t& id, char* name, size_t n) {
+  if (!parseId(p, id)) return false;
+  p = skipWs(p);
+  if (*p++ != ',') return false;
+  p = skipWs(p);
+  size_t k = 0;
+  if (*p == '"') {
+    for (++p;; ++p) {
+      if (!*p) return false;                       // comilla sin cerrar
+      if (*p == '"') {
+        if (p[1] != '"') break;
+        ++p;
+      }
+      put(name, n, k, *p);
+    }
+    if (*skipWs(p + 1)) return false;              // basura después de la comilla
+  } else {
+    for (; *p; ++p) put(name, n, k, *p);
+    while (k && (name[k - 1] == ' ' || name[k - 1] == '\t')) --k;
+  }
+  name[k] = '\0';
+  return true;
+}
+
+static int hexVal(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// String JSON desde la comilla de apertura; `out` puede ser nullptr (saltear).
+static bool parseJsonString(const char*& p, char* out, size_t n) {
+  if (*p++ != '"') return false;
+  size_t k = 0;
+  char dummy[1];
+  if (!out) { out = dummy; n = 1; }
+  for (;;) {
+    char c = *p++;
+    if (!c) return false;
+    if (c == '"') break;
+    if (c != '\\') { put(out, n, k, c); continue; }
+    c = *p++;
+    switch (c) {
+      case '"': case '\\': case '/': put(out, n, k, c); break;
+      case 'b': put(out, n, k, '\b'); break;
+      case 'f': put(out, n, k, '\f'); break;
+      case 'n': put(out, n, k, '\n'); break;
+      case 'r': put(out, n, k, '\r'); break;
+      case 't': put(out, n, k, '\t'); break;
+      case 'u': {
+        uint32_t cp = 0;
+        for (int i = 0; i < 4; ++i) {
+          const int h = hexVal(*p++);
+          if (h < 0) return false;
+          cp = (cp << 4) | (uint32_t)h;
+        }
+        // sólo el plano básico; los surrogates quedan como '?'
+        if (cp < 0x80) put(out, n, k, (char)cp);
+        else if (cp < 0x800) { put(out, n, k, (char)(0xC0 | (cp >> 6))); put(out, n, k, (char)(0x80 | (cp & 0x3F))); }
+        else if (cp >= 0xD800 && cp <= 0xDFFF) put(out, n, k, '?');
+        else {
+          put(out, n, k, (char)(0xE0 | (cp >> 12)));
+          put(out, n, k, (char)(0x80 | ((cp >> 6) & 0x3F)));
+          put(out, n, k, (char)(0x80 | (cp & 0x3F)));
+        }
+        break;
+      }
+      default: return false;
+    }
+  }
+  out[k] = '\0';
+  return true;
+}
+
+// Valor escalar que no nos interesa (número, true/false/null o string)
+static bool skipJsonValue(const char*& p) {
+  if (*p == '"') return parseJsonString(p, nullptr, 0);
+  const char* s = p;
+  while (*p && *p != ',' && *p != '}' && *p != ' ' && *p != '\t') {
+    if (*p == '{' || *p == '[') return false;      // objetos anidados: no
+    ++p;
+  }
+  return p != s;
+}
+
+// NDJSON: {"id":12,"name":"Ana"} (otras claves escalares se ignoran)
+static bool parseNdjson(const char* p, uint16_t& id, char* name, size_t n) {
+  bool haveId = false, haveName = false;
+  char key[8];
+  p = skipWs(p);
+  if (*p++ != '{') return false;
+  p = skipWs(p);
+  if (*p == '}') return false;
+  for (;;) {
+    if (!parseJsonString(p, key, sizeof(key))) return false;
+    p = skipWs(p);
+    if (*p++ != ':') return false;
+    p = skipWs(p);
+    if (!strcmp(key, "id")) {
+      if (!parseId(p, id)) return false;
+      haveId = true;
+    } else if (!strcmp(key, "name")) {
+      if (!parseJsonString(p, name, n)) return false;
+      haveName = true;
+    } else if (!skipJsonValue(p)) {
+      return false;
+    }
+    p = skipWs(p);
+    if (*p == '}') break;
+    if (*p++ != ',') return false;
+    p = skipWs(p);
+  }
+  if (*skipWs(p + 1)) return false;
+  return haveId && haveName;
+}
+
+bool parseNameLine(NamesFormat fmt, const char* line, uint16_t& id, char* name, size_t n) {
+  return fmt == NamesFormat::Csv ? parseCsv(line, id, name, n) : parseNdjson(line, id, name, n);
+}
+
+// ===================== formato =====================
+size_t formatNameLine(NamesFormat fmt, uint16_t id, const char* name, char* out, size_t n) {
+  int k = snprintf(out, n, fmt == NamesFormat::Csv ? "%u," : "{\"id\":%u,\"name\":\"", (unsigned)id);
+  if (k < 0 || (size_t)k >= n) return 0;
+  size_t o = (size_t)k;
+  auto emit = [&](char c) { if (o + 1 < n) out[o++] = c; };
+
+  if (fmt == NamesFormat::Csv) {
+    const size_t len = strlen(name);
+    const bool quote = strpbrk(name, ",\"\r\n") || (len && (name[0] == ' ' || name[len - 1] == ' '));
+    if (quote) emit('"');
+    for (const char* p = name; *p; ++p) {
+      if (*p == '"') emit('"');
+      emit(*p);
+    }
+    if (quote) emit('"');
+  } else {
+    for (const char* p = name; *p; ++p) {
+      const uint8_t c = (uint8_t)*p;
+      if (c == '"' || c == '\\') { emit('\\'); emit((char)c); }
+      else if (c < 0x20) {
+        char esc[7];
+        snprintf(esc, sizeof(esc), "\\u%04x", c);
+        for (const char* e = esc; *e; ++e) emit(*e);
+      } else emit((char)c);
+    }
+    emit('"'); emit('}');
+  }
+  emit('\n');
+  out[o] = '\0';
+  return o;
+}
+
+// ===================== importador =====================
+void NamesImporter::begin(NamesModel& names, NamesFormat fmt) {
+  _names = &names;
+  _fmt = fmt;
+  _len = 0;
+  _overflow = false;
+  _imported = _errors = 0;
+  _lines = _firstError = 0;
+  _active = true;
+}
+
+void NamesImporter::feed(const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    const char c = (char)data[i];
+    if (c == '\n') { line(); continue; }
+    if (_len + 1 < LINE_MAX) _buf[_len++] = c;
+    else _overflow = true;
+  }
+}
+
+void NamesImporter::finish() {
+  if (_len || _overflow) line();
+  abort();
+}
+
+void NamesImporter::abort() {
+  _len = 0;
+  _overflow = false;
+  _active = false;
+}
+
+void NamesImporter::line() {
+  ++_lines;
+  while (_len && (_buf[_len - 1] == '\r' || _buf[_len - 1] == ' ')) --_len;
+  _buf[_len] = '\0';
+  const bool overflow = _overflow;
+  _len = 0;
+  _overflow = false;
+  if (!overflow && _buf[0] == '\0') return;                     // línea vacía
+
+  uint16_t id;
+  char name[NamesModel::NAME_MAX * 2 + 2];   // truncar después, en set()
+  if (!overflow && parseNameLine(_fmt, _buf, id, name, sizeof(name)) && _names->set(id, name)) {
+    ++_imported;
+    return;
+  }
+  // CSV: una primera línea que no empieza con número es el encabezado
+  if (_fmt == NamesFormat::Csv && _lines == 1 && !overflow) {
+    const char* p = skipWs(_buf);
+    if (*p < '0' || *p > '9') return;
+  }
+  if (!_errors) _firstError = _lines;
+  ++_errors;
+}
+
+// ===================== exportador =====================
+size_t NamesExporter::fill(uint8_t* out, size_t maxLen) {
+  size_t o = 0;
+  while (o < maxLen) {
+    if (_lineOff == _lineLen) {
+      _lineOff = _lineLen = 0;
+      if (_header) {
+        _header = false;
+        if (_fmt == NamesFormat::Csv) {
+          _lineLen = strlcpy(_line, "id,name\n", sizeof(_line));
+          continue;
+        }
+      }
+      char name[NamesModel::NAME_MAX + 1];
+      const uint16_t id = _names.next(_nextId, name, sizeof(name));
+      if (id >= NamesModel::MAX_ID) break;
+      _nextId = id + 1;
+      _lineLen = formatNameLine(_fmt, id, name, _line, sizeof(_line));
+      continue;
+    }
+    const size_t c = min(maxLen - o, _lineLen - _lineOff);
+    memcpy(out + o, _line + _lineOff, c);
+    o += c;
+    _lineOff += c;
+  }
+  return o;
+}
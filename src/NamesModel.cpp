@@ -0,0 +1,146 @@
+#include "NamesModel.h"
+#include "Log.h"
+#include "Util.h"
+
+bool NamesModel::begin() {
+  if (!_lock) _lock = xSemaphoreCreateMutex();
+  MutexGuard g(_lock);
+  for (uint16_t i = 0; i < MAX_ID; ++i) _off[i] = NONE;
+  _used = _live = 0;
+  _count = _spilled = 0;
+  if (!_prefs.begin("users", false)) return false;
+  loadAll();
+  LOGI("[names] %u nombres, arena %u/%u bytes", (unsigned)_count, (unsigned)_used, (unsigned)FP_NAMES_ARENA);
+  return true;
+}
+
+// Lee el valor de `key` truncado a NAME_MAX. Preferences::getString(char*)
+// falla si no entra en el buffer (nombres guardados antes del límite).
+static void readNvs(Preferences& prefs, const char* key, char* out, size_t n) {
+  if (prefs.getString(key, out, n)) return;
+  strlcpy(out, prefs.getString(key, "").c_str(), n);
+}
+
+// Recorre sólo las claves existentes del namespace (nvs_entry_find) en vez de
+// consultar los MAX_ID ids uno por uno.
+void NamesModel::loadAll() {
+  char name[NAME_MAX + 1];
+  nvs_iterator_t it = nvs_entry_find(NVS_DEFAULT_PART_NAME, "users", NVS_TYPE_STR);
+  while (it) {
+    nvs_entry_info_t info;
+    nvs_entry_info(it, &info);
+    unsigned id = 0;
+    if (sscanf(info.key, "id%u", &id) == 1 && id < MAX_ID) {
+      readNvs(_prefs, info.key, name, sizeof(name));
+      store((uint16_t)id, name, strlen(name));
+    }
+    it = nvs_entry_next(it);
+  }
+}
+
+const char* NamesModel::get(uint16_t id) { return lookup(id); }
+
+bool NamesModel::copy(uint16_t id, char* out, size_t n) {
+  MutexGuard g(_lock);
+  const char* s = lookup(id);
+  strlcpy(out, s, n);
+  return *s != '\0';
+}
+
+uint16_t NamesModel::next(uint16_t from, char* out, size_t n) {
+  MutexGuard g(_lock);
+  for (uint16_t id = from; id < MAX_ID; ++id) {
+    if (_off[id] == NONE) continue;
+    strlcpy(out, lookup(id), n);
+    return id;
+  }
+  return MAX_ID;
+}
+
+const char* NamesModel::lookup(uint16_t id) {
+  if (id >= MAX_ID || _off[id] == NONE) return "";
+  if (_off[id] == SPILL) {
+    char key[8]; keyFor(id, key);
+    readNvs(_prefs, key, _scratch, sizeof(_scratch));
+    return _scratch;
+  }
+  return _arena + _off[id] + HDR;
+}
+
+bool NamesModel::set(uint16_t id, const char* name) {
+  if (id >= MAX_ID) return false;
+  // copia: `name` puede apuntar a la arena (p.ej. get() de otro id)
+  char buf[NAME_MAX + 1];
+  size_t len = strlcpy(buf, name ? name : "", sizeof(buf));
+  if (len >= sizeof(buf)) {
+    // truncado: no dejar una secuencia UTF-8 a medias
+    len = NAME_MAX;
+    while (len && ((uint8_t)name[len] & 0xC0) == 0x80) --len;
+    buf[len] = '\0';
+  }
+  MutexGuard g(_lock);
+  if (_off[id] != SPILL && strcmp(lookup(id), buf) == 0) return true;   // sin cambios: no tocar NVS
+
+  char key[8]; keyFor(id, key);
+  bool ok;
+  if (len == 0) {
+    if (_off[id] == NONE) return true;
+    ok = _prefs.remove(key);
+  } else {
+    ok = _prefs.putString(key, buf) > 0;
+  }
+  if (!ok) return false;
+  if (!store(id, buf, len))
+    LOGI("[names] arena llena: id %u se leerá de NVS", (unsigned)id);
+  return true;
+}
+
+// Sólo RAM. false si no entró en la arena (queda SPILL).
+bool NamesModel::store(uint16_t id, const char* name, size_t len) {
+  drop(id);
+  if (len == 0) return true;
+  if (len > NAME_MAX) len = NAME_MAX;
+  const size_t need = HDR + len + 1;
+  if (_used + need > sizeof(_arena)) compact();
+  ++_count;
+  if (_used + need > sizeof(_arena)) {
+    _off[id] = SPILL;
+    ++_spilled;
+    return false;
+  }
+  char* r = _arena + _used;
+  r[0] = (char)(id & 0xFF);
+  r[1] = (char)(id >> 8);
+  r[2] = (char)len;
+  memcpy(r + HDR, name, len);
+  r[HDR + len] = '\0';
+  _off[id] = (uint16_t)_used;
+  _used += need;
+  _live += need;
+  return true;
+}
+
+void NamesModel::drop(uint16_t id) {
+  const uint16_t off = _off[id];
+  if (off == NONE) return;
+  if (off == SPILL) --_spilled;
+  else _live -= HDR + (uint8_t)_arena[off + 2] + 1;
+  _off[id] = NONE;
+  --_count;
+}
+
+// Desliza los registros vigentes al principio de la arena, en orden.
+void NamesModel::compact() {
+  size_t w = 0;
+  for (size_t r = 0; r < _used; ) {
+    const uint16_t id = (uint8_t)_arena[r] | ((uint16_t)(uint8_t)_arena[r + 1] << 8);
+    const size_t size = HDR + (uint8_t)_arena[r + 2] + 1;
+    if (_off[id] == r) {
+      if (w != r) memmove(_arena + w, _arena + r, size);
+      _off[id] = (uint16_t)w;
+      w += size;
+    }
+    r += size;
+  }
+  _used = w;
+}
@@ -0,0 +1,33 @@
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "PolicyApi.h"
+
+static MatchPolicy* s_policy = nullptr;
+
+static int intParam(AsyncWebServerRequest* req, const char* name, int def) {
+  return req->hasParam(name) ? (int)req->getParam(name)->value().toInt() : def;
+}
+
+static void onPolicy(AsyncWebServerRequest* req) {
+  if (req->hasParam("rules")) {
+    if (!s_policy->configure(req->getParam("rules")->value().c_str())) {
+      req->send(400, "application/json", "{\"error\":\"bad rules\"}");
+      return;
+    }
+  } else if (req->hasParam("reset") && req->getParam("reset")->value() == "1") {
+    s_policy->resetStats();
+  }
+  const bool effective = req->hasParam("user") || req->hasParam("zone") || req->hasParam("hour");
+  char body[512];
+  if (!s_policy->statsJson(body, sizeof(body), effective, intParam(req, "user", -1), intParam(req, "zone", -1),
+                           intParam(req, "hour", MatchPolicy::localHour()))) {
+    req->send(500, "application/json", "{\"error\":\"stats too large\"}");
+    return;
+  }
+  req->send(200, "application/json", body);
+}
+
+void initPolicyApi(AsyncWebServer& server, MatchPolicy& policy) {
+  s_policy = &policy;
+  server.on("/fp/policy", HTTP_GET, onPolicy);
+}
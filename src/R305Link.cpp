@@ -0,0 +1,74 @@
+#include "R305Link.h"
+#include <Adafruit_Fingerprint.h>
+
+void R305Link::writePacket(uint8_t pid, const uint8_t* data, uint16_t len) {
+  const uint16_t plen = len + 2;
+  const uint8_t head[9] = {0xEF, 0x01,
+                           (uint8_t)(_addr >> 24), (uint8_t)(_addr >> 16),
+                           (uint8_t)(_addr >> 8),  (uint8_t)_addr,
+                           pid, (uint8_t)(plen >> 8), (uint8_t)plen};
+  uint16_t sum = pid + (plen >> 8) + (plen & 0xFF);
+  for (uint16_t i = 0; i < len; ++i) sum += data[i];
+  const uint8_t tail[2] = {(uint8_t)(sum >> 8), (uint8_t)sum};
+  _s.write(head, sizeof(head));
+  if (len) _s.write(data, len);
+  _s.write(tail, sizeof(tail));
+}
+
+int R305Link::readByte(unsigned long deadline) {
+  while (!_s.available()) {
+    if ((long)(millis() - deadline) >= 0) return -1;
+    delay(1);
+  }
+  return _s.read();
+}
+
+bool R305Link::readPacket(uint8_t& pid, uint8_t* data, uint16_t cap, uint16_t& len, uint32_t timeoutMs) {
+  const unsigned long deadline = millis() + timeoutMs;
+  // sincronizar con EF 01
+  int b, prev = -1;
+  for (;;) {
+    if ((b = readByte(deadline)) < 0) return false;
+    if (prev == 0xEF && b == 0x01) break;
+    prev = b;
+  }
+  uint8_t head[7];                          // dirección:4 pid:1 largo:2
+  for (uint8_t i = 0; i < sizeof(head); ++i) {
+    if ((b = readByte(deadline)) < 0) return false;
+    head[i] = (uint8_t)b;
+  }
+  pid = head[4];
+  const uint16_t plen = (uint16_t)((head[5] << 8) | head[6]);
+  if (plen < 2) { ++_bad; return false; }
+  len = plen - 2;
+
+  uint16_t sum = pid + head[5] + head[6];
+  for (uint16_t i = 0; i < len; ++i) {
+    if ((b = readByte(deadline)) < 0) return false;
+    if (i < cap) data[i] = (uint8_t)b;
+    sum += (uint8_t)b;
+  }
+  uint16_t chk = 0;
+  for (uint8_t i = 0; i < 2; ++i) {
+    if ((b = readByte(deadline)) < 0) return false;
+    chk = (uint16_t)((chk << 8) | (uint8_t)b);
+  }
+  if (chk != sum || len > cap) { ++_bad; return false; }
+  return true;
+}
+
+uint8_t R305Link::command(const uint8_t* cmd, uint16_t n, uint8_t* reply, uint16_t cap,
+                          uint16_t* replyLen, uint32_t timeoutMs) {
+  writePacket(PID_COMMAND, cmd, n);
+  uint8_t buf[64];
+  uint8_t pid;
+  uint16_t len;
+  const uint32_t bad0 = _bad;
+  if (!readPacket(pid, buf, sizeof(buf), len, timeoutMs))
+    return _bad != bad0 ? FINGERPRINT_PACKETRECIEVEERR : FINGERPRINT_TIMEOUT;
+  if (pid != PID_ACK || len < 1) return FINGERPRINT_PACKETRECIEVEERR;
+  const uint16_t rest = min<uint16_t>(len - 1, cap);
+  if (reply && rest) memcpy(reply, buf + 1, rest);
+  if (replyLen) *replyLen = rest;
+  return buf[0];
+}
@@ -0,0 +1,204 @@
+#include "ScanMetrics.h"
+#include "Util.h"
+
+// Límites superiores de los buckets en µs: serie 1-1,5-2-3-5-7,5 por década
+// de 1 ms a 30 s; después de ellos va +Inf
+static const uint32_t BUCKET_US[] = {
+  1000, 1500, 2000, 3000, 5000, 7500, 10000, 15000, 20000, 30000, 50000, 75000,
+  100000, 150000, 200000, 300000, 500000, 750000, 1000000, 1500000, 2000000,
+  3000000, 5000000, 7500000, 10000000, 15000000, 20000000, 30000000};
+static constexpr uint8_t BUCKETS = sizeof(BUCKET_US) / sizeof(BUCKET_US[0]) + 1;
+static constexpr uint8_t STAGES = (uint8_t)MetricStage::COUNT;
+static constexpr uint8_t COUNTERS = (uint8_t)MetricCounter::COUNT;
+static constexpr uint8_t MODES = (uint8_t)MetricMode::COUNT;
+static constexpr int64_t PEOPLE_MAX_AGE_US = 5LL * 60 * 1000000;
+
+static const char* const STAGE_NAMES[STAGES] = {
+  "finger_wait", "queue", "get_image", "image2tz", "search", "job", "deliver", "result", "total"};
+static const char* const COUNTER_NAMES[COUNTERS] = {
+  "requested", "match", "no_match", "sensor_error", "match_timeout", "request_expired", "queue_drop",
+  "capture_retry", "retry_recovered"};
+static const char* const MODE_NAMES[MODES] = {"interactive", "freerun"};
+
+struct Histogram {
+  uint32_t buckets[BUCKETS];   // no acumulados; el texto Prometheus los acumula
+  uint32_t count;
+  uint32_t minUs, maxUs;
+  uint64_t sumUs;
+};
+
+static Histogram s_hist[STAGES];
+static uint32_t  s_counters[COUNTERS];
+
+// últimas PEOPLE_WINDOW personas por modo (anillo de esp_timer)
+struct PeopleRing {
+  int64_t  atUs[PEOPLE_WINDOW];
+  uint32_t total;              // atUs[(total - 1) % PEOPLE_WINDOW] = la última
+};
+static PeopleRing s_people[MODES];
+static SemaphoreHandle_t s_lock = nullptr;
+
+
+void fpMetricsBegin() {
+  if (!s_lock) s_lock = xSemaphoreCreateMutex();
+}
+
+void fpMetricsRecord(MetricStage stage, uint32_t us) {
+  if (stage >= MetricStage::COUNT) return;
+  uint8_t b = 0;
+  while (b < BUCKETS - 1 && us > BUCKET_US[b]) ++b;
+  MutexGuard g(s_lock);
+  Histogram& h = s_hist[(uint8_t)stage];
+  ++h.buckets[b];
+  if (!h.count++ || us < h.minUs) h.minUs = us;
+  h.sumUs += us;
+  if (us > h.maxUs) h.maxUs = us;
+}
+
+void fpMetricsCount(MetricCounter c) {
+  if (c >= MetricCounter::COUNT) return;
+  MutexGuard g(s_lock);
+  ++s_counters[(uint8_t)c];
+}
+
+void fpMetricsPerson(MetricMode mode) {
+  if (mode >= MetricMode::COUNT) return;
+  const int64_t now = esp_timer_get_time();
+  MutexGuard g(s_lock);
+  PeopleRing& r = s_people[(uint8_t)mode];
+  r.atUs[r.total++ % PEOPLE_WINDOW] = now;
+}
+
+static float peoplePerMin(const PeopleRing& r, int64_t now) {
+  const uint32_t n = r.total < PEOPLE_WINDOW ? r.total : PEOPLE_WINDOW;
+  if (n < 2) return 0.0f;
+  const int64_t last = r.atUs[(r.total - 1) % PEOPLE_WINDOW];
+  if (now - last > PEOPLE_MAX_AGE_US) return 0.0f;
+  // la más vieja que sigue dentro de los 5 min
+  uint32_t k = n - 1;
+  int64_t first = last;
+  for (uint32_t i = 1; i < n; ++i) {
+    const int64_t t = r.atUs[(r.total - 1 - i) % PEOPLE_WINDOW];
+    if (now - t > PEOPLE_MAX_AGE_US) { k = i - 1; break; }
+    first = t;
+  }
+  if (!k || last <= first) return 0.0f;
+  return k * 60e6f / (float)(last - first);
+}
+
+float fpMetricsPeoplePerMin(MetricMode mode) {
+  if (mode >= MetricMode::COUNT) return 0.0f;
+  const int64_t now = esp_timer_get_time();
+  MutexGuard g(s_lock);
+  return peoplePerMin(s_people[(uint8_t)mode], now);
+}
+
+uint32_t fpMetricsPeople(MetricMode mode) {
+  if (mode >= MetricMode::COUNT) return 0;
+  MutexGuard g(s_lock);
+  return s_people[(uint8_t)mode].total;
+}
+
+void fpMetricsReset() {
+  MutexGuard g(s_lock);
+  memset(s_hist, 0, sizeof(s_hist));
+  memset(s_counters, 0, sizeof(s_counters));
+  memset(s_people, 0, sizeof(s_people));
+}
+
+static uint32_t quantileOf(const Histogram& h, float q) {
+  if (!h.count) return 0;
+  const float rank = q * h.count;
+  uint32_t below = 0;
+  for (uint8_t b = 0; b < BUCKETS; ++b) {
+    if (below + h.buckets[b] < rank || !h.buckets[b]) { below += h.buckets[b]; continue; }
+    // el bucket acotado a lo observado: con todas las muestras en uno solo
+    // (caso común: etapas casi constantes) no se inventa el ancho entero
+    float lo = b ? (float)BUCKET_US[b - 1] : 0.0f;
+    float hi = b < BUCKETS - 1 ? (float)BUCKET_US[b] : (float)h.maxUs;
+    if (lo < h.minUs) lo = (float)h.minUs;
+    if (hi > h.maxUs) hi = (float)h.maxUs;
+    return (uint32_t)(lo + (hi - lo) * (rank - below) / h.buckets[b]);
+  }
+  return h.maxUs;
+}
+
+uint32_t fpMetricsQuantileUs(MetricStage stage, float q) {
+  if (stage >= MetricStage::COUNT) return 0;
+  MutexGuard g(s_lock);
+  return quantileOf(s_hist[(uint8_t)stage], q);
+}
+
+uint32_t fpMetricsSamples(MetricStage stage) {
+  if (stage >= MetricStage::COUNT) return 0;
+  MutexGuard g(s_lock);
+  return s_hist[(uint8_t)stage].count;
+}
+
+void fpMetricsPrometheus(Print& out) {
+  // copia bajo el lock; el texto se arma afuera (puede bloquear en la red)
+  Histogram hist[STAGES];
+  uint32_t counters[COUNTERS];
+  uint32_t people[MODES];
+  float perMin[MODES];
+  {
+    const int64_t now = esp_timer_get_time();
+    MutexGuard g(s_lock);
+    memcpy(hist, s_hist, sizeof(hist));
+    memcpy(counters, s_counters, sizeof(counters));
+    for (uint8_t m = 0; m < MODES; ++m) { people[m] = s_people[m].total; perMin[m] = peoplePerMin(s_people[m], now); }
+  }
+  out.print(F("# HELP fp_stage_seconds Latencia por etapa del pipeline de scan.\n"
+              "# TYPE fp_stage_seconds histogram\n"));
+  for (uint8_t s = 0; s < STAGES; ++s) {
+    const Histogram& h = hist[s];
+    uint32_t cum = 0;
+    for (uint8_t b = 0; b < BUCKETS - 1; ++b) {
+      cum += h.buckets[b];
+      out.printf("fp_stage_seconds_bucket{stage=\"%s\",le=\"%g\"} %u\n",
+                 STAGE_NAMES[s], BUCKET_US[b] / 1e6, (unsigned)cum);
+    }
+    out.printf("fp_stage_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %u\n", STAGE_NAMES[s], (unsigned)h.count);
+    out.printf("fp_stage_seconds_sum{stage=\"%s\"} %.6f\n", STAGE_NAMES[s], h.sumUs / 1e6);
+    out.printf("fp_stage_seconds_count{stage=\"%s\"} %u\n", STAGE_NAMES[s], (unsigned)h.count);
+  }
+  out.print(F("# HELP fp_scans_total Peticiones de scan y cómo terminaron.\n"
+              "# TYPE fp_scans_total counter\n"));
+  for (uint8_t c = 0; c < COUNTERS; ++c)
+    out.printf("fp_scans_total{result=\"%s\"} %u\n", COUNTER_NAMES[c], (unsigned)counters[c]);
+  out.print(F("# HELP fp_people_total Personas atendidas (resultado en pantalla) por modo.\n"
+              "# TYPE fp_people_total counter\n"));
+  for (uint8_t m = 0; m < MODES; ++m)
+    out.printf("fp_people_total{mode=\"%s\"} %u\n", MODE_NAMES[m], (unsigned)people[m]);
+  out.print(F("# HELP fp_people_per_minute Ritmo de las últimas personas atendidas por modo.\n"
+              "# TYPE fp_people_per_minute gauge\n"));
+  for (uint8_t m = 0; m < MODES; ++m)
+    out.printf("fp_people_per_minute{mode=\"%s\"} %.2f\n", MODE_NAMES[m], perMin[m]);
+}
+
+void fpMetricsPrint(Print& out) {
+  Histogram hist[STAGES];
+  uint32_t counters[COUNTERS];
+  uint32_t people[MODES];
+  float perMin[MODES];
+  {
+    const int64_t now = esp_timer_get_time();
+    MutexGuard g(s_lock);
+    memcpy(hist, s_hist, sizeof(hist));
+    memcpy(counters, s_counters, sizeof(counters));
+    for (uint8_t m = 0; m < MODES; ++m) { people[m] = s_people[m].total; perMin[m] = peoplePerMin(s_people[m], now); }
+  }
+  out.printf("%-12s %6s %9s %9s %9s %9s\n", "etapa", "n", "p50 ms", "p99 ms", "max ms", "media ms");
+  for (uint8_t s = 0; s < STAGES; ++s) {
+    const Histogram& h = hist[s];
+    out.printf("%-12s %6u %9.1f %9.1f %9.1f %9.1f\n", STAGE_NAMES[s], (unsigned)h.count,
+               quantileOf(h, 0.5f) / 1000.0, quantileOf(h, 0.99f) / 1000.0, h.maxUs / 1000.0,
+               h.count ? h.sumUs / 1000.0 / h.count : 0.0);
+  }
+  for (uint8_t c = 0; c < COUNTERS; ++c)
+    out.printf("%s%s=%u", c ? " " : "", COUNTER_NAMES[c], (unsigned)counters[c]);
+  out.println();
+  for (uint8_t m = 0; m < MODES; ++m)
+    out.printf("%spersonas %s=%u (%.1f/min)", m ? " " : "", MODE_NAMES[m], (unsigned)people[m], perMin[m]);
+  out.println();
+}
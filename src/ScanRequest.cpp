@@ -1,34 +1,73 @@
 #include "ScanRequest.h"
 #include <Arduino.h>
+#include "EventBus.h"
+#include "ScanMetrics.h"
 
-// almacenamos instante hasta el cual la petición es válida (0 = no)
-static volatile unsigned long s_scanUntil = 0;
+static MpmcRing<ScanTicket, SCAN_QUEUE_LEN> s_queue;
+static std::atomic<uint32_t> s_nextId{1};
+// la activa sólo la toca loop(): sin locks
+static ScanTicket s_active = {};
 
-void requestScan(unsigned long timeoutMs) {
-  noInterrupts();
-  if (timeoutMs == 0) s_scanUntil = (unsigned long)(~0u); // forever
-  else s_scanUntil = millis() + timeoutMs;
-  interrupts();
-  Serial.printf("[scanreq] requestScan timeoutMs=%lu at=%lu until=%lu\n", timeoutMs, (unsigned long)millis(), s_scanUntil);
+static const char* originName(ScanOrigin o) {
+  switch (o) {
+    case ScanOrigin::Serial: return "serial";
+    case ScanOrigin::Http:   return "http";
+    case ScanOrigin::Remote: return "remote";
+  }
+  return "?";
 }
 
-void cancelScan() {
-  noInterrupts();
-  s_scanUntil = 0;
-  interrupts();
-  Serial.printf("[scanreq] cancelScan at=%lu\n", (unsigned long)millis());
+static uint32_t enqueue(unsigned long timeoutMs, ScanOrigin origin, ScanMode mode, int claimed) {
+  ScanTicket t;
+  t.id = s_nextId.fetch_add(1, std::memory_order_relaxed);
+  t.origin = origin;
+  t.mode = mode;
+  t.claimed = claimed;
+  t.deadline = timeoutMs ? millis() + timeoutMs : 0;
+  if (timeoutMs && !t.deadline) t.deadline = 1;            // 0 está reservado para "sin timeout"
+  t.requestedUs = fpMetricsNow();
+  if (!s_queue.push(t)) {
+    fpMetricsCount(MetricCounter::QueueDrop);
+    Serial.printf("[scanreq] cola llena: descartada #%u (%s)\n", (unsigned)t.id, originName(origin));
+    return 0;
+  }
+  fpMetricsCount(MetricCounter::Requests);
+  return t.id;
+}
+
+uint32_t requestScan(unsigned long timeoutMs, ScanOrigin origin) {
+  const uint32_t id = enqueue(timeoutMs, origin, ScanMode::Identify, -1);
+  Serial.printf("[scanreq] requestScan #%u %s timeoutMs=%lu at=%lu\n", (unsigned)id, originName(origin),
+                timeoutMs, (unsigned long)millis());
+  return id;
+}
+
+uint32_t requestVerify(uint16_t userId, unsigned long timeoutMs, ScanOrigin origin) {
+  const uint32_t id = enqueue(timeoutMs, origin, ScanMode::Verify, userId);
+  Serial.printf("[scanreq] requestVerify #%u %s user=%u timeoutMs=%lu at=%lu\n", (unsigned)id,
+                originName(origin), userId, timeoutMs, (unsigned long)millis());
+  return id;
 }
 
+size_t scanQueueDepth() { return s_queue.size(); }
+
 bool isScanRequested() {
-  noInterrupts();
-  unsigned long t = s_scanUntil;
-  interrupts();
-  if (t == 0) return false;
-  if (t == (unsigned long)(~0u)) return true; // forever
-  // si expiró, limpiar y devolver false
-  if ((long)((long)millis() - (long)t) > 0) {
-    cancelScan();
-    return false;
+  for (;;) {
+    if (!s_active.id && !s_queue.pop(s_active)) return false;
+    if (!s_active.deadline || (long)(millis() - s_active.deadline) < 0) return true;
+    // vencida (activa sin dedo o esperando en la cola)
+    fpMetricsCount(MetricCounter::RequestExpired);
+    Serial.printf("[scanreq] #%u vencida at=%lu\n", (unsigned)s_active.id, (unsigned long)millis());
+    s_active.id = 0;
   }
-  return true;
-}
\ No newline at end of file
+}
+
+uint32_t activeRequestId() { return s_active.id; }
+int claimedUser() { return s_active.id ? s_active.claimed : -1; }
+int64_t scanRequestedAtUs() { return s_active.id ? s_active.requestedUs : 0; }
+
+void cancelScan() {
+  if (!s_active.id) return;
+  Serial.printf("[scanreq] fin #%u at=%lu\n", (unsigned)s_active.id, (unsigned long)millis());
+  s_active.id = 0;
+}
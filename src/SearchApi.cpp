@@ -0,0 +1,41 @@
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "SearchApi.h"
+
+static SearchEngine* s_engine = nullptr;
+
+static void onSearch(AsyncWebServerRequest* req) {
+  if (req->hasParam("zones") || req->hasParam("order")) {
+    // sólo `order`: se mantienen las zonas; zonas nuevas sin `order` = todas en orden
+    char zones[SearchEngine::SPEC_MAX];
+    if (req->hasParam("zones")) {
+      const String& z = req->getParam("zones")->value();
+      // truncada quedaría otra lista de rangos, quizás válida
+      if (z.length() >= sizeof(zones)) {
+        req->send(400, "application/json", "{\"error\":\"zones too long\"}");
+        return;
+      }
+      strlcpy(zones, z.c_str(), sizeof(zones));
+    } else {
+      s_engine->zonesSpec(zones, sizeof(zones));
+    }
+    const String order = req->hasParam("order") ? req->getParam("order")->value() : String();
+    if (!s_engine->configure(zones, order.c_str())) {
+      req->send(400, "application/json", "{\"error\":\"bad zones/order\"}");
+      return;
+    }
+  } else if (req->hasParam("reset") && req->getParam("reset")->value() == "1") {
+    s_engine->resetStats();
+  }
+  char body[1280];                          // 8 zonas ~ 1 KB
+  if (!s_engine->statsJson(body, sizeof(body))) {
+    req->send(500, "application/json", "{\"error\":\"stats too large\"}");
+    return;
+  }
+  req->send(200, "application/json", body);
+}
+
+void initSearchApi(AsyncWebServer& server, SearchEngine& engine) {
+  s_engine = &engine;
+  server.on("/fp/search", HTTP_GET, onSearch);
+}
@@ -0,0 +1,195 @@
+#include "SearchEngine.h"
+#include <Preferences.h>
+
+static const char* NVS_NS = "search";
+
+void SearchEngine::lockInit() {
+  if (!_lock) _lock = xSemaphoreCreateMutex();
+}
+
+void SearchEngine::begin() {
+  lockInit();
+  Preferences p;
+  if (!p.begin(NVS_NS, true)) return;        // primera vez: sin namespace
+  char zones[SPEC_MAX] = "", order[SPEC_MAX] = "";
+  p.getString("zones", zones, sizeof(zones));
+  p.getString("order", order, sizeof(order));
+  p.end();
+  if (!configure(zones, order, false))
+    Serial.printf("[search] config NVS inválida: zonas='%s' orden='%s'\n", zones, order);
+}
+
+// "a-b,c-d" (slots inclusive, a <= b). Vacío = sin zonas.
+bool SearchEngine::parseZones(const char* s, SearchRange* out, uint8_t& n) {
+  n = 0;
+  while (*s) {
+    char* end;
+    const unsigned long a = strtoul(s, &end, 10);
+    if (end == s || *end != '-') return false;
+    s = end + 1;
+    const unsigned long b = strtoul(s, &end, 10);
+    if (end == s || b < a || b >= 0xFFFF || n == MAX_ZONES) return false;
+    out[n].start = (uint16_t)a;
+    out[n].count = (uint16_t)(b - a + 1);
+    ++n;
+    s = end;
+    if (*s == ',') ++s;
+    else if (*s) return false;
+  }
+  return true;
+}
+
+// "i,j,..." con zonas existentes, sin repetir. Vacío = todas.
+bool SearchEngine::parseOrder(const char* s, uint8_t zones, uint8_t* out, uint8_t& n) {
+  n = 0;
+  uint16_t seen = 0;
+  while (*s) {
+    char* end;
+    const unsigned long z = strtoul(s, &end, 10);
+    if (end == s || z >= zones || (seen & (1u << z))) return false;
+    seen |= (uint16_t)(1u << z);
+    out[n++] = (uint8_t)z;
+    s = end;
+    if (*s == ',') ++s;
+    else if (*s) return false;
+  }
+  return true;
+}
+
+bool SearchEngine::configure(const char* zones, const char* order, bool persist) {
+  SearchRange z[MAX_ZONES];
+  uint8_t o[MAX_ZONES];
+  uint8_t zn = 0, on = 0;
+  if (!zones) zones = "";
+  if (!order) order = "";
+  if (strlen(zones) >= SPEC_MAX || strlen(order) >= SPEC_MAX) return false;
+  if (!parseZones(zones, z, zn) || !parseOrder(order, zn, o, on)) return false;
+
+  lockInit();
+  {
+    MutexGuard g(_lock);
+    memcpy(_zones, z, sizeof(z));
+    memcpy(_order, o, sizeof(o));
+    _zoneCount = zn;
+    _orderCount = on;
+    for (SearchStats& st : _stats) st = SearchStats{};
+    _searches = _misses = _totalMs = 0;
+  }
+  if (persist) {
+    Preferences p;
+    if (p.begin(NVS_NS, false)) {
+      p.putString("zones", zones);
+      p.putString("order", order);
+      p.end();
+    }
+  }
+  return true;
+}
+
+uint16_t SearchEngine::capacity() {
+  Adafruit_Fingerprint& chip = _fp.chip();
+  if (!chip.capacity) chip.getParameters();
+  return chip.capacity ? chip.capacity : DEFAULT_CAPACITY;
+}
+
+uint8_t SearchEngine::search(uint8_t buf, uint16_t& page, uint16_t& score, int& zone) {
+  // copia del plan: configure() puede cambiarlo mientras se busca
+  SearchRange plan[MAX_ZONES];
+  int8_t ids[MAX_ZONES];
+  uint8_t n = 0;
+  {
+    MutexGuard g(_lock);
+    if (_zoneCount == 0) {
+      ids[n] = -1;
+      plan[n++] = SearchRange{};
+    } else {
+      const uint8_t k = _orderCount ? _orderCount : _zoneCount;
+      for (uint8_t i = 0; i < k; ++i) {
+        ids[n] = (int8_t)(_orderCount ? _order[i] : i);
+        plan[n++] = _zones[ids[i]];
+      }
+    }
+  }
+  if (ids[0] < 0) {
+    plan[0].count = capacity();
+    MutexGuard g(_lock);
+    _capacity = plan[0].count;
+  }
+
+  const unsigned long t0 = millis();
+  uint8_t rc = FINGERPRINT_NOTFOUND;
+  zone = -1;
+  for (uint8_t i = 0; i < n; ++i) {
+    const unsigned long ts = millis();
+    rc = _fp.searchRange(buf, plan[i].start, plan[i].count, page, score);
+    const uint32_t ms = millis() - ts;
+    {
+      MutexGuard g(_lock);
+      SearchStats& st = _stats[ids[i] < 0 ? MAX_ZONES : ids[i]];
+      ++st.searches;
+      st.totalMs += ms;
+      if (ms > st.maxMs) st.maxMs = ms;
+      if (rc == FINGERPRINT_OK) ++st.hits;
+    }
+    if (rc == FINGERPRINT_OK) { zone = ids[i]; break; }
+    if (rc != FINGERPRINT_NOTFOUND) break;
+  }
+  MutexGuard g(_lock);
+  ++_searches;
+  _totalMs += millis() - t0;
+  if (rc != FINGERPRINT_OK) ++_misses;
+  return rc;
+}
+
+void SearchEngine::resetStats() {
+  lockInit();
+  MutexGuard g(_lock);
+  for (SearchStats& st : _stats) st = SearchStats{};
+  _searches = _misses = _totalMs = 0;
+}
+
+void SearchEngine::zonesSpec(char* out, size_t n) {
+  MutexGuard g(_lock);
+  size_t w = 0;
+  out[0] = '\0';
+  for (uint8_t i = 0; i < _zoneCount; ++i)
+    appendf(out, n, w, "%s%u-%u", i ? "," : "", _zones[i].start, _zones[i].start + _zones[i].count - 1);
+}
+
+void SearchEngine::orderSpec(char* out, size_t n) {
+  MutexGuard g(_lock);
+  size_t w = 0;
+  out[0] = '\0';
+  for (uint8_t i = 0; i < _orderCount; ++i) appendf(out, n, w, "%s%u", i ? "," : "", _order[i]);
+}
+
+static void zoneJson(char* out, size_t n, size_t& w, int id, const SearchRange& r, const SearchStats& st) {
+  appendf(out, n, w,
+          "{\"zone\":%d,\"start\":%u,\"count\":%u,\"searches\":%u,\"hits\":%u,"
+          "\"hitRate\":%.3f,\"avgMs\":%.1f,\"maxMs\":%u}",
+          id, r.start, r.count, (unsigned)st.searches, (unsigned)st.hits,
+          st.searches ? (double)st.hits / st.searches : 0.0,
+          st.searches ? (double)st.totalMs / st.searches : 0.0, (unsigned)st.maxMs);
+}
+
+size_t SearchEngine::statsJson(char* out, size_t n) {
+  lockInit();
+  MutexGuard g(_lock);
+  size_t w = 0;
+  appendf(out, n, w, "{\"capacity\":%u,\"zones\":[", _capacity);
+  if (_zoneCount == 0) {
+    SearchRange all;
+    all.count = _capacity;
+    zoneJson(out, n, w, -1, all, _stats[MAX_ZONES]);
+  }
+  for (uint8_t i = 0; i < _zoneCount; ++i) {
+    if (i) appendf(out, n, w, ",");
+    zoneJson(out, n, w, i, _zones[i], _stats[i]);
+  }
+  appendf(out, n, w, "],\"order\":[");
+  for (uint8_t i = 0; i < _orderCount; ++i) appendf(out, n, w, "%s%u", i ? "," : "", _order[i]);
+  appendf(out, n, w, "],\"searches\":%u,\"misses\":%u,\"avgMs\":%.1f}", (unsigned)_searches,
+          (unsigned)_misses, _searches ? (double)_totalMs / _searches : 0.0);
+  if (w >= n) { if (n) out[0] = '\0'; return 0; }
+  return w;
+}
@@ -0,0 +1,42 @@
+#include "SensorWorker.h"
+
+bool SensorWorker::begin(bool spawnTask, UBaseType_t queueLen, SemaphoreHandle_t uartLock) {
+  if (_queue) return true;
+  _uartLock = uartLock;
+  _queue = xQueueCreate(queueLen, sizeof(SensorJob));
+  if (!_queue) return false;
+  if (!spawnTask) return true;
+  // mismo core/prioridad que usaba la tarea "fingerMatch" por scan
+  return xTaskCreatePinnedToCore(&SensorWorker::taskEntry, "fpSensor", 8192, this, 1, &_task, 0) == pdPASS;
+}
+
+uint32_t SensorWorker::submit(SensorJobFn run, SensorDoneFn done, void* ctx) {
+  if (!_queue || !run) return 0;
+  uint32_t seq = _seq.fetch_add(1, std::memory_order_relaxed) + 1;
+  if (seq == 0) seq = _seq.fetch_add(1, std::memory_order_relaxed) + 1;   // 0 = "sin job"
+  SensorJob job{seq, run, done, ctx};
+  if (xQueueSend(_queue, &job, 0) != pdTRUE) {
+    _rejected.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+  }
+  return seq;
+}
+
+bool SensorWorker::pump(TickType_t wait) {
+  if (!_queue) return false;
+  SensorJob job;
+  if (xQueueReceive(_queue, &job, wait) != pdTRUE) return false;
+  SensorResult res;
+  res.seq = job.seq;
+  if (_uartLock) xSemaphoreTakeRecursive(_uartLock, portMAX_DELAY);
+  job.run(job.ctx, res);
+  if (_uartLock) xSemaphoreGiveRecursive(_uartLock);
+  _completed.fetch_add(1, std::memory_order_relaxed);
+  if (job.done) job.done(job.ctx, res);
+  return true;
+}
+
+void SensorWorker::taskEntry(void* arg) {
+  SensorWorker* self = static_cast<SensorWorker*>(arg);
+  for (;;) self->pump(portMAX_DELAY);
+}
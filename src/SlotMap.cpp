@@ -0,0 +1,264 @@
+#include "SlotMap.h"
+#include <Preferences.h>
+
+static const char* NVS_NS = "slots";
+
+uint8_t SlotMap::begin() {
+  if (!_lock) _lock = xSemaphoreCreateMutex();
+  memset(_owner, 0xFF, sizeof(_owner));
+  Adafruit_Fingerprint& chip = _fp.chip();
+  if (chip.getParameters() != FINGERPRINT_OK || !chip.capacity) return FINGERPRINT_PACKETRECIEVEERR;
+  _capacity = min<uint16_t>(chip.capacity, MAX_SLOTS);
+
+  bool haveMap = false;
+  Preferences p;
+  if (p.begin(NVS_NS, true)) {
+    // otra capacidad (cambió el sensor): la tabla no sirve
+    if (p.getBytesLength("owner") == _capacity * sizeof(uint16_t))
+      haveMap = p.getBytes("owner", _owner, _capacity * sizeof(uint16_t)) != 0;
+    p.end();
+  }
+  const uint8_t rc = reconcile(!haveMap);
+  if (rc == FINGERPRINT_OK && !haveMap) _dirty = true;   // dejar registrada la migración
+  save();
+  Serial.printf("[slots] capacidad=%u ocupados=%u huerfanos=%u tabla=%s\n",
+                _capacity, _used, orphans(), haveMap ? "nvs" : "legacy");
+  return rc;
+}
+
+uint8_t SlotMap::sync(bool legacy) {
+  const uint8_t rc = reconcile(legacy);
+  save();
+  return rc;
+}
+
+// Ocupación según el sensor manda; el dueño sale de la tabla o, sin tabla,
+// del layout clásico id*SLOTS_PER_USER.
+uint8_t SlotMap::reconcile(bool legacy) {
+  uint8_t occ[MAX_SLOTS / 8];
+  const uint8_t rc = _fp.readIndex(occ, _capacity);
+  if (rc != FINGERPRINT_OK) return rc;
+  MutexGuard g(_lock);
+  memcpy(_occ, occ, sizeof(occ));
+  _used = 0;
+  for (uint16_t s = 0; s < _capacity; ++s) {
+    if (occupied(s)) {
+      ++_used;
+      if (_owner[s] == NONE) setOwner(s, legacy ? s / FingerprintModel::SLOTS_PER_USER : ORPHAN);
+    } else {
+      setOwner(s, NONE);
+    }
+  }
+  return FINGERPRINT_OK;
+}
+
+void SlotMap::setOwner(uint16_t slot, uint16_t owner) {
+  if (_owner[slot] == owner) return;
+  _owner[slot] = owner;
+  _dirty = true;
+}
+
+bool SlotMap::save() {
+  MutexGuard g(_lock);
+  if (!_dirty || !_capacity) return true;
+  Preferences p;
+  if (!p.begin(NVS_NS, false)) return false;
+  const bool ok = p.putBytes("owner", _owner, _capacity * sizeof(uint16_t)) != 0;
+  p.end();
+  if (ok) _dirty = false;
+  return ok;
+}
+
+uint8_t SlotMap::slotsOf(uint16_t user, uint16_t* out, uint8_t max) const {
+  uint8_t n = 0;
+  for (uint16_t s = 0; s < _capacity && n < max; ++s)
+    if (_owner[s] == user) out[n++] = s;
+  return n;
+}
+
+uint8_t SlotMap::runsOf(uint16_t user, SearchRange* out, uint8_t max, uint16_t from) const {
+  uint8_t n = 0;
+  for (uint16_t s = from; s < _capacity; ++s) {
+    if (_owner[s] != user) continue;
+    if (n && out[n - 1].start + out[n - 1].count == s) { ++out[n - 1].count; continue; }
+    if (n == max) break;
+    out[n].start = s;
+    out[n].count = 1;
+    ++n;
+  }
+  return n;
+}
+
+uint16_t SlotMap::orphans() const {
+  uint16_t n = 0;
+  for (uint16_t s = 0; s < _capacity; ++s) n += _owner[s] == ORPHAN;
+  return n;
+}
+
+uint16_t SlotMap::largestFree() const {
+  uint16_t best = 0, run = 0;
+  for (uint16_t s = 0; s < _capacity; ++s) {
+    run = occupied(s) ? 0 : run + 1;
+    if (run > best) best = run;
+  }
+  return best;
+}
+
+bool SlotMap::allocate(uint16_t user, uint8_t n, uint16_t* out) const {
+  if (!n || n > MAX_PER_USER || user > MAX_USER) return false;
+  // re-enrolar: primero los slots que ya tiene
+  uint8_t k = slotsOf(user, out, n);
+  const uint8_t need = n - k;
+  if (!need) return true;
+
+  // primer hueco contiguo de `need` slots
+  uint16_t run = 0;
+  for (uint16_t s = 0; s < _capacity; ++s) {
+    run = occupied(s) ? 0 : run + 1;
+    if (run == need) {
+      for (uint16_t i = s + 1 - need; i <= s; ++i) out[k++] = i;
+      return true;
+    }
+  }
+  // sin hueco: los primeros libres, sueltos
+  for (uint16_t s = 0; s < _capacity && k < n; ++s)
+    if (!occupied(s)) out[k++] = s;
+  return k == n;
+}
+
+void SlotMap::assign(uint16_t slot, uint16_t user) {
+  if (slot >= _capacity) return;
+  MutexGuard g(_lock);
+  if (!occupied(slot)) { _occ[slot / 8] |= (uint8_t)(1u << (slot % 8)); ++_used; }
+  setOwner(slot, user);
+}
+
+void SlotMap::release(uint16_t slot) {
+  if (slot >= _capacity) return;
+  MutexGuard g(_lock);
+  if (occupied(slot)) { _occ[slot / 8] &= (uint8_t)~(1u << (slot % 8)); --_used; }
+  setOwner(slot, NONE);
+}
+
+void SlotMap::clear() {
+  {
+    MutexGuard g(_lock);
+    memset(_occ, 0, sizeof(_occ));
+    for (uint16_t s = 0; s < _capacity; ++s) setOwner(s, NONE);
+    _used = 0;
+  }
+  save();
+}
+
+uint8_t SlotMap::removeUser(uint16_t user) {
+  uint8_t rc = FINGERPRINT_OK;
+  for (uint16_t s = 0; s < _capacity; ++s) {
+    if (_owner[s] != user) continue;
+    const uint8_t r = _fp.chip().deleteModel(s);
+    if (r == FINGERPRINT_OK) release(s);
+    else rc = r;
+  }
+  save();
+  return rc;
+}
+
+uint8_t SlotMap::verify(uint16_t user, uint8_t buf, uint16_t& page, uint16_t& score) {
+  // de a MAX_RUNS tramos: con slots sueltos un usuario puede tener hasta
+  // MAX_PER_USER tramos y hay que probarlos todos
+  SearchRange runs[MAX_RUNS];
+  uint16_t from = 0;
+  for (;;) {
+    const uint8_t n = runsOf(user, runs, MAX_RUNS, from);
+    for (uint8_t i = 0; i < n; ++i) {
+      const uint8_t rc = _fp.searchRange(buf, runs[i].start, runs[i].count, page, score);
+      if (rc != FINGERPRINT_NOTFOUND) return rc;
+    }
+    if (n < MAX_RUNS) return FINGERPRINT_NOTFOUND;
+    from = runs[n - 1].start + runs[n - 1].count;
+  }
+}
+
+// Copia la plantilla al slot libre `to` y borra el original
+uint8_t SlotMap::move(uint16_t from, uint16_t to, uint8_t* tpl) {
+  uint16_t len = 0;
+  uint8_t rc = _fp.readTemplate(from, tpl, len);
+  if (rc == FINGERPRINT_OK) rc = _fp.writeTemplate(to, tpl, len);
+  if (rc != FINGERPRINT_OK) return rc;
+  assign(to, _owner[from]);
+  rc = _fp.chip().deleteModel(from);
+  // si no se pudo borrar queda duplicada en `from`: sigue siendo del mismo dueño
+  if (rc == FINGERPRINT_OK) release(from);
+  return rc;
+}
+
+// Primer hueco con plantillas después; false si el espacio libre ya está al final
+bool SlotMap::firstHole(uint16_t& start, uint16_t& len) const {
+  uint16_t s = 0;
+  while (s < _capacity && occupied(s)) ++s;
+  uint16_t e = s;
+  while (e < _capacity && !occupied(e)) ++e;
+  start = s;
+  len = e - s;
+  return e < _capacity;
+}
+
+uint8_t SlotMap::compact(uint16_t* moves) {
+  uint8_t tpl[FingerprintModel::TEMPLATE_MAX];
+  uint16_t moved = 0;
+  uint8_t rc = FINGERPRINT_OK;
+
+  // 1) huecos: traer el último usuario contiguo que entre entero (una copia
+  //    por plantilla en vez de correr a todos los de atrás)
+  uint16_t hole, len;
+  while (rc == FINGERPRINT_OK && firstHole(hole, len)) {
+    uint16_t from = 0, count = 0;
+    for (uint16_t s = _capacity; s > hole + len; ) {
+      if (!occupied(--s)) continue;
+      const uint16_t grp = _owner[s];
+      uint16_t b = s;
+      while (b > 0 && _owner[b - 1] == grp) --b;
+      uint16_t total = 0;
+      for (uint16_t i = 0; i < _capacity; ++i) total += _owner[i] == grp;
+      if (grp != ORPHAN && total == s - b + 1 && total <= len) { from = b; count = total; break; }
+      s = b;
+    }
+    if (!count) break;
+    for (uint16_t i = 0; i < count && rc == FINGERPRINT_OK; ++i)
+      if ((rc = move(from + i, hole + i, tpl)) == FINGERPRINT_OK) ++moved;
+  }
+
+  // 2) lo que no entró en ningún hueco: correr grupos hacia adelante.
+  //    [0, next) ya está compacto; el próximo grupo es el dueño del primer
+  //    slot ocupado desde `next` y sus slots se traen a next, next+1, ...
+  bool full = false;
+  uint16_t next = 0;
+  while (rc == FINGERPRINT_OK && !full) {
+    uint16_t s = next;
+    while (s < _capacity && !occupied(s)) ++s;
+    if (s >= _capacity) break;
+    const uint16_t grp = _owner[s];
+    uint16_t cnt = 0;
+    for (uint16_t i = s; i < _capacity; ++i) cnt += _owner[i] == grp;
+
+    for (uint16_t k = 0; k < cnt && rc == FINGERPRINT_OK; ++k) {
+      const uint16_t dest = next++;
+      if (_owner[dest] == grp) continue;
+      // el último del grupo: los que ya caen en la ventana se quedan
+      uint16_t src = _capacity - 1;
+      while (_owner[src] != grp) --src;
+      if (occupied(dest)) {
+        // ocupado por un grupo posterior: pasarlo al último slot libre
+        uint16_t spare = _capacity;
+        while (spare > dest + 1 && occupied(spare - 1)) --spare;
+        if (spare <= dest + 1) { full = true; break; }   // base llena: no hay dónde correrlo
+        if ((rc = move(dest, spare - 1, tpl)) != FINGERPRINT_OK) break;
+        ++moved;
+      }
+      if ((rc = move(src, dest, tpl)) == FINGERPRINT_OK) ++moved;
+    }
+  }
+  save();
+  if (moves) *moves = moved;
+  Serial.printf("[slots] compactar: %u movidas rc=%u hueco libre=%u\n", moved, rc, largestFree());
+  return rc;
+}
@@ -0,0 +1,132 @@
+#include "TemplateArchive.h"
+
+namespace fpta {
+
+static inline void put16(uint8_t* p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static inline uint16_t get16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+// CRC-32 (zlib): crc32(0, ...) para empezar, se puede encadenar
+uint32_t crc32(uint32_t crc, const uint8_t* p, size_t n) {
+  crc = ~crc;
+  while (n--) {
+    crc ^= *p++;
+    for (int k = 0; k < 8; ++k) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+  }
+  return ~crc;
+}
+
+size_t writeHeader(uint8_t* out, uint16_t count, uint16_t capacity, uint16_t tplBytes) {
+  out[0] = 'F'; out[1] = 'P'; out[2] = 'T'; out[3] = 'A';
+  out[4] = VERSION;
+  out[5] = 0;
+  put16(out + 6, count);
+  put16(out + 8, capacity);
+  put16(out + 10, tplBytes);
+  return HEADER;
+}
+
+size_t writeRecord(uint8_t* out, uint16_t slot, uint16_t user, const uint8_t* data, uint16_t len) {
+  put16(out, slot);
+  put16(out + 2, user);
+  put16(out + 4, len);
+  memcpy(out + RECORD_HEAD, data, len);
+  const uint32_t crc = crc32(0, out, RECORD_HEAD + len);
+  uint8_t* t = out + RECORD_HEAD + len;
+  t[0] = (uint8_t)crc; t[1] = (uint8_t)(crc >> 8); t[2] = (uint8_t)(crc >> 16); t[3] = (uint8_t)(crc >> 24);
+  return RECORD_HEAD + len + RECORD_TAIL;
+}
+
+size_t writeEnd(uint8_t* out, uint16_t records) {
+  put16(out, END_SLOT);
+  put16(out + 2, records);
+  return END;
+}
+
+// ---------- lector ----------
+void Reader::begin(RecordFn fn, void* ctx) {
+  _fn = fn;
+  _ctx = ctx;
+  _state = State::Header;
+  _error = nullptr;
+  _have = 0;
+  _need = HEADER;
+  _version = 0;
+  _announced = _capacity = 0;
+  _records = _badCrc = _rejected = 0;
+}
+
+size_t Reader::feed(const uint8_t* data, size_t len) {
+  size_t used = 0;
+  while (used < len && _state != State::Done && _state != State::Error) {
+    const size_t c = min(len - used, _need - _have);
+    memcpy(_buf + _have, data + used, c);
+    _have += c;
+    used += c;
+    if (_have == _need) onField();
+  }
+  return used;
+}
+
+void Reader::onField() {
+  _have = 0;
+  switch (_state) {
+    case State::Header:
+      if (memcmp(_buf, "FPTA", 4) != 0) return fail("magic");
+      if (_buf[4] != VERSION && _buf[4] != VERSION_V1) return fail("version");
+      _version   = _buf[4];
+      _announced = get16(_buf + 6);
+      _capacity  = get16(_buf + 8);
+      _state = State::RecordHead;
+      _need = END;
+      return;
+
+    case State::RecordHead:
+      // primero 4 B (lo que mide el fin); en v2 un registro trae 2 más
+      _slot = get16(_buf);
+      if (_slot == END_SLOT) {
+        _len = get16(_buf + 2);
+        if (_len != (uint16_t)(_records + _badCrc + _rejected)) return fail("count");
+        _state = State::Done;
+        return;
+      }
+      if (_need < recordHead()) {
+        _have = _need;
+        _need = recordHead();
+        return;
+      }
+      if (_version == VERSION_V1) {
+        _user = NO_USER;
+        _len  = get16(_buf + 2);
+      } else {
+        _user = get16(_buf + 2);
+        _len  = get16(_buf + 4);
+      }
+      if (_len == 0 || _len > MAX_DATA) return fail("length");
+      _state = State::Data;
+      _need = _len + RECORD_TAIL;
+      return;
+
+    case State::Data: {
+      // _buf = datos + crc; la cabecera del registro se reconstruye
+      uint8_t head[RECORD_HEAD];
+      size_t hn = 0;
+      put16(head + hn, _slot); hn += 2;
+      if (_version != VERSION_V1) { put16(head + hn, _user); hn += 2; }
+      put16(head + hn, _len); hn += 2;
+      const uint32_t crc = crc32(crc32(0, head, hn), _buf, _len);
+      const uint8_t* t = _buf + _len;
+      const uint32_t got = (uint32_t)t[0] | ((uint32_t)t[1] << 8) | ((uint32_t)t[2] << 16) | ((uint32_t)t[3] << 24);
+      if (crc != got) ++_badCrc;
+      else if (_fn && !_fn(_ctx, _slot, _version == VERSION_V1 ? -1 : (int)_user, _buf, _len)) ++_rejected;
+      else ++_records;
+      _state = State::RecordHead;
+      _need = END;
+      return;
+    }
+
+    default:
+      return;
+  }
+}
+
+}  // namespace fpta
@@ -0,0 +1,280 @@
+#include <Arduino.h>
+#include <AsyncTCP.h>
+#include <ESPAsyncWebServer.h>
+#include <freertos/stream_buffer.h>
+#include <atomic>
+#include "TemplatesApi.h"
+#include "TemplateArchive.h"
+
+static FingerprintModel* s_fp     = nullptr;
+static SensorWorker*     s_worker = nullptr;
+static SlotMap*          s_slots  = nullptr;
+
+static constexpr uint16_t MAX_SLOTS = 1024;      // 4 páginas de ReadIndexTable
+static constexpr size_t   XFER_BUF  = 6144;      // >= ventana TCP (CONFIG_TCP_WND_DEFAULT 5744)
+static constexpr uint32_t STALL_MS  = 10000;     // sin avance del otro lado: abortar
+
+// Transferencia en curso (export o import), compartida entre el handler HTTP
+// (tarea AsyncTCP) y el job (tarea del sensor). `refs` cuenta a ambos lados;
+// el último en soltarla libera el turno.
+struct Transfer {
+  StreamBufferHandle_t sb = nullptr;
+  std::atomic<int>  refs{0};
+  std::atomic<bool> cancel{false};
+  std::atomic<bool> done{false};
+  std::atomic<bool> httpHeld{false};
+  AsyncWebServerRequest* owner = nullptr;   // request dueño (sólo tarea AsyncTCP)
+
+  // import
+  SemaphoreHandle_t clientLock = nullptr;   // `client` se anula al desconectar
+  AsyncClient* client = nullptr;
+  size_t   expected = 0;                    // Content-Length
+  bool     emptyFirst = false;
+  bool     overflow = false;
+  fpta::Reader reader;
+
+  // resultado (lo escribe el job antes de `done`)
+  uint16_t written = 0, failed = 0;
+  uint8_t  lastRc = 0;
+  char     result[224];
+};
+static Transfer s_xfer;
+static std::atomic<bool> s_busy{false};
+
+static bool acquire(AsyncWebServerRequest* req) {
+  if (s_busy.exchange(true)) return false;
+  xStreamBufferReset(s_xfer.sb);
+  s_xfer.refs = 2;
+  s_xfer.cancel = false;
+  s_xfer.done = false;
+  s_xfer.httpHeld = true;
+  s_xfer.owner = req;
+  s_xfer.client = nullptr;
+  s_xfer.overflow = false;
+  s_xfer.written = s_xfer.failed = 0;
+  s_xfer.lastRc = FINGERPRINT_OK;
+  s_xfer.result[0] = '\0';
+  return true;
+}
+
+static void release() {
+  if (s_xfer.refs.fetch_sub(1) == 1) s_busy = false;
+}
+
+// Lado HTTP: respuesta terminada o cliente desconectado (una sola vez)
+static void releaseHttp() {
+  if (!s_xfer.httpHeld.exchange(false)) return;
+  s_xfer.owner = nullptr;
+  release();
+}
+
+static void onDisconnect() {
+  s_xfer.cancel = true;
+  xSemaphoreTake(s_xfer.clientLock, portMAX_DELAY);
+  s_xfer.client = nullptr;
+  xSemaphoreGive(s_xfer.clientLock);
+  releaseHttp();
+}
+
+// ===================== export =====================
+// Job: ReadIndexTable y UpChar de cada slot ocupado, registro por registro
+// al StreamBuffer. Si el cliente no lee en STALL_MS, se corta.
+static bool sendAll(const uint8_t* p, size_t n) {
+  unsigned long last = millis();
+  while (n) {
+    if (s_xfer.cancel) return false;
+    const size_t c = xStreamBufferSend(s_xfer.sb, p, n, pdMS_TO_TICKS(100));
+    if (c) { p += c; n -= c; last = millis(); }
+    else if (millis() - last > STALL_MS) return false;
+  }
+  return true;
+}
+
+static void exportRun(void*, SensorResult& r) {
+  FingerprintModel& fp = *s_fp;
+  uint8_t tpl[FingerprintModel::TEMPLATE_MAX];
+  uint8_t rec[fpta::RECORD_HEAD + FingerprintModel::TEMPLATE_MAX + fpta::RECORD_TAIL];
+  uint8_t bits[MAX_SLOTS / 8];
+
+  uint16_t capacity = MAX_SLOTS;
+  if (fp.chip().getParameters() == FINGERPRINT_OK) capacity = min<uint16_t>(fp.chip().capacity, MAX_SLOTS);
+  r.rc = fp.readIndex(bits, capacity);
+  // sin índice no se escribe nada: el cliente recibe un archivo sin fin (truncado)
+  bool ok = r.rc == FINGERPRINT_OK;
+  uint16_t count = 0;
+  for (uint16_t i = 0; ok && i < (capacity + 7) / 8; ++i) count += __builtin_popcount(bits[i]);
+  ok = ok && sendAll(rec, fpta::writeHeader(rec, count, capacity, FingerprintModel::TEMPLATE_MAX));
+
+  for (uint16_t slot = 0; ok && slot < capacity; ++slot) {
+    if (!(bits[slot / 8] & (1u << (slot % 8)))) continue;
+    uint16_t len = 0;
+    const uint8_t rc = fp.readTemplate(slot, tpl, len);
+    if (rc != FINGERPRINT_OK) { ++s_xfer.failed; s_xfer.lastRc = rc; continue; }
+    const int user = s_slots->userOf(slot);
+    ok = sendAll(rec, fpta::writeRecord(rec, slot, user < 0 ? fpta::NO_USER : (uint16_t)user, tpl, len));
+    if (ok) ++s_xfer.written;
+  }
+  if (ok) ok = sendAll(rec, fpta::writeEnd(rec, s_xfer.written));
+  r.ok = ok;
+  r.id = s_xfer.written;
+  Serial.printf("[templates] export %s: %u de %u plantillas (%u fallidas)\n",
+                ok ? "ok" : "cortado", s_xfer.written, count, s_xfer.failed);
+  s_xfer.done = true;
+}
+
+static void jobDone(void*, const SensorResult&) { release(); }
+
+static size_t exportFill(uint8_t* buf, size_t maxLen, size_t) {
+  size_t n = xStreamBufferReceive(s_xfer.sb, buf, maxLen, 0);
+  if (n) return n;
+  if (!s_xfer.done) return RESPONSE_TRY_AGAIN;
+  n = xStreamBufferReceive(s_xfer.sb, buf, maxLen, 0);   // lo enviado antes de `done`
+  if (n) return n;
+  releaseHttp();
+  return 0;
+}
+
+static void onExport(AsyncWebServerRequest* req) {
+  if (!acquire(req)) {
+    req->send(409, "application/json", "{\"error\":\"transfer in progress\"}");
+    return;
+  }
+  if (!s_worker->submit(&exportRun, &jobDone, nullptr)) {
+    release();                                       // el job nunca la tomará
+    releaseHttp();
+    req->send(503, "application/json", "{\"error\":\"sensor busy\"}");
+    return;
+  }
+  AsyncWebServerResponse* res = req->beginChunkedResponse("application/octet-stream", exportFill);
+  res->addHeader("Content-Disposition", "attachment; filename=\"templates.fpta\"");
+  req->onDisconnect([]() { onDisconnect(); });
+  req->send(res);
+}
+
+// ===================== import =====================
+// El cuerpo pasa al job por el StreamBuffer. Cada pedazo se deja sin ACK
+// (ackLater) y el job lo confirma al consumirlo: la ventana TCP frena al
+// cliente al ritmo del sensor (~0,1 s por plantilla a 57600) y el buffer
+// nunca guarda más que una ventana.
+// Dueño del registro: el del archivo (v2) o, en un archivo v1 que no lo
+// trae, el del layout clásico slot / SLOTS_PER_USER. Sin dueño: ORPHAN.
+static uint16_t importOwner(uint16_t slot, int user) {
+  if (user < 0) user = slot / FingerprintModel::SLOTS_PER_USER;
+  return user <= SlotMap::MAX_USER ? (uint16_t)user : SlotMap::ORPHAN;
+}
+
+static bool importRecord(void*, uint16_t slot, int user, const uint8_t* data, uint16_t len) {
+  const uint8_t rc = s_fp->writeTemplate(slot, data, len);
+  if (rc == FINGERPRINT_OK) {
+    s_slots->assign(slot, importOwner(slot, user));
+    ++s_xfer.written;
+    return true;
+  }
+  ++s_xfer.failed;
+  s_xfer.lastRc = rc;
+  return false;
+}
+
+static void ackClient(size_t n) {
+  xSemaphoreTake(s_xfer.clientLock, portMAX_DELAY);
+  if (s_xfer.client) s_xfer.client->ack(n);
+  xSemaphoreGive(s_xfer.clientLock);
+}
+
+static void importRun(void*, SensorResult& r) {
+  fpta::Reader& rd = s_xfer.reader;
+  rd.begin(&importRecord, nullptr);
+  const char* error = nullptr;
+  if (s_xfer.emptyFirst && (r.rc = s_fp->chip().emptyDatabase()) != FINGERPRINT_OK) error = "empty_failed";
+  else if (s_xfer.emptyFirst) s_slots->clear();
+
+  uint8_t buf[256];
+  size_t got = 0;
+  unsigned long last = millis();
+  while (got < s_xfer.expected && !s_xfer.cancel) {
+    const size_t n = xStreamBufferReceive(s_xfer.sb, buf, sizeof(buf), pdMS_TO_TICKS(100));
+    if (!n) {
+      if (millis() - last > STALL_MS) { error = "stalled"; break; }
+      continue;
+    }
+    last = millis();
+    got += n;
+    // tras un error o el fin del archivo sólo se drena el cuerpo
+    if (!error && !rd.done() && rd.state() != fpta::Reader::State::Error) rd.feed(buf, n);
+    ackClient(n);
+  }
+  if (!error && s_xfer.overflow) error = "overflow";
+  if (!error && s_xfer.cancel) error = "disconnected";
+  if (!error && rd.state() == fpta::Reader::State::Error) error = rd.error();
+  if (!error && !rd.done()) error = "truncated";
+  // los dueños ya los asignó importRecord; sync() confirma la ocupación y
+  // guarda (también si se cortó a mitad)
+  if (s_xfer.written || s_xfer.emptyFirst) s_slots->sync();
+
+  r.ok = error == nullptr;
+  r.id = s_xfer.written;
+  snprintf(s_xfer.result, sizeof(s_xfer.result),
+           "{\"ok\":%s,\"error\":\"%s\",\"announced\":%u,\"written\":%u,\"failed\":%u,"
+           "\"badCrc\":%u,\"lastCode\":\"%s\"}",
+           r.ok ? "true" : "false", error ? error : "", rd.announced(), s_xfer.written,
+           s_xfer.failed, rd.badCrc(), s_fp->err(s_xfer.lastRc));
+  Serial.printf("[templates] import: %s\n", s_xfer.result);
+  s_xfer.done = true;
+  // lo pendiente: cabeceras HTTP que compartieron segmento con el cuerpo, o
+  // cuerpo sin leer si se cortó antes (desde `done` no se retiene más)
+  ackClient(SIZE_MAX);
+}
+
+static void onImportBody(AsyncWebServerRequest* req, uint8_t* data, size_t len,
+                         size_t index, size_t total) {
+  if (index == 0 && s_xfer.owner != req) {
+    if (!acquire(req)) return;                                         // 409 en onImport
+    s_xfer.client = req->client();
+    s_xfer.expected = total;
+    s_xfer.emptyFirst = req->hasParam("empty") && req->getParam("empty")->value() == "1";
+    req->onDisconnect([]() { onDisconnect(); });
+    if (!s_worker->submit(&importRun, &jobDone, nullptr)) {
+      // sin job: este pedido se contesta 503 y el cuerpo se descarta
+      release();
+      s_xfer.cancel = true;
+      return;
+    }
+  }
+  if (s_xfer.owner != req || s_xfer.cancel || s_xfer.done) return;
+  if (xStreamBufferSend(s_xfer.sb, data, len, 0) != len) s_xfer.overflow = true;
+  req->client()->ackLater();
+}
+
+static size_t resultFill(uint8_t* buf, size_t maxLen, size_t index) {
+  if (!s_xfer.done) return RESPONSE_TRY_AGAIN;
+  const size_t len = strlen(s_xfer.result);
+  if (index >= len) { releaseHttp(); return 0; }
+  const size_t n = min(maxLen, len - index);
+  memcpy(buf, s_xfer.result + index, n);
+  return n;
+}
+
+static void onImport(AsyncWebServerRequest* req) {
+  if (s_xfer.owner != req) {
+    req->send(s_busy ? 409 : 400, "application/json",
+              s_busy ? "{\"error\":\"transfer in progress\"}" : "{\"error\":\"empty body\"}");
+    return;
+  }
+  if (s_xfer.cancel && !s_xfer.done) {          // no se pudo encolar el job
+    releaseHttp();
+    req->send(503, "application/json", "{\"error\":\"sensor busy\"}");
+    return;
+  }
+  // el job puede seguir grabando las últimas plantillas: contestar al terminar
+  req->send(req->beginChunkedResponse("application/json", resultFill));
+}
+
+void initTemplatesApi(AsyncWebServer& server, FingerprintModel& fp, SensorWorker& worker, SlotMap& slots) {
+  s_fp = &fp;
+  s_worker = &worker;
+  s_slots = &slots;
+  if (!s_xfer.sb) s_xfer.sb = xStreamBufferCreate(XFER_BUF, 1);
+  if (!s_xfer.clientLock) s_xfer.clientLock = xSemaphoreCreateMutex();
+  server.on("/fp/templates", HTTP_GET, onExport);
+  server.on("/fp/templates", HTTP_POST, onImport, nullptr, onImportBody);
+}
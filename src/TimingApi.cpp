@@ -0,0 +1,48 @@
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "TimingApi.h"
+
+static AutoMode* s_auto = nullptr;
+
+// Parámetro entero sin signo; false si está pero no es un número
+static bool readMs(AsyncWebServerRequest* req, const char* name, uint32_t& out) {
+  if (!req->hasParam(name)) return true;
+  const String v = req->getParam(name)->value();
+  if (!v.length() || v.length() > 6) return false;
+  for (size_t i = 0; i < v.length(); ++i)
+    if (!isDigit(v[i])) return false;
+  out = (uint32_t)v.toInt();
+  return true;
+}
+
+static void onTiming(AsyncWebServerRequest* req) {
+  if (req->hasParam("mode")) {
+    const String m = req->getParam("mode")->value();
+    if (m != "freerun" && m != "interactive") {
+      req->send(400, "application/json", "{\"error\":\"bad mode\"}");
+      return;
+    }
+    s_auto->setFreeRun(m == "freerun");
+  }
+  AutoTiming t = s_auto->timing();
+  if (req->hasParam("minScanMs") || req->hasParam("resultMs") || req->hasParam("relayMs")) {
+    if (!readMs(req, "minScanMs", t.minScanMs) || !readMs(req, "resultMs", t.resultMs) ||
+        !readMs(req, "relayMs", t.relayMs) || !s_auto->setTiming(t)) {
+      req->send(400, "application/json", "{\"error\":\"bad timing\"}");
+      return;
+    }
+  }
+  char body[192];
+  snprintf(body, sizeof(body),
+           "{\"minScanMs\":%u,\"resultMs\":%u,\"relayMs\":%u,\"mode\":\"%s\","
+           "\"peoplePerMin\":{\"interactive\":%.2f,\"freerun\":%.2f}}",
+           (unsigned)t.minScanMs, (unsigned)t.resultMs, (unsigned)t.relayMs,
+           s_auto->freeRun() ? "freerun" : "interactive",
+           fpMetricsPeoplePerMin(MetricMode::Interactive), fpMetricsPeoplePerMin(MetricMode::FreeRun));
+  req->send(200, "application/json", body);
+}
+
+void initTimingApi(AsyncWebServer& server, AutoMode& autoMode) {
+  s_auto = &autoMode;
+  server.on("/fp/timing", HTTP_GET, onTiming);
+}
@@ -0,0 +1,11 @@
+#include "Util.h"
+#include <stdarg.h>
+
+void appendf(char* out, size_t n, size_t& w, const char* fmt, ...) {
+  if (w >= n) return;
+  va_list ap;
+  va_start(ap, fmt);
+  const int c = vsnprintf(out + w, n - w, fmt, ap);
+  va_end(ap);
+  w = (c < 0 || (size_t)c >= n - w) ? n : w + c;
+}
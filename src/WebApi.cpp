@@ -3,70 +3,280 @@
 #include <Arduino.h>
 #include "Types.h" 
 
-WebApi::WebApi(FingerprintService& fp) : server_(80), fp_(fp) {}
+WebApi::WebApi(AsyncWebServer& server, FingerprintService& fp, SensorWorker& worker, SlotMap* slots,
+               SearchEngine* search, MatchPolicy* policy)
+: server_(server), events_("/api/events"), fp_(fp), worker_(worker), slots_(slots),
+  search_(search), policy_(policy) {
+  for (auto& j : jobs_) j.api = this;
+}
+
+// ---------- jobs (corren en la tarea del sensor) ----------
+const char* WebApi::kindName(JobKind k) {
+  switch (k) {
+    case JobKind::Enroll: return "enroll";
+    case JobKind::Match:  return "match";
+    case JobKind::Empty:  return "empty";
+    case JobKind::Remove: return "delete";
+  }
+  return "?";
+}
+
+void WebApi::runJob(void* ctx, SensorResult& r) {
+  ApiJob& j = *static_cast<ApiJob*>(ctx);
+  FingerprintService& fp = j.api->fp_;
+  j.running.store(true, std::memory_order_relaxed);
+  String e;
+  switch (j.kind) {
+    case JobKind::Enroll:
+      r.ok = j.api->enrollUser(j.arg, e);
+      r.id = j.arg;
+      break;
+    case JobKind::Match: {
+      FPMatch m = j.api->matchUser();
+      r.ok = m.ok; r.id = m.id; r.score = m.score; e = m.err;
+      break;
+    }
+    case JobKind::Empty:
+      r.ok = fp.empty();
+      if (!r.ok) e = "empty";
+      break;
+    case JobKind::Remove:
+      r.ok = j.api->removeUser(j.arg);
+      r.id = j.arg;
+      if (!r.ok) e = "notfound";
+      break;
+  }
+  strncpy(j.err, e.c_str(), sizeof(j.err) - 1);
+  j.err[sizeof(j.err) - 1] = '\0';
+  if (j.kind != JobKind::Match) {
+    j.api->refreshCache();
+    if (r.ok && j.api->slots_) j.api->slots_->sync();
+  }
+}
+
+bool WebApi::enrollUser(uint16_t user, String& err) {
+  if (!slots_) return fp_.enroll(user, err);
+  uint16_t slot;
+  if (!slots_->allocate(user, 1, &slot)) { err = "full"; return false; }
+  if (!fp_.enroll(slot, err)) return false;
+  slots_->assign(slot, user);
+  // re-enrol: las plantillas anteriores del usuario se borran, como en la CLI
+  uint16_t had[SlotMap::MAX_PER_USER];
+  const uint8_t n = slots_->slotsOf(user, had, SlotMap::MAX_PER_USER);
+  for (uint8_t i = 0; i < n; ++i)
+    if (had[i] != slot && fp_.remove(had[i])) slots_->release(had[i]);
+  slots_->save();
+  return true;
+}
+
+bool WebApi::removeUser(uint16_t user) {
+  if (!slots_) return fp_.remove(user);
+  uint16_t had[1];
+  return slots_->slotsOf(user, had, 1) && slots_->removeUser(user) == FINGERPRINT_OK;
+}
+
+// El mismo camino que AutoMode::searchBuffer(): zonas y veredicto de la política
+FPMatch WebApi::matchUser() {
+  if (!search_) return fp_.match();
+  FPMatch m{false, -1, 0, ""};
+  if (!fp_.captureTo(1)) { m.err = "capture"; return m; }
+  uint16_t page = 0, score = 0;
+  int zone = -1;
+  const uint8_t rc = search_->search(1, page, score, zone);
+  if (rc != FINGERPRINT_OK) { m.err = rc == FINGERPRINT_NOTFOUND ? "notfound" : "search"; return m; }
+  m.score = score;
+  if (policy_) {
+    const PolicyVerdict v = policy_->decide(1, page, score, zone);
+    if (!v.accept) { m.err = policyReasonName(v.reason); return m; }
+  }
+  m.id = slots_ ? slots_->userOf(page) : page;
+  m.ok = m.id >= 0;
+  if (!m.ok) m.err = "no_owner";
+  return m;
+}
+
+void WebApi::jobDone(void* ctx, const SensorResult& r) {
+  ApiJob& j = *static_cast<ApiJob*>(ctx);
+  j.ok    = r.ok;
+  j.id    = r.id;
+  j.score = r.ok ? r.score : 0;
+  j.running.store(false, std::memory_order_relaxed);
+  j.doneSeq.store(r.seq, std::memory_order_release);
+}
+
+void WebApi::refreshRun(void* ctx, SensorResult& r) {
+  WebApi* api = static_cast<WebApi*>(ctx);
+  int cap = -1, sec = -1;
+  if (api->fp_.params(cap, sec)) {
+    api->capacity_.store(cap, std::memory_order_relaxed);
+    api->security_.store(sec, std::memory_order_relaxed);
+  }
+  api->refreshCache();
+  r.ok = true;
+}
+
+void WebApi::refreshCache() {
+  count_.store(fp_.count(), std::memory_order_relaxed);
+}
+
+// ---------- tabla de jobs (tarea AsyncTCP / loop) ----------
+WebApi::ApiJob* WebApi::allocJob() {
+  ApiJob* slot = nullptr;
+  portENTER_CRITICAL(&mux_);
+  // primero libres o ya notificados; si no, cualquier terminado
+  for (int pass = 0; pass < 2 && !slot; ++pass) {
+    for (int i = 0; i < MAX_JOBS; ++i) {
+      ApiJob& j = jobs_[(nextSlot_ + i) % MAX_JOBS];
+      if (j.seq == 0 || (j.done() && (j.notified || pass == 1))) {
+        slot = &j;
+        nextSlot_ = (nextSlot_ + i + 1) % MAX_JOBS;
+        break;
+      }
+    }
+  }
+  if (slot) { slot->seq = 0; slot->notified = false; slot->err[0] = '\0'; }
+  portEXIT_CRITICAL(&mux_);
+  return slot;
+}
+
+WebApi::ApiJob* WebApi::findJob(uint32_t seq) {
+  if (seq == 0) return nullptr;
+  for (auto& j : jobs_) if (j.seq == seq) return &j;
+  return nullptr;
+}
+
+// bajo mux_: sólo copias
+void WebApi::viewOf(const ApiJob& j, JobView& v) {
+  v.seq   = j.seq;
+  v.kind  = j.kind;
+  v.state = j.done() ? 2 : j.running.load(std::memory_order_relaxed) ? 1 : 0;
+  v.ok    = j.ok;
+  v.id    = j.id;
+  v.score = j.score;
+  memcpy(v.err, j.err, sizeof(v.err));
+}
+
+size_t WebApi::jobJson(const JobView& v, char* out, size_t n) {
+  if (v.state != 2) {
+    return snprintf(out, n, "{\"ok\":true,\"job\":%u,\"kind\":\"%s\",\"state\":\"%s\"}",
+                    (unsigned)v.seq, kindName(v.kind), v.state == 1 ? "running" : "queued");
+  }
+  return snprintf(out, n,
+                  "{\"ok\":true,\"job\":%u,\"kind\":\"%s\",\"state\":\"done\","
+                  "\"result\":{\"ok\":%s,\"id\":%d,\"score\":%d,\"error\":\"%s\"}}",
+                  (unsigned)v.seq, kindName(v.kind), v.ok ? "true" : "false", v.id, v.score, v.err);
+}
+
+void WebApi::startJob(AsyncWebServerRequest *r, JobKind kind, uint16_t arg) {
+  ApiJob* j = allocJob();
+  if (!j) { r->send(503, "application/json", "{\"ok\":false,\"error\":\"jobs llenos\"}"); return; }
+  j->kind = kind;
+  j->arg  = arg;
+  j->running.store(false, std::memory_order_relaxed);
+  const uint32_t seq = worker_.submit(&WebApi::runJob, &WebApi::jobDone, j);
+  if (!seq) { r->send(503, "application/json", "{\"ok\":false,\"error\":\"sensor ocupado\"}"); return; }
+  portENTER_CRITICAL(&mux_);
+  j->seq = seq;
+  portEXIT_CRITICAL(&mux_);
+
+  char buf[96];
+  snprintf(buf, sizeof(buf), "{\"ok\":true,\"job\":%u,\"kind\":\"%s\",\"state\":\"queued\"}",
+           (unsigned)seq, kindName(kind));
+  AsyncWebServerResponse* res = r->beginResponse(202, "application/json", buf);
+  res->addHeader("Location", String("/api/job?id=") + seq);
+  r->send(res);
+}
+
+void WebApi::loop() {
+  for (auto& j : jobs_) {
+    JobView v;
+    bool send = false;
+    portENTER_CRITICAL(&mux_);
+    if (!j.notified && j.done()) {
+      j.notified = true;
+      viewOf(j, v);
+      send = true;
+    }
+    portEXIT_CRITICAL(&mux_);
+    if (!send || events_.count() == 0) continue;
+    char buf[192];
+    jobJson(v, buf, sizeof(buf));
+    events_.send(buf, "job", millis());
+  }
+}
+
+// ---------- rutas ----------
+static bool idParam(AsyncWebServerRequest *r, uint16_t& id) {
+  if (r->hasParam("id", true))  { id = r->getParam("id", true)->value().toInt(); return true; }
+  if (r->hasParam("id"))        { id = r->getParam("id")->value().toInt(); return true; }
+  r->send(400,"application/json","{\"ok\":false,\"error\":\"id requerido\"}");
+  return false;
+}
 
 void WebApi::routes() {
   server_.on("/api/status", HTTP_GET, [this](AsyncWebServerRequest *r){
     String j = String("{\"ok\":true,\"wifi\":\"") + (WiFi.isConnected()?"connected":"disconnected")
-             + "\",\"ip\":\"" + WiFi.localIP().toString() + "\",\"templates\":" + fp_.count() + "}";
+             + "\",\"ip\":\"" + WiFi.localIP().toString() + "\",\"templates\":" + count_.load()
+             + ",\"sensorPending\":" + (unsigned)worker_.pending() + "}";
     r->send(200, "application/json", j);
   });
 
   server_.on("/api/info", HTTP_GET, [this](AsyncWebServerRequest *r){
-    r->send(200, "application/json", fp_.infoJson());
+    const int cap = capacity_.load();
+    if (cap < 0) { r->send(503, "application/json", "{\"ok\":false}"); return; }
+    r->send(200, "application/json", String("{\"ok\":true,\"capacity\":") + cap
+            + ",\"security_level\":" + security_.load() + ",\"baud\":" + fp_.detectedBaud() + "}");
   });
 
   server_.on("/api/count", HTTP_GET, [this](AsyncWebServerRequest *r){
-    int c = fp_.count();
+    int c = count_.load();
     if (c < 0) { r->send(500, "application/json", "{\"ok\":false}"); return; }
     r->send(200, "application/json", String("{\"ok\":true,\"count\":") + c + "}");
   });
 
+  // operaciones con el sensor: 202 + job
   server_.on("/api/empty", HTTP_POST, [this](AsyncWebServerRequest *r){
-    bool ok = fp_.empty();
-    r->send(ok ? 200 : 500, "application/json", String("{\"ok\":") + (ok?"true":"false") + "}");
+    startJob(r, JobKind::Empty);
   });
 
   server_.on("/api/enroll", HTTP_POST, [this](AsyncWebServerRequest *r){
-    if (!r->hasParam("id", true) && !r->hasParam("id")) {
-      r->send(400,"application/json","{\"ok\":false,\"error\":\"id requerido\"}");
+    uint16_t id;
+    if (!idParam(r, id)) return;
+    if (slots_ && id > SlotMap::MAX_USER) {
+      r->send(400, "application/json", "{\"ok\":false,\"error\":\"id fuera de rango\"}");
       return;
     }
-    uint16_t id = (r->hasParam("id", true) ? r->getParam("id", true)->value()
-                                           : r->getParam("id")->value()).toInt();
-    String e;
-    bool ok = fp_.enroll(id, e);
-    if (ok) r->send(200, "application/json", String("{\"ok\":true,\"id\":") + id + "}");
-    else    r->send(409, "application/json", String("{\"ok\":false,\"error\":\"") + e + "\"}");
+    startJob(r, JobKind::Enroll, id);
   });
 
   server_.on("/api/match", HTTP_POST, [this](AsyncWebServerRequest *r){
-  FPMatch m = fp_.match();   // <-- tipo correcto
-
-  if (m.ok) {
-    r->send(200, "application/json",
-            String("{\"ok\":true,\"id\":") + m.id + ",\"score\":" + m.score + "}");
-  } else {
-    // ajustá el nombre del campo si en tu struct es m.error en vez de m.err
-    r->send(404, "application/json",
-            String("{\"ok\":false,\"error\":\"") + m.err + "\"}");
-  }
-});
-
+    startJob(r, JobKind::Match);
+  });
 
   server_.on("/api/id", HTTP_DELETE, [this](AsyncWebServerRequest *r){
+    uint16_t id;
+    if (idParam(r, id)) startJob(r, JobKind::Remove, id);
+  });
+
+  server_.on("/api/job", HTTP_GET, [this](AsyncWebServerRequest *r){
     if (!r->hasParam("id")) {
       r->send(400,"application/json","{\"ok\":false,\"error\":\"id requerido\"}");
       return;
     }
-    uint16_t id = r->getParam("id")->value().toInt();
-    bool ok = fp_.remove(id);
-    r->send(ok?200:404, "application/json",
-            String("{\"ok\":") + (ok?"true":"false") + ",\"id\":" + id + "}");
+    const uint32_t seq = strtoul(r->getParam("id")->value().c_str(), nullptr, 10);
+    JobView v;
+    bool found = false;
+    portENTER_CRITICAL(&mux_);
+    if (ApiJob* j = findJob(seq)) { viewOf(*j, v); found = true; }
+    portEXIT_CRITICAL(&mux_);
+    if (!found) { r->send(404, "application/json", "{\"ok\":false,\"error\":\"job desconocido\"}"); return; }
+    char buf[192];
+    jobJson(v, buf, sizeof(buf));
+    r->send(200, "application/json", buf);
   });
 
   // CORS preflight para todas
-  const char* uris[] = {"/api/status","/api/info","/api/count","/api/empty","/api/enroll","/api/match","/api/id"};
+  const char* uris[] = {"/api/status","/api/info","/api/count","/api/empty","/api/enroll","/api/match","/api/id","/api/job"};
   for (auto uri : uris) {
     server_.on(uri, HTTP_OPTIONS, [this](AsyncWebServerRequest *r){ cors(r); });
   }
@@ -80,9 +290,9 @@ void WebApi::cors(AsyncWebServerRequest *req){
   req->send(res);
 }
 
-void WebApi::begin(uint16_t port) {
-  // si usás el AsyncWebServer ya construido con el puerto en el ctor,
-  // solo llamá a routes() y server_.begin()
+void WebApi::begin() {
   routes();
-  server_.begin();
+  server_.addHandler(&events_);
+  // capacidad/cantidad iniciales para los GET (sin tocar la UART en handlers)
+  worker_.submit(&WebApi::refreshRun, nullptr, this);
 }
@@ -8,10 +8,25 @@
 #include "DisplayModel.h"
 #include "FingerprintModel.h"
 #include "NamesModel.h"
+#include "SensorWorker.h"
+#include "SearchEngine.h"
+#include "SlotMap.h"
+#include "DoorRelay.h"
+#include "AccessJournal.h"
+#include "MatchPolicy.h"
 
 #include "AutoMode.h"   // máquina de estados (UI + match en background)
 #include "SerialCli.h"  // comandos por Serial
 #include "FingerprintApi.h"
+#include "NamesApi.h"
+#include "TemplatesApi.h"
+#include "SearchApi.h"
+#include "MetricsApi.h"
+#include "TimingApi.h"
+#include "JournalApi.h"
+#include "PolicyApi.h"
+#include "WebApi.h"
+#include "ScanMetrics.h"
 #include <ESPAsyncWebServer.h>
 #include <WiFi.h>
 #include "Config.h"
@@ -29,109 +44,215 @@ Adafruit_SH1106G display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, -1);
 HardwareSerial   FingerSerial(2);
 
 DisplayModel     displayModel(display, /*xoffset=*/2);
-FingerprintModel fpModel(FingerSerial, PIN_RX, PIN_TX);
+FingerprintModel fpModel(FingerSerial, PIN_RX, PIN_TX, FP_PIN_TOUCH, FP_TOUCH_ACTIVE_HIGH);
 NamesModel       names;
-AutoMode         autoMode(displayModel, fpModel, names);
+SensorWorker     sensorWorker;   // tarea persistente dueña de la UART del R305
+SearchEngine     searchEngine(fpModel);   // zonas de búsqueda 1:N
+SlotMap          slotMap(fpModel);        // ocupación de la base y dueño de cada slot
+MatchPolicy      matchPolicy(fpModel, slotMap);   // umbrales de score y acuerdo entre slots
+AutoMode         autoMode(displayModel, fpModel, names, sensorWorker, searchEngine, slotMap);
+DoorRelay        doorRelay(FP_PIN_RELAY, FP_RELAY_ACTIVE_HIGH);
+AccessJournal    journal;                 // registro de accesos en flash
+FingerprintService fpService(FingerSerial, PIN_RX, PIN_TX);   // /api/*: la misma UART, jobs en SensorWorker
 
 // server deferred until WiFi connected
 static AsyncWebServer* serverPtr = nullptr;
 static AsyncEventSource* fpEventsPtr = nullptr;
+static WebApi* webApiPtr = nullptr;
 static bool serverStarted = false;
 
-// ===== Setup =====
-void setup() {
-  Serial.begin(115200);
-  delay(150);
-  Serial.println("\n[ESP32 + R305 + SH1106] – inicio");
+// ===== Arranque en paralelo =====
+// Sensor (UART) y OLED (I2C) no comparten nada: cada uno inicializa en su
+// tarea mientras setup() carga NVS, y setup() espera a los dos (barrera con
+// EventGroup) antes de arrancar SensorWorker y AutoMode; si el sensor no
+// terminó en BOOT_TIMEOUT_MS, los arranca loop() cuando termine (mientras
+// tanto nadie hace polling de la UART). Wi-Fi asocia en su propia tarea; el
+// server arranca desde loop() al conectar.
+static EventGroupHandle_t bootEvents = nullptr;
+static const EventBits_t BOOT_SENSOR = BIT0;
+static const EventBits_t BOOT_OLED   = BIT1;
+static const uint32_t    BOOT_TIMEOUT_MS = 3000;
 
-  // Wi-Fi: modo estación y comienzo conexión (usa WIFI_SSID / WIFI_PASS de Config.h)
-  WiFi.mode(WIFI_STA);
-  WiFi.setAutoConnect(true);
-  WiFi.setAutoReconnect(true);
-  Serial.printf("Conectando a WiFi SSID='%s'...\n", WIFI_SSID);
-  WiFi.begin(WIFI_SSID, WIFI_PASS);
+// Instantes (ms desde el arranque) de cada fase; 0 = no terminó
+struct BootTimes {
+  uint32_t oled = 0, sensor = 0, nvs = 0, ready = 0, wifi = 0;
+};
+static BootTimes bootTimes;
 
-  // Escaneo rápido para diagnosticar: lista SSIDs disponibles (no bloquear mucho tiempo)
-  int n = WiFi.scanNetworks();
-  Serial.printf("ScanNetworks: %d redes encontradas\n", n);
-  for (int i = 0; i < n; ++i) {
-    Serial.printf("  %d: %s (RSSI %d) ch=%d %s\n", i, WiFi.SSID(i).c_str(), WiFi.RSSI(i), WiFi.channel(i),
-                  WiFi.encryptionType(i) == WIFI_AUTH_OPEN ? "OPEN" : "");
+static void sensorInitTask(void*) {
+  // UART del sensor + handshake (baud de NVS primero) + baud/paquete + índice de ocupación
+  {
+    FingerprintModel::UartGuard uart(fpModel);
+    fpModel.begin(57600);
+    if (fpModel.ready()) fpModel.negotiate(FP_MAX_BAUD, FP_MAX_PACKET);
+    if (fpModel.ready() && slotMap.begin() != FINGERPRINT_OK) Serial.println("SlotMap: sin ReadIndexTable");
   }
-  WiFi.scanDelete();
+  bootTimes.sensor = millis();
+  xEventGroupSetBits(bootEvents, BOOT_SENSOR);
+  vTaskDelete(nullptr);
+}
 
-  // I2C + OLED
-  Wire.begin(21, 22);
+static void oledInitTask(void*) {
+  Wire.begin(I2C_SDA, I2C_SCL);
   Wire.setClock(400000);                 // I2C fast
   if (!displayModel.begin(OLED_ADDR)) {
     Serial.println("OLED no encontrado (0x3C?)");
   }
+  bootTimes.oled = millis();
+  xEventGroupSetBits(bootEvents, BOOT_OLED);
+  vTaskDelete(nullptr);
+}
 
-  // Nombres en NVS
-  names.begin();
+// Resultado de AutoMode apenas termina el match (tarea del sensor): SSE y
+// relé no esperan a que la pantalla lo muestre
+static void onScanResult(void*, const ScanOutcome& r) {
+  fpApiEmitResult(r.ok, r.page, r.score, r.requestId, r.reason);
+  if (r.ok) doorRelay.pulse(autoMode.timing().relayMs);
 
-  // UART del sensor + autodetección
-  fpModel.begin(57600);
+  JournalRecord rec = {};
+  rec.user      = (int16_t)r.user;
+  rec.slot      = (int16_t)r.page;
+  rec.score     = (uint16_t)r.score;
+  rec.claimed   = (int16_t)r.claimed;
+  rec.outcome   = (uint8_t)(r.reason == PolicyReason::Confirmed ? JournalOutcome::Confirmed
+                            : r.reason == PolicyReason::LowScore ? JournalOutcome::LowScore
+                            : r.reason == PolicyReason::NoAgreement ? JournalOutcome::NoAgreement
+                            : r.ok ? JournalOutcome::Match
+                            : r.rc == FINGERPRINT_NOTFOUND ? JournalOutcome::NoMatch
+                            : JournalOutcome::SensorError);
+  rec.rc        = r.rc;
+  rec.latencyMs = (uint16_t)min<uint32_t>(r.latencyUs / 1000, 0xFFFF);
+  rec.request   = r.requestId;
+  rec.retries   = min<uint8_t>(r.retries, 15);
+  journal.log(rec);               // lo graba loop() (flush)
+}
+
+// SensorWorker + AutoMode, recién con la inicialización del sensor terminada
+static bool sensorStarted = false;
+static void startSensor(bool oled) {
   if (!fpModel.ready()) {
     Serial.println("ERROR: sin handshake R305. Revisá cableado/5V/GND.");
-    displayModel.errorMsg("Sin handshake");
+    if (oled) displayModel.errorMsg("Sin handshake");
   } else {
     Serial.print("R305 baud: "); Serial.println(fpModel.detectedBaud());
-    if (fpModel.chip().getParameters()==FINGERPRINT_OK) {
-      Serial.println("getParameters OK");
-    } else {
-      Serial.println("getParameters FAIL (no crítico)");
-    }
   }
+  if (!sensorWorker.begin(true, 4, fpModel.uartLock())) {
+    Serial.println("ERROR: no se pudo crear la tarea del sensor");
+  }
+  autoMode.onResult(&onScanResult, nullptr);
+  autoMode.setPolicy(&matchPolicy);
+  autoMode.begin();
+  sensorStarted = true;
+}
 
-  // Esperar conexión Wi‑Fi (timeout 10 s) antes de intentar arrancar server
-  Serial.println("Esperando WiFi...");
-  unsigned long waitUntil = millis() + 10000;
-  while (millis() < waitUntil && WiFi.status() != WL_CONNECTED) {
-    delay(100);
+static void startServer() {
+  serverPtr = new AsyncWebServer(80);
+  fpEventsPtr = new AsyncEventSource("/fp/events");
+  initNamesApi(*serverPtr, names);
+  initTemplatesApi(*serverPtr, fpModel, sensorWorker, slotMap);
+  initSearchApi(*serverPtr, searchEngine);
+  initMetricsApi(*serverPtr, sensorWorker);
+  initTimingApi(*serverPtr, autoMode);
+  initJournalApi(*serverPtr, journal);
+  initPolicyApi(*serverPtr, matchPolicy);
+  fpService.attach(fpModel.detectedBaud());
+  webApiPtr = new WebApi(*serverPtr, fpService, sensorWorker, &slotMap, &searchEngine, &matchPolicy);
+  webApiPtr->begin();
+  initFingerprintApi(*serverPtr, *fpEventsPtr);
+  serverPtr->addHandler(fpEventsPtr);
+  serverPtr->begin();
+  serverStarted = true;
+}
+
+#if FP_WIFI_SCAN
+// Diagnóstico opcional (-DFP_WIFI_SCAN=1): bloquea ~2 s
+static void printWifiScan() {
+  int n = WiFi.scanNetworks();
+  Serial.printf("ScanNetworks: %d redes encontradas\n", n);
+  for (int i = 0; i < n; ++i) {
+    Serial.printf("  %d: %s (RSSI %d) ch=%d %s\n", i, WiFi.SSID(i).c_str(), WiFi.RSSI(i), WiFi.channel(i),
+                  WiFi.encryptionType(i) == WIFI_AUTH_OPEN ? "OPEN" : "");
   }
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.print("WiFi OK, IP: "); Serial.println(WiFi.localIP());
-    // start server now that WiFi is up
-    serverPtr = new AsyncWebServer(80);
-    fpEventsPtr = new AsyncEventSource("/fp/events");
-    initFingerprintApi(*serverPtr, *fpEventsPtr);
-    serverPtr->addHandler(fpEventsPtr);
-    serverPtr->begin();
-    serverStarted = true;
-    Serial.println("HTTP server iniciado");
+  WiFi.scanDelete();
+}
+#endif
+
+// ===== Setup =====
+void setup() {
+  Serial.begin(115200);
+  Serial.println("\n[ESP32 + R305 + SH1106] – inicio");
+  fpMetricsBegin();
+  doorRelay.begin();
+
+  // Wi-Fi: modo estación y comienzo conexión (usa WIFI_SSID / WIFI_PASS de Config.h).
+  // No se espera: asocia en segundo plano.
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoConnect(true);
+  WiFi.setAutoReconnect(true);
+  Serial.printf("Conectando a WiFi SSID='%s'...\n", WIFI_SSID);
+  WiFi.begin(WIFI_SSID, WIFI_PASS);
+#if FP_WIFI_SCAN
+  printWifiScan();
+#endif
+
+  bootEvents = xEventGroupCreate();
+  fpModel.uartLock();            // el mutex de la UART antes que cualquier tarea lo use
+  xTaskCreatePinnedToCore(&sensorInitTask, "bootFp", 6144, nullptr, 2, nullptr, 0);
+  xTaskCreatePinnedToCore(&oledInitTask, "bootOled", 4096, nullptr, 2, nullptr, 1);
+
+  // Nombres y zonas de búsqueda en NVS y el journal en flash (mientras tanto)
+  names.begin();
+  searchEngine.begin();
+  matchPolicy.begin();
+  journal.begin();
+  bootTimes.nvs = millis();
+
+  const EventBits_t bits = xEventGroupWaitBits(bootEvents, BOOT_SENSOR | BOOT_OLED, pdFALSE, pdTRUE,
+                                               pdMS_TO_TICKS(BOOT_TIMEOUT_MS));
+  if (!(bits & BOOT_OLED)) Serial.println("ERROR: OLED sin responder");
+  if (bits & BOOT_SENSOR) {
+    startSensor(bits & BOOT_OLED);
   } else {
-    Serial.println("WiFi no conectado: servidor diferido hasta conexión");
-    // servidor se iniciará desde loop() cuando haya conexión
+    // la tarea sigue con la UART: ni SensorWorker ni AutoMode hasta que
+    // termine (los arranca loop())
+    Serial.println("ERROR: init del sensor colgado, AutoMode espera");
   }
-
-  autoMode.begin();
+  bootTimes.ready = millis();
+  Serial.printf("[boot] oled=%lu sensor=%lu nvs=%lu listo=%lu ms\n",
+                (unsigned long)bootTimes.oled, (unsigned long)bootTimes.sensor,
+                (unsigned long)bootTimes.nvs, (unsigned long)bootTimes.ready);
   printHelp();
 }
 
 // ===== Loop =====
 void loop() {
-  autoMode.tick();  // corre la máquina de estados (no bloquea)
-
-  // si el servidor aún no arrancó, intentar iniciar cuando haya Wi‑Fi
-  if (!serverStarted && WiFi.status() == WL_CONNECTED) {
-    Serial.println("WiFi conectado: arrancando HTTP server ahora");
-    serverPtr = new AsyncWebServer(80);
-    fpEventsPtr = new AsyncEventSource("/fp/events");
-    initFingerprintApi(*serverPtr, *fpEventsPtr);
-    serverPtr->addHandler(fpEventsPtr);
-    serverPtr->begin();
-    serverStarted = true;
-    Serial.println("HTTP server iniciado (deferred)");
+  if (!sensorStarted && (xEventGroupGetBits(bootEvents) & BOOT_SENSOR)) {
+    Serial.printf("[boot] sensor listo tarde: %lu ms\n", (unsigned long)bootTimes.sensor);
+    startSensor(xEventGroupGetBits(bootEvents) & BOOT_OLED);
+  }
+  if (sensorStarted) autoMode.tick();  // corre la máquina de estados (no bloquea)
+  doorRelay.loop(); // apaga el relé al vencer el pulso
+
+  // el servidor arranca cuando Wi-Fi asocia (setup() no lo espera) y el
+  // sensor ya arrancó: las APIs encolan en SensorWorker y WebApi toma el baud
+  // negociado y pide la caché inicial al crearse
+  if (!serverStarted && sensorStarted && WiFi.status() == WL_CONNECTED) {
+    bootTimes.wifi = millis();
+    Serial.print("WiFi OK, IP: "); Serial.println(WiFi.localIP());
+    startServer();
+    configTime(0, 0, "pool.ntp.org");   // hora unix para el journal
+    Serial.printf("[boot] wifi=%lu ms, HTTP server iniciado\n", (unsigned long)bootTimes.wifi);
   }
 
   if (Serial.available()) {
     String line = Serial.readStringUntil('\n'); line.trim();
     if (line.length()) {
-      handleSerialCommand(line, displayModel, fpModel, names, autoMode);
+      handleSerialCommand(line, displayModel, fpModel, names, autoMode, searchEngine, slotMap, matchPolicy);
     }
   }
   fpApiLoop(); // procesar y enviar eventos pendientes
+  if (webApiPtr) webApiPtr->loop(); // SSE de los jobs /api terminados
+  journal.flush(); // grabar en flash los accesos encolados
 
   // NO dibujar nada aquí: AutoMode gestiona la UI (idle/scanning/matching)
 }
@@ -0,0 +1,1433 @@
+// Benchmark de latencia en host (entorno `native`).
+//
+//   pio run -e native -t exec            # resumen
+//   .pio/build/native/program -v         # con los logs del firmware
+//
+// Corre FingerprintModel y AutoMode sin cambios contra el R305 emulado; todos
+// los tiempos son del reloj virtual (UART, I2C y procesamiento del sensor).
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_SH110X.h>
+#include <Preferences.h>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "Bitmaps.h"
+#include "DisplayModel.h"
+#include "FingerprintModel.h"
+#include "NamesModel.h"
+#include "NamesCodec.h"
+#include "TemplateArchive.h"
+#include "AccessJournal.h"
+#include "AutoMode.h"
+#include "DoorRelay.h"
+#include "ScanRequest.h"
+#include "ScanMetrics.h"
+#include "SearchEngine.h"
+#include "SlotMap.h"
+#include "SensorWorker.h"
+#include "EventBus.h"
+#include "MatchPolicy.h"
+#include "FingerprintService.h"
+#include "WebApi.h"
+#include <ESPAsyncWebServer.h>
+#include <esp_partition.h>
+#include "R305Emulator.h"
+
+HardwareSerial FingerSerial(2);
+
+namespace {
+
+constexpr int SLOTS_PER_USER = 5;
+
+struct Series {
+  std::vector<double> v;
+  void add(double x) { v.push_back(x); }
+  double pct(double p) const {
+    if (v.empty()) return 0;
+    std::vector<double> s(v);
+    std::sort(s.begin(), s.end());
+    size_t i = (size_t)(p * (s.size() - 1) + 0.5);
+    return s[std::min(i, s.size() - 1)];
+  }
+  double mean() const {
+    double t = 0; for (double x : v) t += x;
+    return v.empty() ? 0 : t / v.size();
+  }
+};
+
+double msSince(uint64_t t0Us) { return (VirtualClock::nowUs() - t0Us) / 1000.0; }
+
+// Print sobre stdout (Serial queda callado sin -v)
+struct StdoutPrint : Print {
+  size_t write(uint8_t c) override { return fputc(c, stdout) != EOF; }
+};
+
+void enrollUsers(R305Emulator& emu, int users) {
+  for (int u = 0; u < users; ++u)
+    for (int p = 0; p < SLOTS_PER_USER; ++p)
+      emu.storeTemplate((uint16_t)(u * SLOTS_PER_USER + p), (uint16_t)u, (uint8_t)p);
+}
+
+// Corre `body` hasta que devuelva true o venza el límite (ms virtuales).
+bool spinUntil(uint32_t limitMs, const std::function<bool()>& body) {
+  const uint64_t until = VirtualClock::nowUs() + (uint64_t)limitMs * 1000ULL;
+  while (VirtualClock::nowUs() < until) {
+    if (body()) return true;
+    delay(1);
+  }
+  return false;
+}
+
+// ---------------------------------------------------------------------------
+void benchAutoDetect() {
+  printf("\n== FingerprintModel::begin / autoDetect (sensor recién encendido) ==\n");
+  printf("%-12s %-10s %12s %12s %8s\n", "sensor baud", "detected", "sin NVS ms", "con NVS ms", "garbled");
+  const uint32_t bauds[] = {57600, 115200, 38400, 19200, 9600};
+  for (uint32_t b : bauds) {
+    double ms[2];
+    uint32_t detected = 0, garbled = 0;
+    for (int cached = 0; cached < 2; ++cached) {
+      if (!cached) { Preferences p; p.begin("fp", false); p.clear(); p.end(); }
+      R305Emulator emu(b);
+      FingerSerial.attach(&emu);
+      FingerprintModel fp(FingerSerial, 25, 26);
+      emu.powerOn();
+      const uint64_t t0 = VirtualClock::nowUs();
+      fp.begin(57600);
+      ms[cached] = msSince(t0);
+      detected = fp.detectedBaud();
+      if (!cached) garbled = emu.garbledBytes();
+    }
+    printf("%-12u %-10u %12.1f %12.1f %8u\n", b, detected, ms[0], ms[1], garbled);
+  }
+  Preferences p;                       // el resto de los benchmarks arranca sin baud guardado
+  p.begin("fp", false);
+  p.clear();
+  p.end();
+}
+
+// ---------------------------------------------------------------------------
+// negotiate(): cada combinación baud/paquete desde un sensor de fábrica
+// (57600, 64 bytes) y el caudal de plantillas resultante (LoadChar+UpChar /
+// DownChar+Store, 512 bytes cada una). Después, los casos de fallback.
+void clearFpNvs() { Preferences p; p.begin("fp", false); p.clear(); p.end(); }
+
+void benchLink() {
+  printf("\n== negotiate(): baud y tamaño de paquete -> caudal de plantillas (20 x 512 B) ==\n");
+  printf("%-8s %-6s %-16s %10s %12s %12s\n", "baud", "pkt", "quedó", "negoc. ms", "UpChar B/s", "DownChar B/s");
+  constexpr int N = 20;
+  uint8_t tpl[FingerprintModel::TEMPLATE_MAX];
+  for (uint32_t baud : {57600u, 115200u}) {
+    for (uint16_t pkt : {32, 64, 128, 256}) {
+      clearFpNvs();
+      R305Emulator emu(57600);
+      enrollUsers(emu, 4);
+      FingerSerial.attach(&emu);
+      FingerprintModel fp(FingerSerial, 25, 26);
+      fp.begin(57600);
+      uint64_t t0 = VirtualClock::nowUs();
+      const uint8_t rc = fp.negotiate(baud, pkt);
+      const double negMs = msSince(t0);
+
+      t0 = VirtualClock::nowUs();
+      uint32_t up = 0;
+      for (int i = 0; i < N; ++i) {
+        uint16_t len = 0;
+        if (fp.readTemplate((uint16_t)(i % 20), tpl, len) == FINGERPRINT_OK) up += len;
+      }
+      const double upS = msSince(t0) / 1000.0;
+      t0 = VirtualClock::nowUs();
+      uint32_t down = 0;
+      for (int i = 0; i < N; ++i)
+        if (fp.writeTemplate((uint16_t)(100 + i), tpl, sizeof(tpl)) == FINGERPRINT_OK) down += sizeof(tpl);
+      const double downS = msSince(t0) / 1000.0;
+
+      char got[24];
+      snprintf(got, sizeof(got), "%u/%u%s", fp.detectedBaud(), fp.packetSize(), rc == FINGERPRINT_OK ? "" : " ERR");
+      printf("%-8u %-6u %-16s %10.1f %12.0f %12.0f\n", baud, pkt, got, negMs, up / upS, down / downS);
+    }
+  }
+
+  printf("fallback:\n");
+  {
+    // 115200 pierde ~1 byte de cada 100: tiene que volver a 57600 y recordarlo
+    clearFpNvs();
+    R305Emulator emu(57600);
+    emu.setLinkLimit(57600);
+    enrollUsers(emu, 4);
+    FingerSerial.attach(&emu);
+    FingerprintModel fp(FingerSerial, 25, 26);
+    fp.begin(57600);
+    uint64_t t0 = VirtualClock::nowUs();
+    fp.negotiate(115200, 256);
+    const double firstMs = msSince(t0);
+    const uint32_t sensorBaud = emu.baud();
+    FingerprintModel again(FingerSerial, 25, 26);      // próximo arranque
+    emu.powerOn();
+    again.begin(57600);
+    t0 = VirtualClock::nowUs();
+    again.negotiate(115200, 256);
+    printf("  115200 ruidoso: quedó %u/%u (sensor %u) en %.0f ms; próximo arranque %u/%u, negotiate %.1f ms\n",
+           fp.detectedBaud(), fp.packetSize(), sensorBaud, firstMs,
+           again.detectedBaud(), again.packetSize(), msSince(t0));
+  }
+  {
+    // clon que no acepta paquetes de 256
+    clearFpNvs();
+    R305Emulator emu(57600);
+    emu.setMaxPacketCode(2);
+    enrollUsers(emu, 4);
+    FingerSerial.attach(&emu);
+    FingerprintModel fp(FingerSerial, 25, 26);
+    fp.begin(57600);
+    const uint8_t rc = fp.negotiate(115200, 256);
+    printf("  clon sin 256 B: quedó %u/%u rc=%u\n", fp.detectedBaud(), fp.packetSize(), rc);
+  }
+  clearFpNvs();
+}
+
+// ---------------------------------------------------------------------------
+void benchCapture() {
+  printf("\n== FingerprintModel::captureToBuffer (dedo apoyado 1.2 s) ==\n");
+  printf("%-22s %10s %14s %10s %10s\n", "política / dedo a", "ok", "1ra imagen ms", "polls", "lift polls");
+  R305Emulator emu(57600);
+  FingerSerial.attach(&emu);
+  FingerprintModel fp(FingerSerial, 25, 26);
+  fp.begin(57600);
+
+  PollPolicy fixed;                   // como antes: 20 ms fijo
+  fixed.fastWindowMs = 60000;
+  const struct { const char* name; PollPolicy policy; } policies[] = {
+    {"fijo 20ms", fixed},
+    {"adaptiva", PollPolicy{}},
+  };
+  for (const auto& pol : policies) {
+    fp.setPollPolicy(pol.policy);
+    for (uint32_t atMs : {300u, 5000u}) {
+      Series ttfi, polls, lift;
+      int ok = 0;
+      for (int i = 0; i < 10; ++i) {
+        delay(2000);
+        const uint64_t t0 = VirtualClock::nowUs();
+        emu.scheduleFinger(t0 + atMs * 1000ULL, 7, 100, 0);
+        emu.scheduleFinger(t0 + (atMs + 1200) * 1000ULL, -1);
+        ok += fp.captureToBuffer(1, 15000);
+        const PollStats& st = fp.lastCapture();
+        ttfi.add(st.firstImageMs);
+        polls.add(st.polls);
+        lift.add(st.liftPolls);
+      }
+      char label[32];
+      snprintf(label, sizeof(label), "%s / %u ms", pol.name, atMs);
+      printf("%-22s %7d/10 %14.1f %10.1f %10.1f\n", label, ok, ttfi.mean(), polls.mean(), lift.mean());
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+// /fp/templates: respaldo de un sensor (ReadIndexTable + UpChar) a un archivo
+// FPTA y restauración en otro vacío (DownChar + Store), en pedazos de 1460 B.
+void benchTemplates() {
+  printf("\n== Plantillas: respaldo UpChar -> FPTA -> DownChar en otro sensor (30 usuarios) ==\n");
+  R305Emulator src(57600), dst(57600);
+  enrollUsers(src, 30);
+
+  FingerSerial.attach(&src);
+  FingerprintModel a(FingerSerial, 25, 26);
+  a.begin(57600);
+  std::string archive;
+  uint8_t bits[1000 / 8], tpl[FingerprintModel::TEMPLATE_MAX];
+  uint8_t rec[fpta::RECORD_HEAD + FingerprintModel::TEMPLATE_MAX + fpta::RECORD_TAIL];
+  uint64_t t0 = VirtualClock::nowUs();
+  a.readIndex(bits, 1000);
+  uint16_t count = 0, written = 0;
+  for (uint8_t b : bits) count += __builtin_popcount(b);
+  archive.append((const char*)rec, fpta::writeHeader(rec, count, 1000, FingerprintModel::TEMPLATE_MAX));
+  for (uint16_t slot = 0; slot < 1000; ++slot) {
+    uint16_t len;
+    if (!(bits[slot / 8] & (1u << (slot % 8))) || a.readTemplate(slot, tpl, len) != FINGERPRINT_OK) continue;
+    archive.append((const char*)rec, fpta::writeRecord(rec, slot, (uint16_t)(slot / SLOTS_PER_USER), tpl, len));
+    ++written;
+  }
+  archive.append((const char*)rec, fpta::writeEnd(rec, written));
+  const double exportMs = msSince(t0);
+
+  FingerSerial.attach(&dst);
+  FingerprintModel b(FingerSerial, 25, 26);
+  b.begin(57600);
+  fpta::Reader rd;
+  uint16_t stored = 0;
+  rd.begin([](void* ctx, uint16_t slot, int user, const uint8_t* data, uint16_t len) {
+    // el dueño viaja en el registro (v2): uno cambiado cuenta como rechazado
+    return user == slot / SLOTS_PER_USER &&
+           static_cast<FingerprintModel*>(ctx)->writeTemplate(slot, data, len) == FINGERPRINT_OK;
+  }, &b);
+  t0 = VirtualClock::nowUs();
+  for (size_t off = 0; off < archive.size(); off += 1460)
+    rd.feed((const uint8_t*)archive.data() + off, min<size_t>(1460, archive.size() - off));
+  const double importMs = msSince(t0);
+  stored = rd.records();
+
+  int hits = 0;
+  for (int u = 0; u < 30; ++u) {
+    dst.placeFinger((uint16_t)u, 100, (uint8_t)(u % SLOTS_PER_USER));
+    auto& chip = b.chip();
+    if (chip.getImage() == FINGERPRINT_OK && chip.image2Tz(1) == FINGERPRINT_OK &&
+        chip.fingerFastSearch() == FINGERPRINT_OK && chip.fingerID / SLOTS_PER_USER == u) ++hits;
+    dst.liftFinger();
+  }
+  printf("archivo=%zu bytes  plantillas=%u/%u  export=%.0f ms  import=%.0f ms (%.0f ms/plantilla)\n",
+         archive.size(), stored, count, exportMs, importMs, stored ? importMs / stored : 0.0);
+  printf("fin=%d crc malos=%u  match en el sensor restaurado=%d/30\n", rd.done(), rd.badCrc(), hits);
+}
+
+// ---------------------------------------------------------------------------
+// Exportación de plantillas como job largo de SensorWorker (otra tarea)
+// mientras loop() sigue con el polling de AutoMode y el CLI: con la UART
+// tomada, pollFinger() no manda GenImg y el CLI no la consigue.
+void benchUartInterlock() {
+  printf("\n== UART: exportación en SensorWorker vs polling / CLI ==\n");
+  R305Emulator emu(57600);
+  enrollUsers(emu, 30);
+  FingerSerial.attach(&emu);
+  FingerprintModel fp(FingerSerial, 25, 26);
+  fp.begin(57600);
+  SensorWorker worker;
+  worker.begin(false, 4, fp.uartLock());
+
+  struct Export {
+    FingerprintModel* fp;
+    std::atomic<bool> started{false}, go{false};
+    uint16_t written = 0;
+  } ex;
+  ex.fp = &fp;
+  worker.submit([](void* ctx, SensorResult& r) {
+    Export& e = *static_cast<Export*>(ctx);
+    e.started = true;
+    while (!e.go) std::this_thread::yield();
+    uint8_t bits[1000 / 8], tpl[FingerprintModel::TEMPLATE_MAX];
+    r.rc = e.fp->readIndex(bits, 1000);
+    for (uint16_t slot = 0; r.rc == FINGERPRINT_OK && slot < 1000; ++slot) {
+      uint16_t len;
+      if ((bits[slot / 8] & (1u << (slot % 8))) && e.fp->readTemplate(slot, tpl, len) == FINGERPRINT_OK) ++e.written;
+    }
+  }, nullptr, &ex);
+  std::thread sensorTask([&] { worker.pump(portMAX_DELAY); });
+
+  while (!ex.started) std::this_thread::yield();
+  const uint32_t genImg0 = emu.commands(FINGERPRINT_GETIMAGE), bad0 = emu.badPackets();
+  int noFinger = 0;
+  for (int i = 0; i < 100; ++i) noFinger += fp.pollFinger() == FINGERPRINT_NOFINGER;
+  const bool cliBlocked = !FingerprintModel::UartGuard(fp, 0);
+  const uint32_t genImgDuring = emu.commands(FINGERPRINT_GETIMAGE) - genImg0;
+  ex.go = true;
+  sensorTask.join();
+
+  const uint32_t genImg1 = emu.commands(FINGERPRINT_GETIMAGE);
+  fp.pollFinger();
+  const bool cliAfter = (bool)FingerprintModel::UartGuard(fp, 0);
+  printf("polls durante el job=100 NOFINGER=%d GenImg enviados=%u  CLI bloqueado=%s\n",
+         noFinger, (unsigned)genImgDuring, cliBlocked ? "sí" : "no");
+  printf("exportadas=%u/150 paquetes malos=%u  después: GenImg=%u CLI libre=%s\n", ex.written,
+         (unsigned)(emu.badPackets() - bad0), (unsigned)(emu.commands(FINGERPRINT_GETIMAGE) - genImg1),
+         cliAfter ? "sí" : "no");
+}
+
+// ---------------------------------------------------------------------------
+void benchMatchSequence() {
+  printf("\n== runMatchTask: GenImg -> Img2Tz -> HiSpeedSearch (dedo presente) ==\n");
+  R305Emulator emu(57600);
+  enrollUsers(emu, 30);
+  FingerSerial.attach(&emu);
+  FingerprintModel fp(FingerSerial, 25, 26);
+  fp.begin(57600);
+  auto& chip = fp.chip();
+
+  Series lat;
+  int hits = 0;
+  for (int u = 0; u < 30; ++u) {
+    emu.placeFinger((uint16_t)u, 100, (uint8_t)(u % SLOTS_PER_USER));
+    const uint64_t t0 = VirtualClock::nowUs();
+    bool ok = false;
+    if (chip.getImage() == FINGERPRINT_OK && chip.image2Tz(1) == FINGERPRINT_OK)
+      ok = chip.fingerFastSearch() == FINGERPRINT_OK && chip.fingerID / SLOTS_PER_USER == u;
+    lat.add(msSince(t0));
+    hits += ok;
+    emu.liftFinger();
+    delay(500);
+  }
+  printf("hits=%d/30  latency ms p50=%.1f p95=%.1f max=%.1f\n",
+         hits, lat.pct(0.5), lat.pct(0.95), lat.pct(1.0));
+}
+
+// ---------------------------------------------------------------------------
+// Verify 1:1 (Search en los 5 slots del usuario declarado) contra 1:N en toda
+// la base llena (200 usuarios, 1000 slots). Sólo la búsqueda, tras Img2Tz.
+void benchVerify() {
+  printf("\n== Verify 1:1 (Search de 5 slots) vs 1:N (Search 0..1000), base llena ==\n");
+  constexpr int USERS = 200;
+  R305Emulator emu(57600);
+  enrollUsers(emu, USERS);
+  FingerSerial.attach(&emu);
+  FingerprintModel fp(FingerSerial, 25, 26);
+  fp.begin(57600);
+  auto& chip = fp.chip();
+  { Preferences p; p.begin("slots", false); p.clear(); p.end(); }
+  SlotMap slots(fp);
+  slots.begin();                                   // layout clásico id*5
+
+  Series full, one;
+  int fullHits = 0, oneHits = 0, impostorOk = 0;
+  for (int i = 0; i < 40; ++i) {
+    const uint16_t u = (uint16_t)(i * 5 % USERS);
+    emu.placeFinger(u, 100, (uint8_t)(i % SLOTS_PER_USER));
+    if (chip.getImage() != FINGERPRINT_OK || chip.image2Tz(1) != FINGERPRINT_OK) { emu.liftFinger(); continue; }
+    uint16_t page, score;
+    uint64_t t0 = VirtualClock::nowUs();
+    fullHits += fp.searchRange(1, 0, USERS * SLOTS_PER_USER, page, score) == FINGERPRINT_OK && page / SLOTS_PER_USER == u;
+    full.add(msSince(t0));
+    t0 = VirtualClock::nowUs();
+    oneHits += slots.verify(u, 1, page, score) == FINGERPRINT_OK;
+    one.add(msSince(t0));
+    // mismo dedo declarando otro usuario: debe rechazar
+    impostorOk += slots.verify((uint16_t)((u + 1) % USERS), 1, page, score) == FINGERPRINT_OK;
+    emu.liftFinger();
+  }
+  printf("1:N  hits=%d/40  search ms p50=%.1f max=%.1f\n", fullHits, full.pct(0.5), full.pct(1.0));
+  printf("1:1  hits=%d/40  search ms p50=%.1f max=%.1f  impostor aceptado=%d/40\n",
+         oneHits, one.pct(0.5), one.pct(1.0), impostorOk);
+}
+
+// ---------------------------------------------------------------------------
+// SlotMap: migración del layout id*5, enrol de un ID que el layout fijo
+// rechazaba, bajas con huecos y compactación.
+void benchSlots() {
+  printf("\n== SlotMap: ocupación + dueños (30 usuarios legacy, capacidad 1000) ==\n");
+  R305Emulator emu(57600);
+  enrollUsers(emu, 30);
+  FingerSerial.attach(&emu);
+  FingerprintModel fp(FingerSerial, 25, 26);
+  fp.begin(57600);
+  { Preferences p; p.begin("slots", false); p.clear(); p.end(); }
+
+  SlotMap slots(fp);
+  uint64_t t0 = VirtualClock::nowUs();
+  slots.begin();
+  const double bootMs = msSince(t0);
+  int legacyOk = 0;
+  for (uint16_t s = 0; s < 150; ++s) legacyOk += slots.userOf(s) == s / SLOTS_PER_USER;
+  printf("begin (ReadIndexTable + NVS) %.0f ms  ocupados=%u  dueños legacy ok=%d/150\n",
+         bootMs, slots.used(), legacyOk);
+
+  // ID 500: con id*5 caía en el slot 2500 > capacidad
+  uint16_t got[SlotMap::MAX_PER_USER];
+  const bool alloc = slots.allocate(500, 5, got);
+  for (int i = 0; alloc && i < 5; ++i) { emu.storeTemplate(got[i], 500, (uint8_t)i); slots.assign(got[i], 500); }
+  printf("enrol ID 500: %s slots %u..%u\n", alloc ? "ok" : "sin espacio", got[0], got[4]);
+
+  // bajas: quedan huecos de 5 entre usuarios
+  for (uint16_t u : {2, 9, 17, 25}) slots.removeUser(u);
+  slots.save();
+  printf("tras 4 bajas: ocupados=%u hueco libre más grande=%u\n", slots.used(), slots.largestFree());
+
+  uint16_t moves = 0;
+  t0 = VirtualClock::nowUs();
+  slots.compact(&moves);
+  const double compactMs = msSince(t0);
+  SearchRange runs[SlotMap::MAX_RUNS];
+  int contiguous = 0, users = 0;
+  for (uint16_t u = 0; u <= 500; ++u) {
+    const uint8_t n = slots.runsOf(u, runs, SlotMap::MAX_RUNS);
+    if (!n) continue;
+    ++users;
+    contiguous += n == 1;
+  }
+  printf("compactar: %u movidas en %.0f ms  hueco libre=%u  usuarios contiguos=%d/%d\n",
+         moves, compactMs, slots.largestFree(), contiguous, users);
+
+  // las plantillas movidas siguen respondiendo al verify y al dueño
+  int verOk = 0, idOk = 0;
+  auto& chip = fp.chip();
+  for (uint16_t u : {0, 1, 3, 16, 29, 500}) {
+    emu.placeFinger(u, 100, 0);
+    uint16_t page = 0, score = 0;
+    if (chip.getImage() == FINGERPRINT_OK && chip.image2Tz(1) == FINGERPRINT_OK &&
+        slots.verify(u, 1, page, score) == FINGERPRINT_OK) {
+      ++verOk;
+      idOk += slots.userOf(page) == u;
+    }
+    emu.liftFinger();
+  }
+  SlotMap again(fp);
+  again.begin();
+  int same = 0;
+  for (uint16_t s = 0; s < 1000; ++s) same += again.userOf(s) == slots.userOf(s);
+  printf("verify tras compactar=%d/6 dueño ok=%d/6  tabla recargada de NVS igual=%d/1000\n",
+         verOk, idOk, same);
+
+  // un usuario en slots sueltos (más tramos que MAX_RUNS): el verify prueba todos
+  constexpr uint8_t SCATTERED = SlotMap::MAX_RUNS + 4;
+  const uint16_t base = 1000 - 2 * SCATTERED;
+  for (uint8_t i = 0; i < SCATTERED; ++i) {
+    emu.storeTemplate((uint16_t)(base + 2 * i), 600, i);
+    slots.assign((uint16_t)(base + 2 * i), 600);
+  }
+  int scatteredOk = 0;
+  for (uint8_t i = 0; i < SCATTERED; ++i) {
+    emu.placeFinger(600, 100, i);
+    uint16_t page = 0, score = 0;
+    scatteredOk += chip.getImage() == FINGERPRINT_OK && chip.image2Tz(1) == FINGERPRINT_OK &&
+                   slots.verify(600, 1, page, score) == FINGERPRINT_OK;
+    emu.liftFinger();
+  }
+  printf("verify con %u tramos sueltos=%d/%u\n", SCATTERED, scatteredOk, SCATTERED);
+}
+
+// ---------------------------------------------------------------------------
+// 1:N por zonas: 200 usuarios en 4 zonas de 250 slots; la puerta es de la
+// zona 2 y el 80 % de los dedos son de ahí. Sólo la búsqueda, tras Img2Tz.
+void benchZones() {
+  printf("\n== SearchEngine: 1:N en zonas (4 x 250 slots, puerta en zona 2) ==\n");
+  constexpr int USERS = 200, SCANS = 100;
+  R305Emulator emu(57600);
+  enrollUsers(emu, USERS);
+  FingerSerial.attach(&emu);
+  FingerprintModel fp(FingerSerial, 25, 26);
+  fp.begin(57600);
+  SearchEngine engine(fp);
+  engine.begin();
+  auto& chip = fp.chip();
+
+  auto run = [&](const char* label, int mode) {
+    Series lat;
+    int hits = 0;
+    for (int i = 0; i < SCANS; ++i) {
+      // usuarios 100..149 = zona 2; uno de cada 5 de las otras zonas
+      const int other = (i * 13) % 150;
+      const uint16_t u = (uint16_t)((i % 5) ? 100 + i % 50 : (other < 100 ? other : other + 50));
+      emu.placeFinger(u, 100, (uint8_t)(i % SLOTS_PER_USER));
+      if (chip.getImage() == FINGERPRINT_OK && chip.image2Tz(1) == FINGERPRINT_OK) {
+        uint16_t page = 0, score = 0;
+        int zone;
+        const uint64_t t0 = VirtualClock::nowUs();
+        bool ok;
+        if (mode == 0) ok = chip.fingerFastSearch() == FINGERPRINT_OK && (page = chip.fingerID, true);
+        else ok = engine.search(1, page, score, zone) == FINGERPRINT_OK;
+        lat.add(msSince(t0));
+        hits += ok && page / SLOTS_PER_USER == u;
+      }
+      emu.liftFinger();
+    }
+    printf("%-28s hits=%3d/%d  search ms p50=%.1f p95=%.1f\n", label, hits, SCANS,
+           lat.pct(0.5), lat.pct(0.95));
+  };
+  run("fingerFastSearch (0..163)", 0);
+  engine.configure("", "");
+  run("base completa (0..999)", 1);
+  engine.configure("0-249,250-499,500-749,750-999", "2,0,1,3");
+  run("zona 2 + fallback 0,1,3", 1);
+  char json[1280];
+  engine.statsJson(json, sizeof(json));
+  printf("%s\n", json);
+}
+
+// ---------------------------------------------------------------------------
+// CPU real del host (no reloj virtual): bitmap 64x64 por drawBitmap vs blit de
+// la versión en páginas. También verifica que ambos dejen el mismo frame.
+void benchRender() {
+  printf("\n== DisplayModel::drawImage: drawBitmap vs blit en páginas (CPU host) ==\n");
+  Adafruit_SH1106G oled(128, 64, &Wire, -1);
+  DisplayModel display(oled, 2);
+  const uint8_t* const imgs[] = {FP_64x64_25, FP_64x64_1, FP_64x64_50, FP_64x64_75, FP_64x64,
+                                 ICON_OK_64, ICON_ERR_64, ICON_PERMAQUIM_64};
+  constexpr int N = sizeof(imgs) / sizeof(imgs[0]);
+  constexpr int ROUNDS = 2000;
+  uint8_t ref[1024];
+
+  // sobre un fondo con dibujo: opaco lo tapa, transparente sólo suma píxeles
+  int mismatches = 0;
+  for (bool opaque : {true, false}) {
+    for (int x : {0, 32, 66}) {
+      for (const uint8_t* img : imgs) {
+        memset(oled.getBuffer(), 0xA5, sizeof(ref));
+        if (opaque) oled.drawBitmap(x, 0, img, 64, 64, SH110X_WHITE, SH110X_BLACK);
+        else        oled.drawBitmap(x, 0, img, 64, 64, SH110X_WHITE);
+        memcpy(ref, oled.getBuffer(), sizeof(ref));
+        memset(oled.getBuffer(), 0xA5, sizeof(ref));
+        display.drawImage(x, 0, img, 64, 64, opaque);
+        mismatches += memcmp(ref, oled.getBuffer(), sizeof(ref)) != 0;
+      }
+    }
+  }
+
+  using Clock = std::chrono::steady_clock;
+  auto t0 = Clock::now();
+  for (int i = 0; i < ROUNDS; ++i)
+    oled.drawBitmap(66, 0, imgs[i % N], 64, 64, SH110X_WHITE, SH110X_BLACK);
+  auto t1 = Clock::now();
+  for (int i = 0; i < ROUNDS; ++i)
+    display.drawImage(66, 0, imgs[i % N], 64, 64, true);
+  auto t2 = Clock::now();
+  for (int i = 0; i < ROUNDS; ++i)
+    display.drawImage(66, 0, imgs[i % N], 64, 64);
+  auto t3 = Clock::now();
+  const double gfxNs  = std::chrono::duration<double, std::nano>(t1 - t0).count() / ROUNDS;
+  const double blitNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / ROUNDS;
+  const double orNs   = std::chrono::duration<double, std::nano>(t3 - t2).count() / ROUNDS;
+  printf("drawBitmap ns/frame=%.0f  blit ns/frame=%.0f  (x%.0f)  blit OR ns/frame=%.0f  frames distintos=%d\n",
+         gfxNs, blitNs, blitNs > 0 ? gfxNs / blitNs : 0.0, orNs, mismatches);
+}
+
+// ---------------------------------------------------------------------------
+// NamesModel: lookup con Preferences::getString (antes) vs arena en RAM, e
+// importación de 1000 nombres: escrituras NVS con nombres nuevos y repetidos.
+void benchNames() {
+  printf("\n== NamesModel: 1000 usuarios (CPU host, escrituras NVS) ==\n");
+  constexpr uint16_t USERS = 1000;
+  constexpr int ROUNDS = 20;
+  std::unique_ptr<NamesModel> names(new NamesModel());
+  names->begin();
+  char name[32];
+
+  uint32_t c0 = hostNvsWrites();
+  for (uint16_t id = 0; id < USERS; ++id) {
+    snprintf(name, sizeof(name), "Usuario %u", id);
+    names->set(id, name);
+  }
+  const uint32_t changed = hostNvsWrites() - c0;
+  // el mismo import otra vez: nada cambia, nada se escribe
+  c0 = hostNvsWrites();
+  for (uint16_t id = 0; id < USERS; ++id) {
+    snprintf(name, sizeof(name), "Usuario %u", id);
+    names->set(id, name);
+  }
+  const uint32_t unchanged = hostNvsWrites() - c0;
+
+  // recarga desde NVS y verificación tras compactar varias veces
+  names.reset(new NamesModel());
+  names->begin();
+  int wrong = 0;
+  for (int round = 0; round < 3; ++round)
+    for (uint16_t id = 0; id < USERS; ++id) {
+      snprintf(name, sizeof(name), "P%u-%d%s", id, round, id % 5 ? "" : " con apellido");
+      names->set(id, name);
+    }
+  for (uint16_t id = 0; id < USERS; ++id) {
+    snprintf(name, sizeof(name), "P%u-2%s", id, id % 5 ? "" : " con apellido");
+    name[NamesModel::NAME_MAX] = '\0';
+    wrong += strcmp(names->get(id), name) != 0;
+  }
+
+  Preferences prefs;
+  prefs.begin("users", false);
+  using Clock = std::chrono::steady_clock;
+  size_t sink = 0;
+  auto t0 = Clock::now();
+  for (int r = 0; r < ROUNDS; ++r)
+    for (uint16_t id = 0; id < USERS; ++id) {
+      char key[8]; snprintf(key, sizeof(key), "id%03u", id);
+      sink += prefs.getString(key, "").length();
+    }
+  auto t1 = Clock::now();
+  for (int r = 0; r < ROUNDS; ++r)
+    for (uint16_t id = 0; id < USERS; ++id) sink += strlen(names->get(id));
+  auto t2 = Clock::now();
+  const double prefsNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / (ROUNDS * USERS);
+  const double arenaNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / (ROUNDS * USERS);
+  printf("get ns: Preferences=%.0f arena=%.1f (x%.0f)  [%zu]\n",
+         prefsNs, arenaNs, arenaNs > 0 ? prefsNs / arenaNs : 0.0, sink);
+  printf("escrituras NVS import: nombres nuevos=%u  repetido sin cambios=%u\n", changed, unchanged);
+  printf("nombres=%u derramados=%u arena usada=%zu vigente=%zu de %d  incorrectos=%d\n",
+         names->count(), names->spilled(), names->arenaUsed(), names->arenaLive(),
+         FP_NAMES_ARENA, wrong);
+
+  // /fp/users: exportar en pedazos chicos, vaciar e importar lo exportado en
+  // pedazos de otro tamaño (como llegan los cuerpos de AsyncWebServer)
+  names->set(7, "Pérez, \"Tito\"");
+  names->set(8, "Ünïcödé ñandú");
+  for (NamesFormat fmt : {NamesFormat::Csv, NamesFormat::Ndjson}) {
+    std::string dump;
+    NamesExporter exp(*names, fmt);
+    uint8_t chunk[97];
+    size_t n, chunks = 0;
+    while ((n = exp.fill(chunk, sizeof(chunk))) > 0) { dump.append((const char*)chunk, n); ++chunks; }
+
+    std::unique_ptr<NamesModel> fresh(new NamesModel());
+    prefs.clear();
+    fresh->begin();
+    NamesImporter imp;
+    imp.begin(*fresh, fmt);
+    const uint32_t c1 = hostNvsWrites();
+    for (size_t off = 0; off < dump.size(); off += 61)
+      imp.feed((const uint8_t*)dump.data() + off, min<size_t>(61, dump.size() - off));
+    imp.finish();
+    int diff = 0;
+    for (uint16_t id = 0; id < USERS; ++id) diff += strcmp(fresh->get(id), names->get(id)) != 0;
+    printf("%-6s export=%zu bytes en %zu pedazos  import: líneas=%u ok=%u errores=%u escrituras=%u  "
+           "distintos=%d  (importador %zu bytes)\n",
+           fmt == NamesFormat::Csv ? "csv" : "ndjson", dump.size(), chunks, imp.lines(),
+           imp.imported(), imp.errors(), hostNvsWrites() - c1, diff, sizeof(NamesImporter));
+    // restaurar para el siguiente formato
+    names.reset(new NamesModel());
+    names->begin();
+  }
+  prefs.clear();
+  prefs.end();
+}
+
+// ---------------------------------------------------------------------------
+// EventBus con hilos reales del host: 2 productores inundan la prioridad baja
+// (prompts), 1 publica resultados; un consumidor lento. Verifica que no se
+// pierda nada sin contarlo y que los resultados no sean desplazados. Usa el
+// scheduler real del host: los números varían entre corridas.
+void benchEventBus() {
+  printf("\n== EventBus (MPSC, 2 prioridades, 16 slots c/u) ==\n");
+  struct Ev { uint32_t seq; uint8_t producer; uint32_t n; };
+  EventBus<Ev, 16> bus;
+  std::atomic<uint32_t> seq{0};
+  std::atomic<int> running{3};
+  constexpr uint32_t LOW_PER_PRODUCER = 200000, RESULTS = 2000;
+
+  auto producer = [&](uint8_t id, uint32_t count, bool high) {
+    for (uint32_t i = 0; i < count; ++i) {
+      bus.publish(Ev{seq.fetch_add(1) + 1, id, i}, high ? bus.HIGH_PRIO : bus.LOW_PRIO);
+      if (high) std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    running.fetch_sub(1);
+  };
+
+  uint32_t got[3] = {0, 0, 0}, last[3] = {0, 0, 0}, outOfOrder = 0;
+  bool first[3] = {true, true, true};
+  std::thread consumer([&] {
+    Ev ev;
+    for (;;) {
+      if (bus.next(ev)) {
+        if (!first[ev.producer] && ev.n <= last[ev.producer]) ++outOfOrder;
+        first[ev.producer] = false;
+        last[ev.producer] = ev.n;
+        ++got[ev.producer];
+        std::this_thread::sleep_for(std::chrono::microseconds(5));
+      } else if (running.load() == 0 && !bus.peek()) {
+        break;
+      }
+    }
+  });
+  std::thread p0(producer, 0, LOW_PER_PRODUCER, false);
+  std::thread p1(producer, 1, LOW_PER_PRODUCER, false);
+  std::thread p2(producer, 2, RESULTS, true);
+  p0.join(); p1.join(); p2.join(); consumer.join();
+
+  const auto st = bus.stats();
+  const uint32_t lowSent = 2 * LOW_PER_PRODUCER;
+  printf("baja: publicados=%u entregados=%u descartados=%u (%s)\n", lowSent, got[0] + got[1],
+         st.dropped[0], got[0] + got[1] + st.dropped[0] == lowSent ? "cuadra" : "NO cuadra");
+  printf("alta: publicados=%u entregados=%u descartados=%u  fuera de orden=%u\n",
+         RESULTS, got[2], st.dropped[1], outOfOrder);
+}
+
+// ---------------------------------------------------------------------------
+// AccessJournal sobre la partición "spiffs" por defecto (1,375 MB) emulada:
+// arranque, append, corte de energía a mitad de un registro, vuelta del
+// anillo y exportación paginada como la haría el backend.
+JournalRecord journalEvent(int i) {
+  JournalRecord r = {};
+  r.user = (int16_t)(i % 30);
+  r.slot = (int16_t)(r.user * SLOTS_PER_USER);
+  r.score = 100;
+  r.claimed = -1;
+  r.outcome = (uint8_t)(i % 10 ? JournalOutcome::Match : JournalOutcome::NoMatch);
+  r.latencyMs = 840;
+  return r;
+}
+
+// Agrega `n` eventos con flush cada 8 (lo que junta loop() entre vueltas)
+void journalAppend(AccessJournal& j, int first, int n) {
+  for (int i = 0; i < n; ++i) {
+    j.log(journalEvent(first + i));
+    if (i % 8 == 7 || i == n - 1) j.flush();
+  }
+}
+
+// Pagina como el backend (from = último + 1) y cuenta saltos de seq entre páginas
+uint32_t journalPull(AccessJournal& j, uint32_t limit, uint32_t& pages, uint32_t& gaps, size_t& bytes) {
+  uint32_t total = 0, last = 0, from = 0;
+  pages = gaps = 0;
+  bytes = 0;
+  for (;;) {
+    JournalQuery q;
+    q.fromSeq = from;
+    q.limit = limit;
+    JournalExporter exp(j, q);
+    uint8_t buf[1436];                     // un segmento TCP
+    std::string body;
+    for (size_t n; (n = exp.fill(buf, sizeof(buf))) > 0; ) body.append((const char*)buf, n);
+    bytes += body.size();
+    if (!exp.sent()) break;
+    ++pages;
+    total += exp.sent();
+    const uint32_t first = (uint32_t)strtoul(body.c_str() + body.find('\n') + 1, nullptr, 10);
+    if (last && first != last + 1) ++gaps;
+    last = (uint32_t)strtoul(body.c_str() + body.rfind('\n', body.size() - 2) + 1, nullptr, 10);
+    from = last + 1;
+  }
+  return total;
+}
+
+void benchJournal() {
+  printf("\n== AccessJournal (partición spiffs 1,375 MB, registros de 32 B) ==\n");
+  hostFlashReset(0x160000);
+
+  uint64_t t0 = VirtualClock::nowUs();
+  std::unique_ptr<AccessJournal> j(new AccessJournal());
+  j->begin();
+  printf("arranque vacío: %.1f ms  capacidad=%u registros\n", msSince(t0), j->stats().capacity);
+
+  // Wi-Fi caído en hora pico: 2000 accesos (la cola SSE guarda 16)
+  t0 = VirtualClock::nowUs();
+  journalAppend(*j, 0, 2000);
+  JournalStats st = j->stats();
+  printf("2000 accesos: %.3f ms/registro (con borrados)  sectores borrados=%u descartados=%u\n",
+         msSince(t0) / 2000, st.erases, st.dropped);
+
+  // corte de energía grabando el registro 2001: sólo 13 de 32 bytes
+  hostFlashTearNextWrite(13);
+  journalAppend(*j, 2000, 1);
+  j.reset(new AccessJournal());
+  t0 = VirtualClock::nowUs();
+  j->begin();
+  const double bootMs = msSince(t0);
+  journalAppend(*j, 2001, 99);
+  st = j->stats();
+  uint32_t pages, gaps;
+  size_t bytes;
+  uint32_t got = journalPull(*j, 1000, pages, gaps, bytes);
+  printf("tras corte: arranque %.1f ms  dañados=%u  seq %u..%u  leídos=%u en %u páginas (saltos=%u)\n",
+         bootMs, st.badRecords, st.oldest, st.newest, got, pages, gaps);
+
+  // vuelta del anillo: llenar de más y arrancar de nuevo
+  journalAppend(*j, 2100, (int)st.capacity);
+  j.reset(new AccessJournal());
+  t0 = VirtualClock::nowUs();
+  j->begin();
+  const double wrapBootMs = msSince(t0);
+  st = j->stats();
+  const HostFlashStats fs0 = hostFlashStats();
+  t0 = VirtualClock::nowUs();
+  got = journalPull(*j, 5000, pages, gaps, bytes);
+  const double pullMs = msSince(t0);
+  const HostFlashStats fs1 = hostFlashStats();
+  printf("tras una vuelta: arranque %.1f ms  seq %u..%u (%u legibles)  sectores borrados=%u\n",
+         wrapBootMs, st.oldest, st.newest, st.newest - st.oldest + 1, fs1.erases);
+  printf("exportar todo (CSV, páginas de 5000): %u registros en %u páginas, %.0f KB, flash %.0f ms "
+         "(%u lecturas) saltos=%u\n",
+         got, pages, bytes / 1024.0, pullMs, fs1.reads - fs0.reads, gaps);
+}
+
+// Consumidor de AutoMode::onResult: instante de entrega y pulso del relé
+struct DeliveryProbe {
+  uint64_t   t0 = 0;
+  Series     deliver;
+  DoorRelay* relay = nullptr;
+  uint32_t   relayMs = 0;
+  std::vector<uint32_t> ids;   // requestId de cada resultado, en orden de entrega
+  int        ok = 0;
+  int        recovered = 0;   // ok tras recapturar
+  std::vector<PolicyReason> reasons;
+  std::vector<uint8_t>  retries;
+};
+
+void probeResult(void* ctx, const ScanOutcome& r) {
+  DeliveryProbe& p = *static_cast<DeliveryProbe*>(ctx);
+  p.deliver.add(msSince(p.t0));
+  p.ids.push_back(r.requestId);
+  p.retries.push_back(r.retries);
+  p.reasons.push_back(r.reason);
+  if (r.ok) { ++p.ok; p.recovered += r.retries > 0; p.relay->pulse(p.relayMs); }
+}
+
+// ---------------------------------------------------------------------------
+// touchPin >= 0: la línea touch del sensor sale del guion del emulador.
+void benchAutoModePipeline(int scans, int touchPin) {
+  printf("\n== AutoMode: requestScan -> resultado en pantalla (%d scans, %s) ==\n", scans,
+         touchPin >= 0 ? "línea touch + ISR" : "polling GenImg");
+  R305Emulator emu(57600);
+  enrollUsers(emu, 30);
+  FingerSerial.attach(&emu);
+  if (touchPin >= 0)
+    hostBindPin((uint8_t)touchPin, [&emu] { return emu.fingerPresentAt(VirtualClock::nowUs()) ? HIGH : LOW; });
+
+  Wire.begin(21, 22);
+  Wire.setClock(400000);
+  Adafruit_SH1106G oled(128, 64, &Wire, -1);
+  DisplayModel display(oled, 2);
+  FingerprintModel fp(FingerSerial, 25, 26, touchPin);
+  NamesModel names;
+  SensorWorker worker;
+  SearchEngine search(fp);
+  SlotMap slots(fp);
+  AutoMode autoMode(display, fp, names, worker, search, slots);
+  const uint8_t RELAY_PIN = 32;
+  DoorRelay relay(RELAY_PIN, true);
+  DeliveryProbe probe;
+  probe.relay = &relay;
+
+  display.begin(0x3C);
+  names.begin();
+  fp.begin(57600);
+  { Preferences p; p.begin("slots", false); p.clear(); p.end(); }
+  { Preferences p; p.begin("auto", false); p.clear(); p.end(); }
+  slots.begin();
+  worker.begin(false, 4, fp.uartLock());   // cooperativo: el loop del benchmark hace pump()
+  relay.begin();
+  autoMode.onResult(&probeResult, &probe);
+  autoMode.begin();
+  probe.relayMs = autoMode.timing().relayMs;
+  fpMetricsReset();
+
+  Series toResult, toRelay, cycle;
+  uint64_t i2cBytes = 0, genImg = 0;
+  const FlushStats flush0 = display.flushStats();
+  const uint64_t runStart = VirtualClock::nowUs();
+  for (int i = 0; i < scans; ++i) {
+    const int user = i % 30;
+    emu.resetStats();
+    Wire.resetStats();
+    const uint64_t t0 = VirtualClock::nowUs();
+    emu.scheduleFinger(t0 + 250000, user, 100, (uint8_t)(i % SLOTS_PER_USER));
+    emu.scheduleFinger(t0 + 1750000, -1);
+    probe.t0 = t0;
+    requestScan(15000);
+
+    bool relayOn = false;
+    const bool shown = spinUntil(20000, [&] {
+      autoMode.tick();
+      relay.loop();
+      worker.pump();
+      if (!relayOn && digitalRead(RELAY_PIN) == HIGH) { relayOn = true; toRelay.add(msSince(t0)); }
+      return autoMode.currentState() == AutoState::COOLDOWN;
+    });
+    if (shown) toResult.add(msSince(t0));
+    spinUntil(20000, [&] {
+      autoMode.tick();
+      relay.loop();
+      worker.pump();
+      return autoMode.currentState() == AutoState::WAIT_FINGER;
+    });
+    cycle.add(msSince(t0));
+    i2cBytes += Wire.bytesWritten();
+    genImg += emu.commands(0x01);
+  }
+  const double totalMin = msSince(runStart) / 60000.0;
+  printf("scan->result ms p50=%.1f p99=%.1f   ciclo ms p50=%.1f\n",
+         toResult.pct(0.5), toResult.pct(0.99), cycle.pct(0.5));
+  printf("scan->entrega (SSE) ms p50=%.1f p99=%.1f   scan->relé ms p50=%.1f (pulsos=%u, apagado=%s)\n",
+         probe.deliver.pct(0.5), probe.deliver.pct(0.99), toRelay.pct(0.5), relay.pulses(),
+         relay.on() ? "no" : "sí");
+  printf("throughput=%.1f scans/min   I2C bytes/scan=%llu   GenImg/scan=%.1f\n",
+         scans / totalMin, (unsigned long long)(i2cBytes / scans), (double)genImg / scans);
+  printf("sensor jobs completados=%u rechazados=%u\n", worker.completed(), worker.rejected());
+  const FlushStats& fs = display.flushStats();
+  const uint32_t frames = fs.frames - flush0.frames;
+  printf("display frames=%u  bytes/frame=%.1f (frame completo=1024)\n",
+         frames, frames ? (double)(fs.totalBytes - flush0.totalBytes) / frames : 0.0);
+  const TouchStats& ts = fp.touchStats();
+  printf("pollFinger: GenImg enviados=%u evitados=%u flancos touch=%u\n",
+         ts.uartPolls, ts.uartSaved, ts.edges);
+  // histogramas de ScanMetrics contra la medición exacta del benchmark
+  StdoutPrint out;
+  fpMetricsPrint(out);
+  printf("total p50 histograma=%.1f ms (exacto %.1f)\n",
+         fpMetricsQuantileUs(MetricStage::Total, 0.5f) / 1000.0, toResult.pct(0.5));
+  if (touchPin >= 0) hostBindPin((uint8_t)touchPin, nullptr);
+}
+
+// ---------------------------------------------------------------------------
+// Cola de ScanRequest: 4 clientes encolan 2 pedidos cada uno a la vez (ids
+// únicos sin locks), uno con timeout corto que vence esperando; AutoMode los
+// atiende en orden y cada resultado vuelve con el id de su pedido.
+void benchScanQueue() {
+  printf("\n== ScanRequest: cola de peticiones (4 clientes x 2, una vence en espera) ==\n");
+  R305Emulator emu(57600);
+  enrollUsers(emu, 30);
+  FingerSerial.attach(&emu);
+  Wire.begin(21, 22);
+  Adafruit_SH1106G oled(128, 64, &Wire, -1);
+  DisplayModel display(oled, 2);
+  FingerprintModel fp(FingerSerial, 25, 26, -1);
+  NamesModel names;
+  SensorWorker worker;
+  SearchEngine search(fp);
+  SlotMap slots(fp);
+  AutoMode autoMode(display, fp, names, worker, search, slots);
+  DoorRelay relay(-1, true);
+  DeliveryProbe probe;
+  probe.relay = &relay;
+  display.begin(0x3C);
+  names.begin();
+  fp.begin(57600);
+  { Preferences p; p.begin("slots", false); p.clear(); p.end(); }
+  slots.begin();
+  worker.begin(false, 4, fp.uartLock());
+  autoMode.onResult(&probeResult, &probe);
+  autoMode.begin();
+  fpMetricsReset();
+
+  // dos pedidos de 60 s, uno de 3 s que queda tercero y 8 concurrentes de 60 s
+  // (cada ciclo de scan dura ~5,7 s: el de 3 s vence antes de su turno)
+  std::vector<uint32_t> issued;
+  std::atomic<int> full{0};
+  std::mutex m;
+  probe.t0 = VirtualClock::nowUs();
+  issued.push_back(requestScan(60000, ScanOrigin::Remote));
+  issued.push_back(requestScan(60000, ScanOrigin::Remote));
+  const uint32_t shortId = requestScan(3000, ScanOrigin::Remote);
+  issued.push_back(shortId);
+  std::vector<std::thread> clients;
+  for (int c = 0; c < 4; ++c)
+    clients.emplace_back([&, c] {
+      for (int k = 0; k < 2; ++k) {
+        const uint32_t id = c % 2 ? requestVerify((uint16_t)c, 60000, ScanOrigin::Http)
+                                  : requestScan(60000, ScanOrigin::Http);
+        std::lock_guard<std::mutex> g(m);
+        if (id) issued.push_back(id); else ++full;
+      }
+    });
+  for (auto& t : clients) t.join();
+  std::vector<uint32_t> sorted(issued);
+  std::sort(sorted.begin(), sorted.end());
+  const bool unique = std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end();
+
+  // un dedo por pedido activo: el del usuario declarado (verify) o i % 30
+  uint32_t lastServed = 0;
+  int served = 0;
+  spinUntil(120000, [&] {
+    autoMode.tick();
+    worker.pump();
+    const uint32_t active = activeRequestId();
+    if (active && active != lastServed && autoMode.currentState() == AutoState::WAIT_FINGER) {
+      lastServed = active;
+      ++served;
+      const int user = claimedUser() >= 0 ? claimedUser() : (int)(active % 30);
+      const uint64_t now = VirtualClock::nowUs();
+      emu.scheduleFinger(now + 250000, user, 100, 0);
+      emu.scheduleFinger(now + 1750000, -1);
+    }
+    // sin isScanRequested(): tomaría el próximo pedido fuera de AutoMode
+    return served > 0 && !activeRequestId() && !scanQueueDepth() && autoMode.currentState() == AutoState::WAIT_FINGER;
+  });
+  bool inOrder = true;
+  for (size_t i = 1; i < probe.ids.size(); ++i) inOrder = inOrder && probe.ids[i] > probe.ids[i - 1];
+  bool shortDelivered = false;
+  for (uint32_t id : probe.ids) shortDelivered = shortDelivered || id == shortId;
+  printf("encolados=%zu rechazados (cola llena)=%d ids únicos=%s\n", issued.size(), full.load(),
+         unique ? "sí" : "NO");
+  printf("resultados=%zu en orden=%s  #%u (3 s) %s  sin resultado=%zu\n", probe.ids.size(),
+         inOrder ? "sí" : "NO", (unsigned)shortId, shortDelivered ? "ATENDIDO" : "vencido sin usar el sensor",
+         issued.size() - probe.ids.size());
+  printf("entrega p50 (desde que se encolaron todos)=%.0f ms  último=%.0f ms\n", probe.deliver.pct(0.5),
+         probe.deliver.pct(1.0));
+}
+
+// ---------------------------------------------------------------------------
+// /api/*: ciclo de vida de un job (202 -> queued -> running -> done -> SSE
+// una vez) con el server en memoria, y 503 con la cola del sensor llena.
+void benchWebApiJobs() {
+  printf("\n== WebApi: jobs /api sobre SensorWorker ==\n");
+  R305Emulator emu(57600);
+  enrollUsers(emu, 30);
+  emu.addLookalike(200, 12 * SLOTS_PER_USER, 60);   // score bajo: lo rechaza la política
+  FingerSerial.attach(&emu);
+  FingerprintModel fp(FingerSerial, 25, 26);
+  fp.begin(57600);
+  { Preferences p; p.begin("slots", false); p.clear(); p.end(); }
+  { Preferences p; p.begin("policy", false); p.clear(); p.end(); }
+  SlotMap slots(fp);
+  slots.begin();
+  SearchEngine search(fp);
+  search.begin();
+  MatchPolicy policy(fp, slots);
+  policy.begin();
+  SensorWorker worker;
+  worker.begin(false, 4, fp.uartLock());
+  FingerprintService svc(FingerSerial, 25, 26);
+  svc.attach(fp.detectedBaud());
+  AsyncWebServer server(80);
+  WebApi api(server, svc, worker, &slots, &search, &policy);
+  api.begin();
+  api.events().clients = 1;
+  while (worker.pump()) {}                       // caché inicial (count/capacity)
+
+  struct Reply { int code; std::string body; };
+  auto http = [&](WebRequestMethodComposite m, const char* url, const char* id) {
+    AsyncWebServerRequest req(m, url);
+    if (id) req.addParam("id", id);
+    if (!server.dispatch(req) || !req.response()) return Reply{404, ""};
+    return Reply{req.response()->code, req.response()->body.c_str()};
+  };
+  auto jobOf = [](const Reply& r) {
+    const size_t at = r.body.find("\"job\":");
+    return at == std::string::npos ? 0u : (unsigned)strtoul(r.body.c_str() + at + 6, nullptr, 10);
+  };
+  auto state = [&](unsigned job) {
+    const std::string id = std::to_string(job);
+    const Reply r = http(HTTP_GET, "/api/job", id.c_str());
+    const size_t at = r.body.find("\"state\":\"");
+    return r.code != 200 || at == std::string::npos ? std::string("?") : r.body.substr(at + 9, r.body.find('"', at + 9) - at - 9);
+  };
+
+  const Reply count0 = http(HTTP_GET, "/api/count", nullptr);
+  const Reply match = http(HTTP_POST, "/api/match", nullptr);
+  const unsigned matchJob = jobOf(match);
+  const std::string queued = state(matchJob);
+  emu.placeFinger(7, 100, 2);
+  const uint64_t t0 = VirtualClock::nowUs();
+  worker.pump();
+  const double matchMs = msSince(t0);
+  emu.liftFinger();
+  const std::string done = state(matchJob);
+  const Reply result = http(HTTP_GET, "/api/job", std::to_string(matchJob).c_str());
+  api.loop();
+  const size_t events1 = api.events().sent.size();
+  api.loop();
+  const size_t events2 = api.events().sent.size();
+
+  // los id son usuarios: el delete borra los 5 slots del 7, el enroll toma
+  // un slot con SlotMap y el match devuelve el dueño (no el slot)
+  const Reply del = http(HTTP_DELETE, "/api/id", "7");
+  worker.pump();
+  const std::string delState = state(jobOf(del));
+  const Reply count1 = http(HTTP_GET, "/api/count", nullptr);
+  int user7Slots = 0;
+  for (uint16_t s = 35; s < 40; ++s) user7Slots += slots.occupied(s);
+
+  auto runJob = [&](const Reply& r) {
+    worker.pump();
+    return http(HTTP_GET, "/api/job", std::to_string(jobOf(r)).c_str()).body;
+  };
+  emu.placeFinger(500, 100, 0);
+  const std::string enrolled = runJob(http(HTTP_POST, "/api/enroll", "500"));
+  const std::string matched500 = runJob(http(HTTP_POST, "/api/match", nullptr));
+  emu.liftFinger();
+  uint16_t got500[SlotMap::MAX_PER_USER];
+  const uint8_t slots500 = slots.slotsOf(500, got500, SlotMap::MAX_PER_USER);
+  emu.placeFinger(200, 100, 0);
+  const std::string impostor = runJob(http(HTTP_POST, "/api/match", nullptr));
+  emu.liftFinger();
+  const Reply badId = http(HTTP_POST, "/api/enroll", "5000");
+
+  int accepted = 0, busy = 0;
+  for (int i = 0; i < 6; ++i) {
+    const Reply r = http(HTTP_POST, "/api/match", nullptr);
+    accepted += r.code == 202;
+    busy += r.code == 503;
+  }
+  while (worker.pump()) {}
+  const Reply unknown = http(HTTP_GET, "/api/job", "999999");
+  const Reply noId = http(HTTP_POST, "/api/enroll", nullptr);
+
+  printf("POST /api/match=%d %s  estado: %s -> %s en %.0f ms\n", match.code,
+         match.body.c_str(), queued.c_str(), done.c_str(), matchMs);
+  printf("resultado: %s\n", result.body.c_str());
+  printf("SSE job: %zu evento(s), repetidos=%zu  DELETE /api/id=7 -> %d %s, slots del 7 ocupados=%d  count %s -> %s\n",
+         events1, events2 - events1, del.code, delState.c_str(), user7Slots,
+         count0.body.c_str(), count1.body.c_str());
+  printf("enroll id=500: %s  slots del 500=%u (slot %d)\n", enrolled.c_str(), slots500,
+         slots500 ? got500[0] : -1);
+  printf("match 500: %s\n", matched500.c_str());
+  printf("match impostor: %s  enroll id=5000 -> %d\n", impostor.c_str(), badId.code);
+  printf("6 matches sin drenar la cola: 202=%d 503=%d  job desconocido=%d  enroll sin id=%d\n",
+         accepted, busy, unknown.code, noId.code);
+}
+
+// ---------------------------------------------------------------------------
+// Recaptura dentro del job: dedos sucios o apoyados a medias. Por cada tipo,
+// 10 scans interactivos; la primera imagen mala (FEATUREFAIL q=40, IMAGEMESS
+// q=20) antes no tenía arreglo: el scan fallaba y había que pedir otro.
+void benchCaptureRetry() {
+  printf("\n== AutoMode: recaptura por imagen mala dentro del job ==\n");
+  R305Emulator emu(57600);
+  enrollUsers(emu, 30);
+  FingerSerial.attach(&emu);
+  Wire.begin(21, 22);
+  Adafruit_SH1106G oled(128, 64, &Wire, -1);
+  DisplayModel display(oled, 2);
+  FingerprintModel fp(FingerSerial, 25, 26, -1);
+  NamesModel names;
+  SensorWorker worker;
+  SearchEngine search(fp);
+  SlotMap slots(fp);
+  AutoMode autoMode(display, fp, names, worker, search, slots);
+  DoorRelay relay(-1, true);
+  DeliveryProbe probe;
+  probe.relay = &relay;
+  display.begin(0x3C);
+  names.begin();
+  fp.begin(57600);
+  { Preferences p; p.begin("slots", false); p.clear(); p.end(); }
+  { Preferences p; p.begin("auto", false); p.clear(); p.end(); }
+  slots.begin();
+  worker.begin(false, 4, fp.uartLock());
+  autoMode.onResult(&probeResult, &probe);
+  autoMode.begin();
+  fpMetricsReset();
+
+  struct Case { const char* name; uint8_t q1; uint32_t badMs; uint32_t liftMs; uint8_t q2; };
+  const Case cases[] = {
+    {"limpio",                     100,    0,    0, 100},
+    {"1a imagen FEATUREFAIL",       40,  450,    0, 100},
+    {"1a imagen IMAGEMESS",         20,  450,    0, 100},
+    {"mala, levanta y re-apoya",    40,  450, 1500, 100},
+    {"mala y no vuelve",            40,  450, 16000, 100},   // sin imagen nueva: no es recaptura
+    {"siempre sucio",               20, 1500,    0,  20},
+  };
+  for (const Case& c : cases) {
+    const size_t first = probe.ids.size();
+    const int ok0 = probe.ok, rec0 = probe.recovered;
+    const uint32_t genImg0 = emu.commands(0x01);
+    Series toDeliver;
+    for (int i = 0; i < 10; ++i) {
+      const int user = i % 30;
+      const uint64_t t0 = VirtualClock::nowUs();
+      const uint8_t posture = (uint8_t)(i % SLOTS_PER_USER);
+      uint64_t t = t0 + 250000;
+      emu.scheduleFinger(t, user, c.q1, posture);
+      if (c.badMs) {
+        t += c.badMs * 1000ULL;
+        if (c.liftMs) { emu.scheduleFinger(t, -1); t += c.liftMs * 1000ULL; }
+        emu.scheduleFinger(t, user, c.q2, posture);
+      }
+      emu.scheduleFinger(t + 1500000, -1);
+      probe.t0 = t0;
+      requestScan(15000);
+      const size_t before = probe.ids.size();
+      spinUntil(20000, [&] { autoMode.tick(); relay.loop(); worker.pump(); return probe.ids.size() > before; });
+      if (probe.ids.size() > before) toDeliver.add(msSince(t0));
+      spinUntil(20000, [&] {
+        autoMode.tick(); relay.loop(); worker.pump();
+        return autoMode.currentState() == AutoState::WAIT_FINGER && !activeRequestId() &&
+               VirtualClock::nowUs() > t + 1500000;
+      });
+    }
+    unsigned retries = 0;
+    for (size_t k = first; k < probe.retries.size(); ++k) retries += probe.retries[k];
+    printf("%-26s ok=%d/%zu recapturas=%u recuperados=%d  petición->entrega p50=%.0f ms  GenImg/scan=%.0f\n",
+           c.name, probe.ok - ok0, probe.ids.size() - first, retries, probe.recovered - rec0,
+           toDeliver.pct(0.5), (emu.commands(0x01) - genImg0) / 10.0);
+  }
+  StdoutPrint out;
+  fpMetricsPrint(out);
+}
+
+// ---------------------------------------------------------------------------
+// MatchPolicy: dedos legítimos limpios y mal apoyados (score en la zona gris)
+// contra impostores que rozan una plantilla de otro usuario (el emulador los
+// hace coincidir con una sola página). Sin política el sensor los acepta a
+// todos; con ella, la zona gris se decide por acuerdo entre los slots del
+// usuario, sin repetir el 1:N.
+void benchMatchPolicy() {
+  printf("\n== MatchPolicy: umbrales de score y acuerdo N-de-5 ==\n");
+  R305Emulator emu(57600);
+  enrollUsers(emu, 30);
+  for (int i = 0; i < 10; ++i) {
+    emu.addLookalike(100 + i, (uint16_t)(i * 3 * SLOTS_PER_USER), 130);      // zona gris
+    emu.addLookalike(200 + i, (uint16_t)(i * 3 * SLOTS_PER_USER + 1), 60);   // score bajo
+  }
+  FingerSerial.attach(&emu);
+  Wire.begin(21, 22);
+  Adafruit_SH1106G oled(128, 64, &Wire, -1);
+  DisplayModel display(oled, 2);
+  FingerprintModel fp(FingerSerial, 25, 26, -1);
+  NamesModel names;
+  SensorWorker worker;
+  SearchEngine search(fp);
+  SlotMap slots(fp);
+  MatchPolicy policy(fp, slots);
+  AutoMode autoMode(display, fp, names, worker, search, slots);
+  DoorRelay relay(-1, true);
+  DeliveryProbe probe;
+  probe.relay = &relay;
+  display.begin(0x3C);
+  names.begin();
+  fp.begin(57600);
+  { Preferences p; p.begin("slots", false); p.clear(); p.end(); }
+  { Preferences p; p.begin("auto", false); p.clear(); p.end(); }
+  { Preferences p; p.begin("policy", false); p.clear(); p.end(); }
+  slots.begin();
+  policy.begin();
+  worker.begin(false, 4, fp.uartLock());
+  autoMode.onResult(&probeResult, &probe);
+  autoMode.begin();
+
+  // precedencia: usuario > zona > horario > "*"
+  policy.configure("*:180/100/2,z1:150,u3:120/90/3,h22-6:200", false);
+  const PolicyRule r0 = policy.ruleFor(7, -1, 12), rz = policy.ruleFor(7, 1, 12),
+                   ru = policy.ruleFor(3, 1, 23), rh = policy.ruleFor(7, -1, 23), rn = policy.ruleFor(7, -1, -1);
+  printf("reglas: base=%u/%u/%u zona1=%u/%u/%u user3(zona1,23h)=%u/%u/%u 23h=%u/%u/%u sin hora=%u/%u/%u\n",
+         r0.accept, r0.floor, r0.agree, rz.accept, rz.floor, rz.agree, ru.accept, ru.floor, ru.agree,
+         rh.accept, rh.floor, rh.agree, rn.accept, rn.floor, rn.agree);
+  printf("reglas inválidas rechazadas: %s\n",
+         !policy.configure("*:50/60", false) && !policy.configure("u1:80/40/0", false) &&
+         !policy.configure("h5-5:80", false) && !policy.configure("x1:80", false) ? "sí" : "NO");
+  policy.configure("*:180/100/2", false);
+
+  struct Case { const char* name; int finger; uint8_t quality; uint8_t posture; bool genuine; };
+  const Case cases[] = {
+    {"legítimo limpio",            -1, 100, 0, true},
+    {"legítimo mal apoyado",       -1,  55, 7, true},
+    {"impostor zona gris (130)",  100, 100, 0, false},
+    {"impostor score bajo (60)",  200, 100, 0, false},
+  };
+  for (int withPolicy = 0; withPolicy < 2; ++withPolicy) {
+    autoMode.setPolicy(withPolicy ? &policy : nullptr);
+    policy.resetStats();
+    printf("%s\n", withPolicy ? "con política *:180/100/2:" : "sin política (cualquier hit es match):");
+    for (const Case& c : cases) {
+      const size_t first = probe.ids.size();
+      const int ok0 = probe.ok;
+      fpMetricsReset();
+      for (int i = 0; i < 10; ++i) {
+        const int user = i * 3;
+        const int finger = c.finger < 0 ? user : c.finger + i;
+        const uint64_t t0 = VirtualClock::nowUs();
+        emu.scheduleFinger(t0 + 250000, finger, c.quality, c.posture);
+        emu.scheduleFinger(t0 + 2250000, -1);
+        probe.t0 = t0;
+        requestScan(15000);
+        const size_t before = probe.ids.size();
+        spinUntil(20000, [&] { autoMode.tick(); relay.loop(); worker.pump(); return probe.ids.size() > before; });
+        spinUntil(20000, [&] {
+          autoMode.tick(); relay.loop(); worker.pump();
+          return autoMode.currentState() == AutoState::WAIT_FINGER && VirtualClock::nowUs() > t0 + 2250000;
+        });
+      }
+      const int ok = probe.ok - ok0;
+      int reasons[(int)PolicyReason::COUNT] = {};
+      for (size_t k = first; k < probe.reasons.size(); ++k) ++reasons[(int)probe.reasons[k]];
+      printf("  %-26s aceptados=%2d/10 %s  accept=%d confirmed=%d low_score=%d no_agreement=%d  job p50=%.0f ms\n",
+             c.name, ok, c.genuine ? (ok == 10 ? "      " : "(FRR) ") : (ok ? "(FAR) " : "      "),
+             reasons[(int)PolicyReason::Accept], reasons[(int)PolicyReason::Confirmed],
+             reasons[(int)PolicyReason::LowScore], reasons[(int)PolicyReason::NoAgreement],
+             fpMetricsQuantileUs(MetricStage::Job, 0.5f) / 1000.0);
+    }
+  }
+  char buf[512];
+  policy.statsJson(buf, sizeof(buf));
+  printf("%s\n", buf);
+  printf("1:N completo p50=%.1f ms (una búsqueda en la base de %u slots)\n",
+         fpMetricsQuantileUs(MetricStage::Search, 0.5f) / 1000.0, fp.chip().capacity);
+}
+
+// ---------------------------------------------------------------------------
+// Free-run: fila de personas sin requestScan. Cada una levanta el dedo 300 ms
+// después de ver el resultado y la siguiente lo apoya 500 ms más tarde; el
+// sensor se re-arma al levantar, mientras el resultado anterior sigue en
+// pantalla.
+void benchFreeRun(int people, int touchPin) {
+  printf("\n== AutoMode free-run: %d personas en fila (%s) ==\n", people,
+         touchPin >= 0 ? "línea touch + ISR" : "polling GenImg");
+  R305Emulator emu(57600);
+  enrollUsers(emu, 30);
+  FingerSerial.attach(&emu);
+  if (touchPin >= 0)
+    hostBindPin((uint8_t)touchPin, [&emu] { return emu.fingerPresentAt(VirtualClock::nowUs()) ? HIGH : LOW; });
+  Wire.begin(21, 22);
+  Wire.setClock(400000);
+  Adafruit_SH1106G oled(128, 64, &Wire, -1);
+  DisplayModel display(oled, 2);
+  FingerprintModel fp(FingerSerial, 25, 26, touchPin);
+  NamesModel names;
+  SensorWorker worker;
+  SearchEngine search(fp);
+  SlotMap slots(fp);
+  AutoMode autoMode(display, fp, names, worker, search, slots);
+  DoorRelay relay(-1, true);
+  DeliveryProbe probe;
+  probe.relay = &relay;
+  display.begin(0x3C);
+  names.begin();
+  fp.begin(57600);
+  { Preferences p; p.begin("slots", false); p.clear(); p.end(); }
+  { Preferences p; p.begin("auto", false); p.clear(); p.end(); }
+  slots.begin();
+  worker.begin(false, 4, fp.uartLock());
+  autoMode.onResult(&probeResult, &probe);
+  autoMode.begin();
+  autoMode.setFreeRun(true, false);
+  fpMetricsReset();
+  emu.resetStats();
+
+  Series fingerToResult;
+  uint64_t onAt = VirtualClock::nowUs() + 250000;
+  emu.scheduleFinger(onAt, 0, 100, 0);
+  probe.t0 = onAt;
+  size_t seen = 0;
+  int next = 1;
+  const uint64_t runStart = onAt;
+  spinUntil(people * 5000, [&] {
+    autoMode.tick();
+    worker.pump();
+    if (probe.ids.size() > seen) {
+      seen = probe.ids.size();
+      fingerToResult.add((VirtualClock::nowUs() - onAt) / 1000.0);
+      const uint64_t now = VirtualClock::nowUs();
+      emu.scheduleFinger(now + 300000, -1);
+      if (next < people) {
+        onAt = now + 800000;
+        probe.t0 = onAt;
+        emu.scheduleFinger(onAt, next % 30, 100, (uint8_t)(next % SLOTS_PER_USER));
+        ++next;
+      }
+    }
+    return (int)seen == people;
+  });
+  const double totalMin = msSince(runStart) / 60000.0;
+  printf("personas=%zu ok=%d  dedo->resultado ms p50=%.1f p99=%.1f  GenImg/persona=%.1f\n", seen, probe.ok,
+         fingerToResult.pct(0.5), fingerToResult.pct(0.99), seen ? (double)emu.commands(0x01) / seen : 0.0);
+  printf("throughput medido=%.1f personas/min  fp_people_per_minute{freerun}=%.1f\n", seen / totalMin,
+         fpMetricsPeoplePerMin(MetricMode::FreeRun));
+
+  // volver a interactivo: entre scans, sin dedo apoyado
+  autoMode.setFreeRun(false, false);
+  spinUntil(3000, [&] { autoMode.tick(); worker.pump(); return false; });
+  printf("vuelta a interactivo: estado=%d sin peticiones=%s\n", (int)autoMode.currentState(),
+         activeRequestId() ? "NO" : "sí");
+  if (touchPin >= 0) hostBindPin((uint8_t)touchPin, nullptr);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool verbose = false;
+  for (int i = 1; i < argc; ++i) if (!strcmp(argv[i], "-v")) verbose = true;
+  Serial.setQuiet(!verbose);
+
+  benchAutoDetect();
+  benchLink();
+  benchCapture();
+  benchMatchSequence();
+  benchVerify();
+  benchZones();
+  benchSlots();
+  benchTemplates();
+  benchUartInterlock();
+  benchRender();
+  benchNames();
+  benchEventBus();
+  benchJournal();
+  benchAutoModePipeline(30, -1);
+  benchAutoModePipeline(30, 27);
+  benchScanQueue();
+  benchWebApiJobs();
+  benchCaptureRetry();
+  benchMatchPolicy();
+  benchFreeRun(30, -1);
+  benchFreeRun(30, 27);
+  return 0;
+}
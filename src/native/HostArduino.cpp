@@ -0,0 +1,359 @@
+// Implementación de los shims de Arduino para el entorno `native`.
+#include <Arduino.h>
+#include <HardwareSerial.h>
+#include <Wire.h>
+#include <Adafruit_SH110X.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <nvs.h>
+#include <esp_partition.h>
+#include <map>
+#include "R305Emulator.h"
+
+HostSerial Serial;
+TwoWire    Wire(0);
+HostWiFi   WiFi;
+
+// ======================= GPIO =======================
+namespace {
+  constexpr uint8_t PINS = 64;
+  uint8_t s_pinLevel[PINS] = {0};
+  std::function<int()> s_pinSource[PINS];
+  struct Isr { void (*fn)(void*) = nullptr; void* arg = nullptr; int mode = 0; };
+  Isr s_isr[PINS];
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin >= PINS || s_pinSource[pin]) return;
+  if (mode == INPUT_PULLUP)   s_pinLevel[pin] = HIGH;
+  if (mode == INPUT_PULLDOWN) s_pinLevel[pin] = LOW;
+}
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin < PINS && !s_pinSource[pin]) s_pinLevel[pin] = val ? HIGH : LOW;
+}
+int digitalRead(uint8_t pin) {
+  if (pin >= PINS) return LOW;
+  return s_pinSource[pin] ? s_pinSource[pin]() : s_pinLevel[pin];
+}
+
+void attachInterruptArg(uint8_t pin, void (*isr)(void*), void* arg, int mode) {
+  if (pin >= PINS) return;
+  s_isr[pin] = Isr{isr, arg, mode};
+  s_pinLevel[pin] = (uint8_t)digitalRead(pin);
+}
+void detachInterrupt(uint8_t pin) {
+  if (pin < PINS) s_isr[pin] = Isr{};
+}
+
+void hostBindPin(uint8_t pin, std::function<int()> level) {
+  if (pin >= PINS) return;
+  s_pinSource[pin] = std::move(level);
+  if (s_pinSource[pin]) s_pinLevel[pin] = (uint8_t)s_pinSource[pin]();
+}
+
+void hostServiceGpio() {
+  for (uint8_t pin = 0; pin < PINS; ++pin) {
+    if (!s_pinSource[pin]) continue;
+    const uint8_t prev = s_pinLevel[pin];
+    const uint8_t now  = s_pinSource[pin]() ? HIGH : LOW;
+    s_pinLevel[pin] = now;
+    const Isr& isr = s_isr[pin];
+    if (!isr.fn || prev == now) continue;
+    const bool rising = now == HIGH;
+    if (isr.mode == CHANGE || (isr.mode == RISING && rising) || (isr.mode == FALLING && !rising))
+      isr.fn(isr.arg);
+  }
+}
+
+// ======================= UART =======================
+void HardwareSerial::begin(unsigned long baud, uint32_t, int8_t, int8_t, bool, unsigned long, uint8_t) {
+  updateBaudRate(baud);
+}
+void HardwareSerial::updateBaudRate(unsigned long baud) {
+  baud_ = (uint32_t)baud;
+  if (emu_) emu_->hostSetBaud(baud_);
+}
+void HardwareSerial::end() { baud_ = 0; if (emu_) emu_->hostSetBaud(0); }
+int HardwareSerial::available() { return emu_ ? emu_->hostAvailable() : 0; }
+int HardwareSerial::read()      { return emu_ ? emu_->hostRead() : -1; }
+int HardwareSerial::peek()      { return emu_ ? emu_->hostPeek() : -1; }
+void HardwareSerial::flush() {}
+size_t HardwareSerial::write(uint8_t c) {
+  if (!emu_) return 0;
+  emu_->hostWrite(c);
+  return 1;
+}
+
+// ======================= I2C =======================
+uint8_t TwoWire::endTransmission(bool) {
+  // start + dirección + datos (+ACK por byte) + stop ≈ 9 bits por byte + 2 bits
+  const uint64_t bits = (uint64_t)(pending_ + 1) * 9u + 2u;
+  VirtualClock::advanceUs((bits * 1000000ULL + clock_ - 1) / clock_);
+  bytes_ += pending_ + 1;
+  ++transactions_;
+  pending_ = 0;
+  return 0;
+}
+
+// ======================= SH1106 =======================
+Adafruit_SH1106G::Adafruit_SH1106G(uint16_t w, uint16_t h, TwoWire* twi, int16_t, uint32_t, uint32_t)
+: _wire(twi), _w((int16_t)w), _h((int16_t)h), _buf(new uint8_t[(size_t)w * ((h + 7) / 8)]()) {}
+
+Adafruit_SH1106G::~Adafruit_SH1106G() { delete[] _buf; }
+
+bool Adafruit_SH1106G::begin(uint8_t addr, bool) {
+  _addr = addr;
+  clearDisplay();
+  return true;
+}
+
+void Adafruit_SH1106G::clearDisplay() {
+  memset(_buf, 0, (size_t)_w * ((_h + 7) / 8));
+}
+
+void Adafruit_SH1106G::display() {
+  // como Adafruit_SH110X::display(): por página, comando + datos en trozos de 31
+  const int pages = (_h + 7) / 8;
+  for (int p = 0; p < pages; ++p) {
+    _wire->beginTransmission(_addr);
+    const uint8_t cmd[] = {0x00, (uint8_t)(0xB0 + p), 0x10, 0x02};
+    _wire->write(cmd, sizeof(cmd));
+    _wire->endTransmission();
+    int remaining = _w;
+    const uint8_t* ptr = _buf + p * _w;
+    while (remaining > 0) {
+      const int n = std::min(remaining, 31);
+      _wire->beginTransmission(_addr);
+      _wire->write((uint8_t)0x40);
+      _wire->write(ptr, (size_t)n);
+      _wire->endTransmission();
+      ptr += n; remaining -= n;
+    }
+  }
+}
+
+void Adafruit_SH1106G::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  if (x < 0 || y < 0 || x >= _w || y >= _h) return;
+  uint8_t& b = _buf[x + (y / 8) * _w];
+  const uint8_t m = (uint8_t)(1u << (y & 7));
+  switch (color) {
+    case SH110X_WHITE:   b |= m;  break;
+    case SH110X_BLACK:   b &= (uint8_t)~m; break;
+    case SH110X_INVERSE: b ^= m;  break;
+  }
+}
+
+bool Adafruit_SH1106G::getPixel(int16_t x, int16_t y) const {
+  if (x < 0 || y < 0 || x >= _w || y >= _h) return false;
+  return (_buf[x + (y / 8) * _w] >> (y & 7)) & 1;
+}
+
+void Adafruit_SH1106G::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  for (int16_t j = y; j < y + h; ++j)
+    for (int16_t i = x; i < x + w; ++i) drawPixel(i, j, color);
+}
+
+void Adafruit_SH1106G::drawBitmap(int16_t x, int16_t y, const uint8_t* bmp, int16_t w, int16_t h, uint16_t color) {
+  const int16_t bw = (int16_t)((w + 7) / 8);
+  for (int16_t j = 0; j < h; ++j)
+    for (int16_t i = 0; i < w; ++i)
+      if (pgm_read_byte(bmp + j * bw + i / 8) & (0x80 >> (i & 7))) drawPixel(x + i, y + j, color);
+}
+
+void Adafruit_SH1106G::drawBitmap(int16_t x, int16_t y, const uint8_t* bmp, int16_t w, int16_t h,
+                                  uint16_t color, uint16_t bg) {
+  const int16_t bw = (int16_t)((w + 7) / 8);
+  for (int16_t j = 0; j < h; ++j)
+    for (int16_t i = 0; i < w; ++i)
+      drawPixel(x + i, y + j, (pgm_read_byte(bmp + j * bw + i / 8) & (0x80 >> (i & 7))) ? color : bg);
+}
+
+void Adafruit_SH1106G::drawXBitmap(int16_t x, int16_t y, const uint8_t* bmp, int16_t w, int16_t h, uint16_t color) {
+  const int16_t bw = (int16_t)((w + 7) / 8);
+  for (int16_t j = 0; j < h; ++j)
+    for (int16_t i = 0; i < w; ++i)
+      if (pgm_read_byte(bmp + j * bw + i / 8) & (1 << (i & 7))) drawPixel(x + i, y + j, color);
+}
+
+// Sin fuente real: cada carácter pinta un patrón 5x7 derivado de su código,
+// suficiente para que el texto ensucie los mismos bytes que en el equipo.
+void Adafruit_SH1106G::drawGlyph(int16_t x, int16_t y, uint8_t c) {
+  for (int8_t i = 0; i < 6; ++i) {
+    const uint8_t col = (i == 5) ? 0 : (uint8_t)((c * 37u + i * 11u) & 0x7F);
+    for (int8_t j = 0; j < 8; ++j) {
+      const uint16_t color = (col >> j) & 1 ? _tc : _tbg;
+      if (color == _tc || _tbg != _tc) fillRect(x + i * _ts, y + j * _ts, _ts, _ts, color);
+    }
+  }
+}
+
+size_t Adafruit_SH1106G::write(uint8_t c) {
+  if (c == '\n') { _cx = 0; _cy += 8 * _ts; return 1; }
+  if (c == '\r') return 1;
+  if (_wrap && _cx + 6 * _ts > _w) { _cx = 0; _cy += 8 * _ts; }
+  drawGlyph(_cx, _cy, c);
+  _cx += 6 * _ts;
+  return 1;
+}
+
+// ======================= Preferences =======================
+namespace {
+  using NvsNamespace = std::map<std::string, std::vector<uint8_t>>;
+  std::map<std::string, NvsNamespace> s_nvs;
+  uint32_t s_nvsWrites = 0;
+}
+
+bool Preferences::begin(const char* name, bool readOnly, const char*) {
+  _ns = &s_nvs[name ? name : ""];
+  _ro = readOnly;
+  return true;
+}
+
+bool Preferences::clear() {
+  if (!_ns || _ro) return false;
+  _ns->clear();
+  return true;
+}
+
+bool Preferences::remove(const char* key) {
+  if (!_ns || _ro) return false;
+  ++s_nvsWrites;
+  return _ns->erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+  return _ns && _ns->count(key);
+}
+
+size_t Preferences::putString(const char* key, const String& value) {
+  return putBytes(key, value.c_str(), value.length() + 1) ? value.length() : 0;
+}
+
+String Preferences::getString(const char* key, const String& def) {
+  if (!_ns) return def;
+  auto it = _ns->find(key);
+  if (it == _ns->end() || it->second.empty()) return def;
+  return String((const char*)it->second.data());
+}
+
+size_t Preferences::getString(const char* key, char* value, size_t maxLen) {
+  if (!_ns || !maxLen) return 0;
+  auto it = _ns->find(key);
+  if (it == _ns->end() || it->second.size() > maxLen) return 0;
+  memcpy(value, it->second.data(), it->second.size());
+  return it->second.size();
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+  if (!_ns || _ro || !key) return 0;
+  auto& blob = (*_ns)[key];
+  blob.assign((const uint8_t*)value, (const uint8_t*)value + len);
+  ++s_nvsWrites;
+  return len;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+  if (!_ns) return 0;
+  auto it = _ns->find(key);
+  if (it == _ns->end() || it->second.size() > maxLen) return 0;
+  memcpy(buf, it->second.data(), it->second.size());
+  return it->second.size();
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  if (!_ns) return 0;
+  auto it = _ns->find(key);
+  return it == _ns->end() ? 0 : it->second.size();
+}
+
+// ======================= NVS (API C) =======================
+struct nvs_opaque_iterator_t {
+  std::string ns;
+  NvsNamespace::const_iterator pos, end;
+};
+
+nvs_iterator_t nvs_entry_find(const char*, const char* ns, nvs_type_t) {
+  auto n = s_nvs.find(ns ? ns : "");
+  if (n == s_nvs.end() || n->second.empty()) return nullptr;
+  return new nvs_opaque_iterator_t{n->first, n->second.begin(), n->second.end()};
+}
+
+nvs_iterator_t nvs_entry_next(nvs_iterator_t it) {
+  if (!it) return nullptr;
+  if (++it->pos == it->end) { delete it; return nullptr; }
+  return it;
+}
+
+void nvs_entry_info(nvs_iterator_t it, nvs_entry_info_t* out) {
+  memset(out, 0, sizeof(*out));
+  strncpy(out->namespace_name, it->ns.c_str(), sizeof(out->namespace_name) - 1);
+  strncpy(out->key, it->pos->first.c_str(), sizeof(out->key) - 1);
+  out->type = NVS_TYPE_STR;
+}
+
+void nvs_release_iterator(nvs_iterator_t it) { delete it; }
+
+uint32_t hostNvsWrites() { return s_nvsWrites; }
+
+// ======================= esp_partition =======================
+namespace {
+  // tiempos típicos de la flash SPI del ESP32 (W25Q32 a 40 MHz)
+  constexpr uint32_t FLASH_ERASE_US     = 45000;   // sector de 4 KB
+  constexpr uint32_t FLASH_WRITE_US     = 40;      // por página de 256 B (más bytes/6 MB/s)
+  constexpr uint32_t FLASH_READ_MB_S    = 20;
+
+  esp_partition_t      s_flashPart = {nullptr, ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS,
+                                      0x290000, 0, "spiffs", false};
+  std::vector<uint8_t> s_flash;
+  size_t               s_tearAt = SIZE_MAX;
+  HostFlashStats       s_flashStats = {};
+
+  bool flashRange(const esp_partition_t* p, size_t off, size_t n) {
+    return p == &s_flashPart && off <= s_flash.size() && n <= s_flash.size() - off;
+  }
+}
+
+void hostFlashReset(uint32_t size) {
+  s_flash.assign(size, 0xFF);
+  s_flashPart.size = size;
+  s_tearAt = SIZE_MAX;
+  s_flashStats = HostFlashStats{};
+}
+
+void hostFlashTearNextWrite(size_t keepBytes) { s_tearAt = keepBytes; }
+HostFlashStats hostFlashStats() { return s_flashStats; }
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char* label) {
+  if (s_flash.empty() || type != s_flashPart.type) return nullptr;
+  if (subtype != ESP_PARTITION_SUBTYPE_ANY && subtype != s_flashPart.subtype) return nullptr;
+  if (label && strcmp(label, s_flashPart.label)) return nullptr;
+  return &s_flashPart;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* p, size_t off, void* dst, size_t n) {
+  if (!flashRange(p, off, n)) return ESP_ERR_INVALID_SIZE;
+  memcpy(dst, &s_flash[off], n);
+  ++s_flashStats.reads;
+  VirtualClock::advanceUs(2 + n / FLASH_READ_MB_S);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* p, size_t off, const void* src, size_t n) {
+  if (!flashRange(p, off, n)) return ESP_ERR_INVALID_SIZE;
+  const size_t keep = n < s_tearAt ? n : s_tearAt;     // corte de energía: sólo una parte
+  s_tearAt = SIZE_MAX;
+  const uint8_t* b = (const uint8_t*)src;
+  for (size_t i = 0; i < keep; ++i) s_flash[off + i] &= b[i];
+  ++s_flashStats.writes;
+  VirtualClock::advanceUs(FLASH_WRITE_US * ((n + 255) / 256) + n / 6);
+  return keep == n ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* p, size_t off, size_t n) {
+  if (!flashRange(p, off, n) || off % SPI_FLASH_SEC_SIZE || n % SPI_FLASH_SEC_SIZE) return ESP_ERR_INVALID_ARG;
+  memset(&s_flash[off], 0xFF, n);
+  s_flashStats.erases += n / SPI_FLASH_SEC_SIZE;
+  VirtualClock::advanceUs((uint64_t)FLASH_ERASE_US * (n / SPI_FLASH_SEC_SIZE));
+  return ESP_OK;
+}
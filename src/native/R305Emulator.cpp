@@ -0,0 +1,435 @@
+#include "R305Emulator.h"
+#include "VirtualClock.h"
+#include <algorithm>
+
+namespace {
+  constexpr uint8_t PID_COMMAND = 0x01;
+  constexpr uint8_t PID_DATA    = 0x02;
+  constexpr uint8_t PID_ACK     = 0x07;
+  constexpr uint8_t PID_END     = 0x08;
+
+  // códigos de confirmación (mismos valores que FINGERPRINT_* de Adafruit)
+  constexpr uint8_t CC_OK            = 0x00;
+  constexpr uint8_t CC_PACKET        = 0x01;
+  constexpr uint8_t CC_NOFINGER      = 0x02;
+  constexpr uint8_t CC_IMAGEMESS     = 0x06;
+  constexpr uint8_t CC_FEATUREFAIL   = 0x07;
+  constexpr uint8_t CC_NOMATCH       = 0x08;
+  constexpr uint8_t CC_NOTFOUND      = 0x09;
+  constexpr uint8_t CC_ENROLLMISMATCH= 0x0A;
+  constexpr uint8_t CC_BADLOCATION   = 0x0B;
+  constexpr uint8_t CC_DBREADFAIL    = 0x0C;
+  constexpr uint8_t CC_UPLOADFAIL    = 0x0D;
+  constexpr uint8_t CC_DELETEFAIL    = 0x10;
+  constexpr uint8_t CC_PASSFAIL      = 0x13;
+  constexpr uint8_t CC_INVALIDIMAGE  = 0x15;
+  constexpr uint8_t CC_INVALIDREG    = 0x1A;
+
+  // el FIFO de TX del ESP32 tiene 128 bytes: write() bloquea más allá de eso
+  constexpr uint64_t TX_FIFO_BYTES = 128;
+}
+
+R305Emulator::R305Emulator(uint32_t baud, uint16_t capacity)
+: baud_(baud), prevBaud_(baud), library_(capacity) {}
+
+void R305Emulator::powerOn() {
+  readyAtUs_ = VirtualClock::nowUs() + (uint64_t)timing_.bootMs * 1000ULL;
+  rx_.clear();
+  downBuffer_ = 0;
+}
+
+uint32_t R305Emulator::sensorBaudAt(uint64_t atUs) const {
+  return (baudSwitchAtUs_ && atUs < baudSwitchAtUs_) ? prevBaud_ : baud_;
+}
+
+bool R305Emulator::noisy(uint32_t baud) {
+  if (!linkLimit_ || baud <= linkLimit_) return false;
+  noiseState_ ^= noiseState_ << 13; noiseState_ ^= noiseState_ >> 17; noiseState_ ^= noiseState_ << 5;
+  return noiseState_ % noiseOneIn_ == 0;
+}
+
+// ======================= lado host =======================
+
+void R305Emulator::hostWrite(uint8_t b) {
+  const uint64_t now = VirtualClock::nowUs();
+  const uint64_t bt  = byteUs(hostBaud_);
+  const uint64_t start = std::max(now, lineBusyUntilUs_);
+  const uint64_t arrive = start + bt;
+  lineBusyUntilUs_ = arrive;
+  ++bytesIn_;
+
+  // write() del ESP32 bloquea cuando el FIFO de TX está lleno
+  const uint64_t fifoUs = TX_FIFO_BYTES * bt;
+  if (lineBusyUntilUs_ > now + fifoUs) VirtualClock::advanceUs(lineBusyUntilUs_ - now - fifoUs);
+
+  if (hostBaud_ == 0 || hostBaud_ != sensorBaudAt(arrive) || arrive < readyAtUs_ || noisy(hostBaud_)) {
+    // baud distinto o sensor arrancando: el byte llega como basura
+    ++garbled_;
+    rx_.clear();
+    return;
+  }
+  onSensorByte(b, arrive);
+}
+
+int R305Emulator::hostAvailable() {
+  const uint64_t now = VirtualClock::nowUs();
+  int n = 0;
+  for (const auto& o : out_) { if (o.atUs > now) break; ++n; }
+  return n;
+}
+
+int R305Emulator::hostRead() {
+  if (out_.empty() || out_.front().atUs > VirtualClock::nowUs()) return -1;
+  uint8_t b = out_.front().b;
+  out_.pop_front();
+  return b;
+}
+
+int R305Emulator::hostPeek() {
+  if (out_.empty() || out_.front().atUs > VirtualClock::nowUs()) return -1;
+  return out_.front().b;
+}
+
+void R305Emulator::resetStats() {
+  opCount_.fill(0);
+  totalCommands_ = 0;
+  bytesIn_ = bytesOut_ = 0;
+  garbled_ = badPackets_ = 0;
+}
+
+// ======================= base / guion =======================
+
+bool R305Emulator::storeTemplate(uint16_t slot, uint16_t fingerId, uint8_t posture) {
+  if (slot >= library_.size()) return false;
+  library_[slot] = Features{true, (int32_t)fingerId, 100, posture};
+  return true;
+}
+
+void R305Emulator::clearLibrary() {
+  for (auto& t : library_) t = Features{};
+  lookalikes_.clear();
+}
+
+void R305Emulator::addLookalike(int32_t fingerId, uint16_t page, uint16_t score) {
+  lookalikes_.push_back(Lookalike{fingerId, page, score});
+}
+
+uint16_t R305Emulator::templateCount() const {
+  uint16_t n = 0;
+  for (const auto& t : library_) if (t.valid) ++n;
+  return n;
+}
+
+void R305Emulator::placeFinger(uint16_t fingerId, uint8_t quality, uint8_t posture) {
+  scheduleFinger(VirtualClock::nowUs(), fingerId, quality, posture);
+}
+
+void R305Emulator::liftFinger() {
+  scheduleFinger(VirtualClock::nowUs(), -1);
+}
+
+void R305Emulator::scheduleFinger(uint64_t atUs, int32_t fingerId, uint8_t quality, uint8_t posture) {
+  FingerEvent ev{atUs, fingerId, quality, posture};
+  auto it = std::upper_bound(script_.begin(), script_.end(), atUs,
+                             [](uint64_t t, const FingerEvent& e) { return t < e.atUs; });
+  script_.insert(it, ev);
+}
+
+const R305Emulator::FingerEvent* R305Emulator::fingerAt(uint64_t atUs) const {
+  auto it = std::upper_bound(script_.begin(), script_.end(), atUs,
+                             [](uint64_t t, const FingerEvent& e) { return t < e.atUs; });
+  if (it == script_.begin()) return nullptr;
+  --it;
+  return (it->fingerId >= 0) ? &*it : nullptr;
+}
+
+bool R305Emulator::fingerPresentAt(uint64_t atUs) const {
+  return fingerAt(atUs) != nullptr;
+}
+
+// ======================= plantillas =======================
+
+void R305Emulator::encodeTemplate(const Features& f, uint8_t* out) const {
+  out[0] = 0x03; out[1] = 0x01;                       // cabecera de char file
+  out[2] = (uint8_t)((f.fingerId >> 8) & 0xFF);
+  out[3] = (uint8_t)(f.fingerId & 0xFF);
+  out[4] = f.quality;
+  out[5] = f.posture;
+  uint32_t x = (uint32_t)f.fingerId * 8u + f.posture + 1u;
+  for (uint16_t i = 6; i < TEMPLATE_BYTES; ++i) {
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    out[i] = (uint8_t)x;
+  }
+}
+
+R305Emulator::Features R305Emulator::decodeTemplate(const uint8_t* in) const {
+  Features f;
+  if (in[0] != 0x03 || in[1] != 0x01) return f;
+  f.valid    = true;
+  f.fingerId = (int32_t)((in[2] << 8) | in[3]);
+  f.quality  = in[4];
+  f.posture  = in[5];
+  return f;
+}
+
+uint16_t R305Emulator::scoreFor(const Features& probe, const Features& tpl, uint16_t page) const {
+  if (!probe.valid || !tpl.valid) return 0;
+  if (probe.fingerId != tpl.fingerId) {
+    for (const Lookalike& l : lookalikes_)
+      if (l.fingerId == probe.fingerId && l.page == page) return l.score;
+    return 0;
+  }
+  uint16_t s = (uint16_t)(probe.quality * 2);
+  if (probe.posture == tpl.posture) s += 60;
+  s += (uint16_t)((page * 37u) % 25u);
+  return s;
+}
+
+// ======================= protocolo =======================
+
+void R305Emulator::onSensorByte(uint8_t b, uint64_t atUs) {
+  rx_.push_back(b);
+  if (rx_.size() == 1 && rx_[0] != 0xEF) { rx_.clear(); return; }
+  if (rx_.size() == 2 && rx_[1] != 0x01) {
+    rx_.clear();
+    if (b == 0xEF) rx_.push_back(b);
+    return;
+  }
+  if (rx_.size() < 9) return;
+
+  const uint16_t len = (uint16_t)((rx_[7] << 8) | rx_[8]);
+  if (len < 2) { rx_.clear(); ++badPackets_; return; }
+  if (rx_.size() < 9u + len) return;
+
+  uint16_t sum = (uint16_t)(rx_[6] + rx_[7] + rx_[8]);
+  for (size_t i = 9; i < 9u + len - 2; ++i) sum += rx_[i];
+  const uint16_t chk = (uint16_t)((rx_[9 + len - 2] << 8) | rx_[9 + len - 1]);
+  const uint8_t pid = rx_[6];
+  std::vector<uint8_t> payload(rx_.begin() + 9, rx_.begin() + 9 + len - 2);
+  rx_.clear();
+
+  if (sum != chk) {
+    ++badPackets_;
+    if (pid == PID_COMMAND) replyCode(std::max(atUs, sensorBusyUntilUs_) + timing_.cmdUs, CC_PACKET);
+    return;
+  }
+  onPacket(pid, payload, atUs);
+}
+
+void R305Emulator::onPacket(uint8_t pid, const std::vector<uint8_t>& payload, uint64_t atUs) {
+  if (pid == PID_COMMAND) {
+    if (payload.empty()) { ++badPackets_; return; }
+    runCommand(payload, atUs);
+    return;
+  }
+  if ((pid == PID_DATA || pid == PID_END) && downBuffer_) {
+    downData_.insert(downData_.end(), payload.begin(), payload.end());
+    if (pid == PID_END) {
+      Features f;
+      if (downData_.size() >= TEMPLATE_BYTES) f = decodeTemplate(downData_.data());
+      *charBuffer(downBuffer_) = f;
+      downBuffer_ = 0;
+      downData_.clear();
+    }
+  }
+}
+
+uint64_t R305Emulator::queuePacket(uint64_t atUs, uint8_t pid, const uint8_t* data, size_t len) {
+  std::vector<uint8_t> pkt;
+  pkt.reserve(len + 11);
+  const uint16_t plen = (uint16_t)(len + 2);
+  pkt.insert(pkt.end(), {0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, pid,
+                         (uint8_t)(plen >> 8), (uint8_t)(plen & 0xFF)});
+  uint16_t sum = (uint16_t)(pid + (plen >> 8) + (plen & 0xFF));
+  for (size_t i = 0; i < len; ++i) { pkt.push_back(data[i]); sum += data[i]; }
+  pkt.push_back((uint8_t)(sum >> 8));
+  pkt.push_back((uint8_t)(sum & 0xFF));
+
+  const uint32_t baud = sensorBaudAt(atUs);
+  const uint64_t bt = byteUs(baud);
+  uint64_t t = std::max(atUs, txBusyUntilUs_);
+  for (uint8_t b : pkt) {
+    t += bt;
+    out_.push_back(OutByte{(uint8_t)(noisy(baud) ? b ^ 0x10 : b), t});
+  }
+  bytesOut_ += pkt.size();
+  txBusyUntilUs_ = t;
+  return t;
+}
+
+void R305Emulator::reply(uint64_t readyAtUs, const std::vector<uint8_t>& payload, uint8_t pid) {
+  sensorBusyUntilUs_ = std::max(sensorBusyUntilUs_, readyAtUs);
+  queuePacket(readyAtUs, pid, payload.data(), payload.size());
+}
+
+void R305Emulator::runCommand(const std::vector<uint8_t>& p, uint64_t atUs) {
+  const uint8_t op = p[0];
+  ++opCount_[op];
+  ++totalCommands_;
+  const uint64_t start = std::max(atUs, sensorBusyUntilUs_);
+  const uint16_t cap = capacity();
+  auto arg = [&](size_t i) -> uint8_t { return i < p.size() ? p[i] : 0; };
+
+  switch (op) {
+    case 0x01: {  // GenImg
+      const FingerEvent* f = fingerAt(start);
+      if (f) {
+        image_ = Features{true, f->fingerId, f->quality, f->posture};
+        replyCode(start + timing_.imageUs, CC_OK);
+      } else {
+        replyCode(start + timing_.noFingerUs, CC_NOFINGER);
+      }
+      return;
+    }
+    case 0x02: {  // Img2Tz
+      const uint64_t done = start + timing_.img2TzUs;
+      if (!image_.valid)          { replyCode(done, CC_INVALIDIMAGE); return; }
+      if (image_.quality < 30)    { replyCode(done, CC_IMAGEMESS);    return; }
+      if (image_.quality < 50)    { replyCode(done, CC_FEATUREFAIL);  return; }
+      *charBuffer(arg(1)) = image_;
+      replyCode(done, CC_OK);
+      return;
+    }
+    case 0x03: {  // Match
+      const uint16_t s = scoreFor(char1_, char2_, 0);
+      const uint8_t cc = s ? CC_OK : CC_NOMATCH;
+      reply(start + timing_.matchUs, {cc, (uint8_t)(s >> 8), (uint8_t)(s & 0xFF)});
+      return;
+    }
+    case 0x04:    // Search
+    case 0x1B: {  // HiSpeedSearch
+      const Features& probe = *charBuffer(arg(1));
+      const uint16_t first = (uint16_t)((arg(2) << 8) | arg(3));
+      const uint16_t count = (uint16_t)((arg(4) << 8) | arg(5));
+      const uint32_t end = std::min<uint32_t>((uint32_t)first + count, cap);
+      const uint32_t perTpl = (op == 0x1B) ? timing_.searchPerTplUs / 2 : timing_.searchPerTplUs;
+      uint32_t scanned = 0;
+      for (uint32_t page = first; page < end; ++page) {
+        ++scanned;
+        const uint16_t s = scoreFor(probe, library_[page], (uint16_t)page);
+        if (s) {
+          reply(start + timing_.searchBaseUs + (uint64_t)perTpl * scanned,
+                {CC_OK, (uint8_t)(page >> 8), (uint8_t)(page & 0xFF), (uint8_t)(s >> 8), (uint8_t)(s & 0xFF)});
+          return;
+        }
+      }
+      reply(start + timing_.searchBaseUs + (uint64_t)perTpl * scanned, {CC_NOTFOUND, 0, 0, 0, 0});
+      return;
+    }
+    case 0x05: {  // RegModel
+      const uint64_t done = start + timing_.regModelUs;
+      if (!char1_.valid || !char2_.valid || char1_.fingerId != char2_.fingerId) {
+        replyCode(done, CC_ENROLLMISMATCH);
+        return;
+      }
+      char1_.quality = std::max(char1_.quality, char2_.quality);
+      char2_ = char1_;
+      replyCode(done, CC_OK);
+      return;
+    }
+    case 0x06: {  // Store
+      const uint16_t page = (uint16_t)((arg(2) << 8) | arg(3));
+      const uint64_t done = start + timing_.storeUs;
+      const Features& f = *charBuffer(arg(1));
+      if (page >= cap) { replyCode(done, CC_BADLOCATION); return; }
+      if (!f.valid)    { replyCode(done, CC_PACKET);      return; }
+      library_[page] = f;
+      replyCode(done, CC_OK);
+      return;
+    }
+    case 0x07: {  // LoadChar
+      const uint16_t page = (uint16_t)((arg(2) << 8) | arg(3));
+      const uint64_t done = start + timing_.loadUs;
+      if (page >= cap || !library_[page].valid) { replyCode(done, CC_DBREADFAIL); return; }
+      *charBuffer(arg(1)) = library_[page];
+      replyCode(done, CC_OK);
+      return;
+    }
+    case 0x08: {  // UpChar
+      const Features& f = *charBuffer(arg(1));
+      const uint64_t done = start + timing_.charXferUs;
+      if (!f.valid) { replyCode(done, CC_UPLOADFAIL); return; }
+      replyCode(done, CC_OK);
+      uint8_t data[TEMPLATE_BYTES];
+      encodeTemplate(f, data);
+      const uint16_t chunk = packetBytes();
+      for (uint16_t off = 0; off < TEMPLATE_BYTES; off += chunk) {
+        const uint16_t n = (uint16_t)std::min<uint32_t>(chunk, TEMPLATE_BYTES - off);
+        const uint8_t pid = (off + n >= TEMPLATE_BYTES) ? PID_END : PID_DATA;
+        queuePacket(txBusyUntilUs_, pid, data + off, n);
+      }
+      sensorBusyUntilUs_ = txBusyUntilUs_;
+      return;
+    }
+    case 0x09: {  // DownChar
+      downBuffer_ = (arg(1) == 2) ? 2 : 1;
+      downData_.clear();
+      replyCode(start + timing_.charXferUs, CC_OK);
+      return;
+    }
+    case 0x0C: {  // DeletChar
+      const uint16_t page  = (uint16_t)((arg(1) << 8) | arg(2));
+      const uint16_t count = (uint16_t)((arg(3) << 8) | arg(4));
+      const uint64_t done = start + timing_.deleteUs;
+      if ((uint32_t)page + count > cap || count == 0) { replyCode(done, CC_DELETEFAIL); return; }
+      for (uint32_t i = page; i < (uint32_t)page + count; ++i) library_[i] = Features{};
+      replyCode(done, CC_OK);
+      return;
+    }
+    case 0x0D:    // Empty
+      clearLibrary();
+      replyCode(start + timing_.emptyUs, CC_OK);
+      return;
+    case 0x0E: {  // SetSysPara
+      const uint8_t reg = arg(1), val = arg(2);
+      const uint64_t done = start + timing_.flashParaUs;
+      if (reg == 4 && val >= 1 && val <= 12) {
+        sensorBusyUntilUs_ = std::max(sensorBusyUntilUs_, done);
+        const uint8_t ok = CC_OK;
+        const uint64_t sentAt = queuePacket(done, PID_ACK, &ok, 1);
+        prevBaud_ = sensorBaudAt(sentAt);
+        baud_ = 9600u * val;
+        baudSwitchAtUs_ = sentAt;
+        return;
+      }
+      if (reg == 5 && val >= 1 && val <= 5) { security_ = val; replyCode(done, CC_OK); return; }
+      if (reg == 6 && val <= maxPacketCode_) { packetCode_ = val; replyCode(done, CC_OK); return; }
+      replyCode(done, CC_INVALIDREG);
+      return;
+    }
+    case 0x0F: {  // ReadSysPara
+      const uint16_t baudN = (uint16_t)(sensorBaudAt(start) / 9600u);
+      reply(start + timing_.cmdUs, {CC_OK,
+            0x00, 0x00,                               // status register
+            0x00, 0x09,                               // system identifier
+            (uint8_t)(cap >> 8), (uint8_t)(cap & 0xFF),
+            0x00, security_,
+            0xFF, 0xFF, 0xFF, 0xFF,                   // device address
+            0x00, packetCode_,
+            (uint8_t)(baudN >> 8), (uint8_t)(baudN & 0xFF)});
+      return;
+    }
+    case 0x13: {  // VfyPwd
+      const uint32_t pwd = ((uint32_t)arg(1) << 24) | ((uint32_t)arg(2) << 16) | ((uint32_t)arg(3) << 8) | arg(4);
+      replyCode(start + timing_.cmdUs, pwd == password_ ? CC_OK : CC_PASSFAIL);
+      return;
+    }
+    case 0x1D: {  // TemplateNum
+      const uint16_t n = templateCount();
+      reply(start + timing_.cmdUs, {CC_OK, (uint8_t)(n >> 8), (uint8_t)(n & 0xFF)});
+      return;
+    }
+    case 0x1F: {  // ReadIndexTable
+      std::vector<uint8_t> r(33, 0);
+      r[0] = CC_OK;
+      const uint32_t base = (uint32_t)arg(1) * 256u;
+      for (uint32_t i = 0; i < 256 && base + i < cap; ++i)
+        if (library_[base + i].valid) r[1 + i / 8] |= (uint8_t)(1u << (i % 8));
+      reply(start + timing_.cmdUs, r);
+      return;
+    }
+    default:
+      replyCode(start + timing_.cmdUs, CC_PACKET);
+      return;
+  }
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <vector>
+#include <array>
+
+// Emulador del protocolo R305 a nivel de byte para el entorno `native`.
+//
+// - Los bytes viajan con el tiempo de línea del baud (10 bits por byte, 8N1).
+//   Si el host habla a otro baud que el sensor, el sensor descarta lo recibido
+//   y el host termina en timeout, igual que con el hardware real.
+// - Los comandos tardan lo que indique R305Timing antes de responder.
+// - La presencia del dedo sigue un guion temporal (scheduleFinger) y la base de
+//   plantillas se arma con storeTemplate(); cada plantilla recuerda qué dedo
+//   ("fingerId") y qué posición se enroló, así Search/Match responden como el
+//   sensor (página + confidence).
+struct R305Timing {
+  uint32_t bootMs         = 200;     // arranque: antes de esto ignora comandos
+  uint32_t imageUs        = 110000;  // GenImg con dedo
+  uint32_t noFingerUs     = 40000;   // GenImg sin dedo
+  uint32_t img2TzUs       = 280000;  // extracción de características
+  uint32_t searchBaseUs   = 12000;   // Search/HiSpeedSearch: costo fijo
+  uint32_t searchPerTplUs = 300;     //   + costo por página recorrida
+  uint32_t matchUs        = 60000;   // Match 1:1 entre CharBuffer1/2
+  uint32_t regModelUs     = 70000;
+  uint32_t storeUs        = 35000;
+  uint32_t loadUs         = 25000;
+  uint32_t deleteUs       = 25000;
+  uint32_t emptyUs        = 150000;
+  uint32_t cmdUs          = 2000;    // comandos triviales (VfyPwd, ReadSysPara...)
+  uint32_t flashParaUs    = 30000;   // SetSysPara (escribe flash del sensor)
+  uint32_t charXferUs     = 5000;    // preparar UpChar/DownChar
+};
+
+class R305Emulator {
+public:
+  static constexpr uint16_t TEMPLATE_BYTES = 512;
+
+  explicit R305Emulator(uint32_t baud = 57600, uint16_t capacity = 1000);
+
+  // ----- lado host (lo usa el HardwareSerial del shim)
+  void hostSetBaud(uint32_t baud) { hostBaud_ = baud; }
+  void hostWrite(uint8_t b);
+  int  hostAvailable();
+  int  hostRead();
+  int  hostPeek();
+
+  // ----- configuración del sensor
+  R305Timing& timing() { return timing_; }
+  void     powerOn();                      // arranca el conteo de bootMs desde "ahora"
+  void     setBaud(uint32_t baud) { baud_ = baud; prevBaud_ = baud; baudSwitchAtUs_ = 0; }
+  uint32_t baud() const { return baud_; }
+  void     setPacketSizeCode(uint8_t code) { packetCode_ = code & 0x03; }
+  // Clon que rechaza (INVALIDREG) tamaños de paquete por encima de `code`
+  void     setMaxPacketCode(uint8_t code) { maxPacketCode_ = code & 0x03; }
+  // Cable largo / clon lento: por encima de `baud` se corrompe ~1 byte de cada
+  // `oneIn` en cada sentido (pseudoaleatorio, determinista). 0 = enlace limpio.
+  void     setLinkLimit(uint32_t baud, uint32_t oneIn = 100) { linkLimit_ = baud; noiseOneIn_ = oneIn; }
+  uint16_t packetBytes() const { return (uint16_t)(32u << packetCode_); }
+  void     setPassword(uint32_t pwd) { password_ = pwd; }
+  uint16_t capacity() const { return (uint16_t)library_.size(); }
+
+  // ----- base de plantillas
+  bool     storeTemplate(uint16_t slot, uint16_t fingerId, uint8_t posture = 0);
+  void     clearLibrary();
+  uint16_t templateCount() const;
+  // Falso positivo: un dedo `fingerId` que no es el enrolado en `page` igual
+  // coincide con esa página (sólo con ella) con `score`. Se borran con clearLibrary().
+  void     addLookalike(int32_t fingerId, uint16_t page, uint16_t score);
+
+  // ----- guion del dedo. fingerId < 0 = dedo levantado.
+  void placeFinger(uint16_t fingerId, uint8_t quality = 100, uint8_t posture = 0);
+  void liftFinger();
+  void scheduleFinger(uint64_t atUs, int32_t fingerId, uint8_t quality = 100, uint8_t posture = 0);
+  bool fingerPresentAt(uint64_t atUs) const;
+
+  // ----- estadísticas
+  uint32_t commands(uint8_t opcode) const { return opCount_[opcode]; }
+  uint32_t totalCommands() const { return totalCommands_; }
+  uint64_t bytesToSensor() const { return bytesIn_; }
+  uint64_t bytesFromSensor() const { return bytesOut_; }
+  uint32_t garbledBytes() const { return garbled_; }
+  uint32_t badPackets() const { return badPackets_; }
+  void     resetStats();
+
+private:
+  struct Features {
+    bool    valid    = false;
+    int32_t fingerId = -1;
+    uint8_t quality  = 0;
+    uint8_t posture  = 0;
+  };
+  struct FingerEvent { uint64_t atUs; int32_t fingerId; uint8_t quality; uint8_t posture; };
+  struct Lookalike { int32_t fingerId; uint16_t page; uint16_t score; };
+  struct OutByte { uint8_t b; uint64_t atUs; };
+
+  uint32_t sensorBaudAt(uint64_t atUs) const;
+  bool     noisy(uint32_t baud);
+  static uint64_t byteUs(uint32_t baud) { return baud ? (10000000ULL + baud - 1) / baud : 0; }
+
+  void onSensorByte(uint8_t b, uint64_t atUs);
+  void onPacket(uint8_t pid, const std::vector<uint8_t>& payload, uint64_t atUs);
+  void runCommand(const std::vector<uint8_t>& payload, uint64_t atUs);
+
+  void reply(uint64_t readyAtUs, const std::vector<uint8_t>& payload, uint8_t pid = 0x07);
+  void replyCode(uint64_t readyAtUs, uint8_t code) { reply(readyAtUs, std::vector<uint8_t>{code}); }
+  uint64_t queuePacket(uint64_t atUs, uint8_t pid, const uint8_t* data, size_t len);
+
+  const FingerEvent* fingerAt(uint64_t atUs) const;
+  void encodeTemplate(const Features& f, uint8_t* out) const;
+  Features decodeTemplate(const uint8_t* in) const;
+  uint16_t scoreFor(const Features& probe, const Features& tpl, uint16_t page) const;
+  Features* charBuffer(uint8_t id) { return (id == 2) ? &char2_ : &char1_; }
+
+  R305Timing timing_;
+  uint32_t baud_, prevBaud_;
+  uint64_t baudSwitchAtUs_ = 0;
+  uint32_t hostBaud_ = 0;
+  uint8_t  packetCode_ = 1;          // 0=32 1=64 2=128 3=256 bytes
+  uint8_t  maxPacketCode_ = 3;
+  uint32_t linkLimit_ = 0, noiseOneIn_ = 100;
+  uint32_t noiseState_ = 0x2545F491u;
+  uint32_t password_ = 0;
+  uint8_t  security_ = 3;
+  uint64_t readyAtUs_ = 0;
+
+  std::vector<Features> library_;
+  std::vector<Lookalike> lookalikes_;
+  std::vector<FingerEvent> script_;
+  Features image_, char1_, char2_;
+
+  // recepción
+  uint64_t lineBusyUntilUs_ = 0;     // host -> sensor
+  uint64_t sensorBusyUntilUs_ = 0;   // sensor procesando
+  uint64_t txBusyUntilUs_ = 0;       // sensor -> host
+  std::vector<uint8_t> rx_;
+  uint8_t  downBuffer_ = 0;          // != 0 mientras se reciben datos de DownChar
+  std::vector<uint8_t> downData_;
+  std::deque<OutByte> out_;
+
+  std::array<uint32_t, 256> opCount_{};
+  uint32_t totalCommands_ = 0;
+  uint64_t bytesIn_ = 0, bytesOut_ = 0;
+  uint32_t garbled_ = 0, badPackets_ = 0;
+};
@@ -0,0 +1,11 @@
+#include "VirtualClock.h"
+
+namespace {
+  uint64_t s_nowUs = 0;
+}
+
+namespace VirtualClock {
+  uint64_t nowUs()              { return s_nowUs; }
+  void     advanceUs(uint64_t us) { s_nowUs += us; }
+  void     reset()              { s_nowUs = 0; }
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <stdint.h>
+
+// Reloj virtual del entorno `native`: millis()/micros()/delay() del shim de
+// Arduino leen y avanzan este reloj, así los tiempos de UART, I2C y del sensor
+// emulado son deterministas e independientes de la velocidad del host.
+namespace VirtualClock {
+  uint64_t nowUs();
+  void     advanceUs(uint64_t us);
+  void     reset();
+}
@@ -0,0 +1,58 @@
+#pragma once
+// Shim del driver SH1106 para el host: mismo layout de frame buffer que
+// Adafruit_GrayOLED (página de 8 filas por byte, LSB arriba) y display() que
+// empuja el frame completo por Wire en trozos de 31 bytes como la librería.
+#include "Arduino.h"
+#include "Wire.h"
+
+#define SH110X_BLACK   0
+#define SH110X_WHITE   1
+#define SH110X_INVERSE 2
+
+class Adafruit_SH1106G : public Print {
+public:
+  Adafruit_SH1106G(uint16_t w, uint16_t h, TwoWire* twi = &Wire, int16_t rstPin = -1,
+                   uint32_t preclk = 400000, uint32_t postclk = 100000);
+  ~Adafruit_SH1106G();
+
+  bool begin(uint8_t addr = 0x3C, bool reset = true);
+  void display();
+  void clearDisplay();
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color);
+  bool getPixel(int16_t x, int16_t y) const;
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void fillScreen(uint16_t color) { fillRect(0, 0, _w, _h, color); }
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) { fillRect(x, y, w, 1, color); }
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) { fillRect(x, y, 1, h, color); }
+  void drawBitmap(int16_t x, int16_t y, const uint8_t* bmp, int16_t w, int16_t h, uint16_t color);
+  void drawBitmap(int16_t x, int16_t y, const uint8_t* bmp, int16_t w, int16_t h, uint16_t color, uint16_t bg);
+  void drawXBitmap(int16_t x, int16_t y, const uint8_t* bmp, int16_t w, int16_t h, uint16_t color);
+
+  void setCursor(int16_t x, int16_t y) { _cx = x; _cy = y; }
+  void setTextSize(uint8_t s) { _ts = s ? s : 1; }
+  void setTextColor(uint16_t c) { _tc = c; _tbg = c; }
+  void setTextColor(uint16_t c, uint16_t bg) { _tc = c; _tbg = bg; }
+  void setTextWrap(bool w) { _wrap = w; }
+  void setContrast(uint8_t) {}
+
+  int16_t width() const  { return _w; }
+  int16_t height() const { return _h; }
+  uint8_t getRotation() const { return 0; }
+  uint8_t* getBuffer() { return _buf; }
+
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+private:
+  void drawGlyph(int16_t x, int16_t y, uint8_t c);
+
+  TwoWire* _wire;
+  int16_t  _w, _h;
+  uint8_t* _buf;
+  uint8_t  _addr = 0x3C;
+  int16_t  _cx = 0, _cy = 0;
+  uint8_t  _ts = 1;
+  uint16_t _tc = SH110X_WHITE, _tbg = SH110X_WHITE;
+  bool     _wrap = true;
+};
@@ -0,0 +1,308 @@
+#pragma once
+// Shim mínimo del core Arduino-ESP32 para el entorno `native` (host Linux).
+// Sólo cubre lo que usan los módulos compilados en el benchmark y la librería
+// Adafruit_Fingerprint; el tiempo corre sobre VirtualClock.
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <mutex>
+
+#include "../VirtualClock.h"
+
+typedef bool    boolean;
+typedef uint8_t byte;
+typedef uint16_t word;
+
+using std::min;
+using std::max;
+
+#define DEC 10
+#define HEX 16
+
+#define LOW    0x0
+#define HIGH   0x1
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+#define INPUT_PULLDOWN 0x09
+#define RISING   0x01
+#define FALLING  0x02
+#define CHANGE   0x03
+
+#define SERIAL_8N1 0x800001c
+
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+#define IRAM_ATTR
+#define pgm_read_byte(addr)      (*(const uint8_t*)(addr))
+#define pgm_read_byte_near(addr) pgm_read_byte(addr)
+#define pgm_read_word(addr)      (*(const uint16_t*)(addr))
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+// ===== GPIO (simulado en HostArduino.cpp) =====
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int  digitalRead(uint8_t pin);
+inline int digitalPinToInterrupt(int pin) { return pin; }
+void attachInterruptArg(uint8_t pin, void (*isr)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+// Sólo host: el nivel de `pin` lo da `level` (p.ej. la línea touch del R305
+// emulado). Los flancos se evalúan en cada delay() y disparan la ISR adjunta.
+void hostBindPin(uint8_t pin, std::function<int()> level);
+void hostServiceGpio();
+
+// ===== tiempo (virtual) =====
+inline unsigned long micros() { return (unsigned long)VirtualClock::nowUs(); }
+inline unsigned long millis() { return (unsigned long)(VirtualClock::nowUs() / 1000ULL); }
+inline void delay(uint32_t ms)              { VirtualClock::advanceUs((uint64_t)ms * 1000ULL); hostServiceGpio(); }
+inline void delayMicroseconds(uint32_t us)  { VirtualClock::advanceUs(us); }
+inline void yield() {}
+
+// newlib (ESP32) la trae; glibc < 2.38 no
+inline size_t strlcpy(char* dst, const char* src, size_t n) {
+  const size_t len = strlen(src);
+  if (n) { const size_t c = len < n - 1 ? len : n - 1; memcpy(dst, src, c); dst[c] = '\0'; }
+  return len;
+}
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// ===== String =====
+class String {
+public:
+  String() {}
+  String(const char* s) : s_(s ? s : "") {}
+  String(const std::string& s) : s_(s) {}
+  String(const __FlashStringHelper* s) : s_(reinterpret_cast<const char*>(s)) {}
+  explicit String(char c) : s_(1, c) {}
+  String(int v, unsigned char base = DEC)           { fmt(base == HEX ? "%x" : "%d", v); }
+  String(unsigned int v, unsigned char base = DEC)  { fmt(base == HEX ? "%x" : "%u", v); }
+  String(long v, unsigned char base = DEC)          { fmt(base == HEX ? "%lx" : "%ld", v); }
+  String(unsigned long v, unsigned char base = DEC) { fmt(base == HEX ? "%lx" : "%lu", v); }
+  String(double v, unsigned int decimals = 2)       { char f[8]; snprintf(f, sizeof(f), "%%.%uf", decimals); fmt(f, v); }
+
+  const char*  c_str()  const { return s_.c_str(); }
+  unsigned int length() const { return (unsigned int)s_.size(); }
+  bool isEmpty() const { return s_.empty(); }
+  void reserve(unsigned int n) { s_.reserve(n); }
+
+  char operator[](unsigned int i) const { return i < s_.size() ? s_[i] : 0; }
+  char charAt(unsigned int i) const { return (*this)[i]; }
+
+  String& operator+=(const String& o) { s_ += o.s_; return *this; }
+  String& operator+=(const char* o)   { s_ += (o ? o : ""); return *this; }
+  String& operator+=(char c)          { s_ += c; return *this; }
+  String& operator+=(int v)           { return *this += String(v); }
+  String& operator+=(unsigned int v)  { return *this += String(v); }
+  String& operator+=(long v)          { return *this += String(v); }
+  String& operator+=(unsigned long v) { return *this += String(v); }
+  bool concat(const String& o) { s_ += o.s_; return true; }
+
+  friend String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+  friend String operator+(const String& a, const char* b)   { String r(a); r += b; return r; }
+  friend String operator+(const char* a, const String& b)   { String r(a); r += b; return r; }
+  friend String operator+(const String& a, char b)          { String r(a); r += b; return r; }
+  friend String operator+(const String& a, int b)           { String r(a); r += b; return r; }
+  friend String operator+(const String& a, unsigned int b)  { String r(a); r += b; return r; }
+  friend String operator+(const String& a, long b)          { String r(a); r += b; return r; }
+  friend String operator+(const String& a, unsigned long b) { String r(a); r += b; return r; }
+
+  bool operator==(const String& o) const { return s_ == o.s_; }
+  bool operator==(const char* o)   const { return s_ == (o ? o : ""); }
+  bool operator!=(const String& o) const { return !(*this == o); }
+  bool operator!=(const char* o)   const { return !(*this == o); }
+  bool operator<(const String& o)  const { return s_ < o.s_; }
+
+  bool startsWith(const String& p) const { return s_.compare(0, p.s_.size(), p.s_) == 0; }
+  bool endsWith(const String& p) const {
+    return s_.size() >= p.s_.size() && s_.compare(s_.size() - p.s_.size(), p.s_.size(), p.s_) == 0;
+  }
+  int indexOf(char c, unsigned int from = 0) const {
+    size_t i = s_.find(c, from); return i == std::string::npos ? -1 : (int)i;
+  }
+  int indexOf(const String& p, unsigned int from = 0) const {
+    size_t i = s_.find(p.s_, from); return i == std::string::npos ? -1 : (int)i;
+  }
+  String substring(unsigned int from) const { return from >= s_.size() ? String() : String(s_.substr(from)); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > to) std::swap(from, to);
+    if (from >= s_.size()) return String();
+    return String(s_.substr(from, to - from));
+  }
+  void trim() {
+    size_t b = s_.find_first_not_of(" \t\r\n");
+    size_t e = s_.find_last_not_of(" \t\r\n");
+    s_ = (b == std::string::npos) ? std::string() : s_.substr(b, e - b + 1);
+  }
+  void toLowerCase() { for (auto& c : s_) c = (char)tolower((unsigned char)c); }
+  void toUpperCase() { for (auto& c : s_) c = (char)toupper((unsigned char)c); }
+  long  toInt()   const { return strtol(s_.c_str(), nullptr, 10); }
+  float toFloat() const { return strtof(s_.c_str(), nullptr); }
+
+private:
+  template <typename T> void fmt(const char* f, T v) {
+    char b[40]; snprintf(b, sizeof(b), f, v); s_ = b;
+  }
+  std::string s_;
+};
+
+// ===== Print / Stream =====
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buf, size_t n) {
+    size_t w = 0; while (n--) w += write(*buf++); return w;
+  }
+  size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+
+  size_t print(const char* s)   { return write(s); }
+  size_t print(const String& s) { return write(s.c_str()); }
+  size_t print(const __FlashStringHelper* s) { return write(reinterpret_cast<const char*>(s)); }
+  size_t print(char c)          { return write((uint8_t)c); }
+  size_t print(int v, int base = DEC)           { return print(String(v, (unsigned char)base)); }
+  size_t print(unsigned int v, int base = DEC)  { return print(String(v, (unsigned char)base)); }
+  size_t print(long v, int base = DEC)          { return print(String(v, (unsigned char)base)); }
+  size_t print(unsigned long v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+  size_t print(unsigned char v, int base = DEC) { return print((unsigned int)v, base); }
+  size_t print(double v, int digits = 2)        { return print(String(v, (unsigned int)digits)); }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T& v) { size_t n = print(v); return n + println(); }
+  template <typename T> size_t println(const T& v, int base) { size_t n = print(v, base); return n + println(); }
+
+  size_t printf(const char* f, ...) __attribute__((format(printf, 2, 3))) {
+    char b[512];
+    va_list ap; va_start(ap, f);
+    int n = vsnprintf(b, sizeof(b), f, ap);
+    va_end(ap);
+    if (n < 0) return 0;
+    return write((const uint8_t*)b, std::min((size_t)n, sizeof(b) - 1));
+  }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() {}
+  void setTimeout(unsigned long ms) { timeout_ = ms; }
+  String readStringUntil(char term) {
+    String s; unsigned long t0 = millis();
+    while (millis() - t0 < timeout_) {
+      int c = read();
+      if (c < 0) { delay(1); continue; }
+      if (c == term) break;
+      s += (char)c;
+    }
+    return s;
+  }
+protected:
+  unsigned long timeout_ = 1000;
+};
+
+// Consola del host: escribe en stdout. `setQuiet(true)` silencia los logs del
+// firmware para que la salida del benchmark quede legible.
+class HostSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+  void setQuiet(bool q) { quiet_ = q; }
+  size_t write(uint8_t c) override { if (!quiet_) fputc(c, stdout); return 1; }
+  size_t write(const uint8_t* b, size_t n) override { if (!quiet_) fwrite(b, 1, n, stdout); return n; }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  operator bool() const { return true; }
+private:
+  bool quiet_ = false;
+};
+extern HostSerial Serial;
+
+// ===== FreeRTOS (run-to-completion) =====
+// En host no hay scheduler: xTaskCreatePinnedToCore ejecuta la función de la
+// tarea en el acto y vTaskDelete(nullptr) simplemente retorna.
+typedef void* TaskHandle_t;
+typedef int   BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void (*TaskFunction_t)(void*);
+#define pdPASS  1
+#define pdFAIL  0
+#define pdTRUE  1
+#define pdFALSE 0
+#define portMAX_DELAY 0xffffffffUL
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char*, uint32_t, void* arg,
+                                          UBaseType_t, TaskHandle_t* handle, BaseType_t) {
+  if (handle) *handle = nullptr;
+  fn(arg);
+  return pdPASS;
+}
+inline void vTaskDelete(TaskHandle_t) {}
+inline void vTaskDelay(TickType_t ticks) { delay(ticks); }
+
+// Colas: buffer circular de copias, como xQueue. Sin otras tareas que puedan
+// llenarla, recibir de una cola vacía vuelve enseguida aunque se pida esperar.
+struct HostQueue {
+  std::string  data;
+  UBaseType_t  itemSize, capacity, head = 0, count = 0;
+};
+typedef HostQueue* QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t itemSize) {
+  HostQueue* q = new HostQueue{std::string((size_t)len * itemSize, '\0'), itemSize, len};
+  return q;
+}
+inline void vQueueDelete(QueueHandle_t q) { delete q; }
+inline UBaseType_t uxQueueMessagesWaiting(const QueueHandle_t q) { return q->count; }
+inline BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t) {
+  if (q->count == q->capacity) return pdFALSE;
+  const UBaseType_t slot = (q->head + q->count) % q->capacity;
+  memcpy(&q->data[(size_t)slot * q->itemSize], item, q->itemSize);
+  ++q->count;
+  return pdTRUE;
+}
+inline BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t) {
+  if (q->count == 0) return pdFALSE;
+  memcpy(item, &q->data[(size_t)q->head * q->itemSize], q->itemSize);
+  q->head = (q->head + 1) % q->capacity;
+  --q->count;
+  return pdTRUE;
+}
+
+// Mutex: std::recursive_mutex (el benchmark sí usa hilos reales en algunas
+// pruebas). Con espera 0 es un intento; cualquier otra espera bloquea.
+typedef std::recursive_mutex* SemaphoreHandle_t;
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new std::recursive_mutex(); }
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { return new std::recursive_mutex(); }
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t m, TickType_t wait) {
+  if (wait == 0) return m->try_lock() ? pdTRUE : pdFALSE;
+  m->lock();
+  return pdTRUE;
+}
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t m) { m->unlock(); return pdTRUE; }
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t m, TickType_t wait) { return xSemaphoreTake(m, wait); }
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t m) { return xSemaphoreGive(m); }
+
+// Secciones críticas (portMUX): un mutex por instancia
+struct portMUX_TYPE { std::recursive_mutex m; };
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(mux) ((mux)->m.lock())
+#define portEXIT_CRITICAL(mux)  ((mux)->m.unlock())
+
+#include "HardwareSerial.h"
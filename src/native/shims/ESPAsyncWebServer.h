@@ -0,0 +1,110 @@
+#pragma once
+// En host no hay red: servidor en memoria. Las rutas se registran como en
+// ESPAsyncWebServer y el benchmark las ejecuta con AsyncWebServer::dispatch(),
+// que deja el status y el cuerpo en el request. AsyncEventSource guarda lo
+// que se envía (con `clients` > 0).
+#include "Arduino.h"
+#include "WiFi.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+enum WebRequestMethod : uint8_t {
+  HTTP_GET = 0b00000001, HTTP_POST = 0b00000010, HTTP_DELETE = 0b00000100, HTTP_PUT = 0b00001000,
+  HTTP_PATCH = 0b00010000, HTTP_HEAD = 0b00100000, HTTP_OPTIONS = 0b01000000, HTTP_ANY = 0b01111111,
+};
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebParameter {
+public:
+  AsyncWebParameter(const String& name, const String& value, bool post) : _name(name), _value(value), _post(post) {}
+  const String& name() const { return _name; }
+  const String& value() const { return _value; }
+  bool isPost() const { return _post; }
+private:
+  String _name, _value;
+  bool _post;
+};
+
+class AsyncWebServerResponse {
+public:
+  AsyncWebServerResponse(int code, const String& type, const String& body) : code(code), type(type), body(body) {}
+  void addHeader(const String& name, const String& value) { headers.push_back({name, value}); }
+  int code;
+  String type, body;
+  std::vector<std::pair<String, String>> headers;
+};
+
+class AsyncWebServerRequest {
+public:
+  AsyncWebServerRequest(WebRequestMethodComposite method, const String& url) : _method(method), _url(url) {}
+  WebRequestMethodComposite method() const { return _method; }
+  const String& url() const { return _url; }
+  void addParam(const String& name, const String& value, bool post = false) { _params.emplace_back(name, value, post); }
+
+  bool hasParam(const String& name, bool post = false) const {
+    for (const auto& p : _params) if (p.name() == name && p.isPost() == post) return true;
+    return false;
+  }
+  AsyncWebParameter* getParam(const String& name, bool post = false) {
+    for (auto& p : _params) if (p.name() == name && p.isPost() == post) return &p;
+    return nullptr;
+  }
+  AsyncWebServerResponse* beginResponse(int code, const String& type = String(), const String& body = String()) {
+    return new AsyncWebServerResponse(code, type, body);
+  }
+  void send(AsyncWebServerResponse* res) { _response.reset(res); }
+  void send(int code, const String& type = String(), const String& body = String()) {
+    send(beginResponse(code, type, body));
+  }
+  // nullptr si el handler no respondió
+  const AsyncWebServerResponse* response() const { return _response.get(); }
+
+private:
+  WebRequestMethodComposite _method;
+  String _url;
+  std::vector<AsyncWebParameter> _params;
+  std::unique_ptr<AsyncWebServerResponse> _response;
+};
+
+typedef std::function<void(AsyncWebServerRequest*)> ArRequestHandlerFunction;
+
+class AsyncWebHandler {
+public:
+  virtual ~AsyncWebHandler() {}
+};
+
+class AsyncEventSource : public AsyncWebHandler {
+public:
+  explicit AsyncEventSource(const String& url) : _url(url) {}
+  size_t count() const { return clients; }
+  void send(const char* message, const char* event = nullptr, uint32_t id = 0, uint32_t reconnect = 0) {
+    sent.push_back({event ? event : "", message ? message : ""});
+  }
+  size_t clients = 0;                                  // clientes SSE simulados
+  std::vector<std::pair<String, String>> sent;         // (evento, datos)
+private:
+  String _url;
+};
+
+class AsyncWebServer {
+public:
+  explicit AsyncWebServer(uint16_t port) {}
+  void on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction fn) {
+    _routes.push_back({uri, method, fn});
+  }
+  AsyncWebHandler& addHandler(AsyncWebHandler* h) { return *h; }
+  void begin() {}
+
+  // Ejecuta la ruta que coincide; false si no hay ninguna (404)
+  bool dispatch(AsyncWebServerRequest& req) {
+    for (auto& r : _routes) {
+      if (r.uri == req.url() && (r.method & req.method())) { r.fn(&req); return true; }
+    }
+    return false;
+  }
+
+private:
+  struct Route { String uri; WebRequestMethodComposite method; ArRequestHandlerFunction fn; };
+  std::vector<Route> _routes;
+};
@@ -0,0 +1,35 @@
+#pragma once
+#include "Arduino.h"
+
+class R305Emulator;
+
+// UART del host: en lugar de un periférico real, habla con un R305Emulator
+// conectado con attach(). Los bytes viajan con el tiempo de línea del baud
+// configurado (ver R305Emulator).
+class HardwareSerial : public Stream {
+public:
+  explicit HardwareSerial(int uartNr) : uartNr_(uartNr) {}
+
+  void attach(R305Emulator* emu) { emu_ = emu; }
+
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1,
+             bool invert = false, unsigned long timeoutMs = 20000UL, uint8_t rxfifoFullThrhd = 112);
+  size_t setRxBufferSize(size_t n) { return n; }   // el emulador no tiene FIFO de RX
+  void updateBaudRate(unsigned long baud);
+  void end();
+  uint32_t baudRate() const { return baud_; }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  void flush() override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buf, size_t n) override { return Print::write(buf, n); }
+  using Print::write;
+  operator bool() const { return emu_ != nullptr; }
+
+private:
+  int uartNr_;
+  uint32_t baud_ = 0;
+  R305Emulator* emu_ = nullptr;
+};
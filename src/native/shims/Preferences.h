@@ -0,0 +1,39 @@
+#pragma once
+// Preferences en RAM para el host: un mapa clave->bytes por namespace que
+// persiste mientras viva el proceso.
+#include "Arduino.h"
+#include <map>
+#include <vector>
+
+class Preferences {
+public:
+  bool begin(const char* name, bool readOnly = false, const char* partition = nullptr);
+  void end() { _ns = nullptr; }
+
+  bool clear();
+  bool remove(const char* key);
+  bool isKey(const char* key);
+
+  size_t putString(const char* key, const String& value);
+  size_t putString(const char* key, const char* value) { return putString(key, String(value)); }
+  String getString(const char* key, const String& def = String());
+  size_t getString(const char* key, char* value, size_t maxLen);
+
+  size_t   putUInt(const char* key, uint32_t v) { return putBytes(key, &v, sizeof(v)); }
+  uint32_t getUInt(const char* key, uint32_t def = 0) { getBytes(key, &def, sizeof(def)); return def; }
+  size_t   putUChar(const char* key, uint8_t v) { return putBytes(key, &v, sizeof(v)); }
+  uint8_t  getUChar(const char* key, uint8_t def = 0) { getBytes(key, &def, sizeof(def)); return def; }
+  size_t   putUShort(const char* key, uint16_t v) { return putBytes(key, &v, sizeof(v)); }
+  uint16_t getUShort(const char* key, uint16_t def = 0) { getBytes(key, &def, sizeof(def)); return def; }
+  size_t   putBool(const char* key, bool v) { return putUChar(key, v ? 1 : 0); }
+  bool     getBool(const char* key, bool def = false) { return getUChar(key, def ? 1 : 0) != 0; }
+
+  size_t putBytes(const char* key, const void* value, size_t len);
+  size_t getBytes(const char* key, void* buf, size_t maxLen);
+  size_t getBytesLength(const char* key);
+
+private:
+  using Blob = std::vector<uint8_t>;
+  std::map<std::string, Blob>* _ns = nullptr;
+  bool _ro = false;
+};
@@ -0,0 +1,15 @@
+#pragma once
+// En host no hay Wi-Fi: siempre desconectado, IP 0.0.0.0.
+#include "Arduino.h"
+
+class IPAddress {
+public:
+  String toString() const { return "0.0.0.0"; }
+};
+
+class HostWiFi {
+public:
+  bool isConnected() const { return false; }
+  IPAddress localIP() const { return IPAddress(); }
+};
+extern HostWiFi WiFi;
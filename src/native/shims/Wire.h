@@ -0,0 +1,39 @@
+#pragma once
+#include "Arduino.h"
+
+// Bus I2C del host: no hay dispositivo real, sólo se contabilizan los bytes y
+// se avanza el reloj virtual según la frecuencia configurada (9 bits por byte
+// más dirección y start/stop por transacción).
+class TwoWire : public Stream {
+public:
+  explicit TwoWire(uint8_t busNum) : bus_(busNum) {}
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) {
+    (void)sda; (void)scl; if (frequency) clock_ = frequency; return true;
+  }
+  void setClock(uint32_t hz) { clock_ = hz; }
+  uint32_t getClock() const { return clock_; }
+
+  void beginTransmission(uint16_t addr) { (void)addr; pending_ = 0; }
+  uint8_t endTransmission(bool sendStop = true);
+  size_t write(uint8_t) override { ++pending_; return 1; }
+  size_t write(const uint8_t* b, size_t n) override { (void)b; pending_ += n; return n; }
+  using Print::write;
+
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+
+  // estadísticas del host
+  uint64_t bytesWritten() const  { return bytes_; }
+  uint32_t transactions() const  { return transactions_; }
+  void resetStats() { bytes_ = 0; transactions_ = 0; }
+
+private:
+  uint8_t  bus_;
+  uint32_t clock_ = 100000;
+  size_t   pending_ = 0;
+  uint64_t bytes_ = 0;
+  uint32_t transactions_ = 0;
+};
+
+extern TwoWire Wire;
@@ -0,0 +1,42 @@
+#pragma once
+// Shim de esp_partition (ESP-IDF 4.4): una partición de datos "spiffs" en RAM
+// con semántica NOR (escribir sólo baja bits, borrar deja 0xFF por sector).
+// Lecturas, escrituras y borrados avanzan el reloj virtual.
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+typedef enum {
+  ESP_PARTITION_TYPE_APP  = 0x00,
+  ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef enum {
+  ESP_PARTITION_SUBTYPE_DATA_SPIFFS = 0x82,
+  ESP_PARTITION_SUBTYPE_ANY         = 0xff,
+} esp_partition_subtype_t;
+
+typedef struct {
+  void*                   flash_chip;
+  esp_partition_type_t    type;
+  esp_partition_subtype_t subtype;
+  uint32_t                address;
+  uint32_t                size;
+  char                    label[17];
+  bool                    encrypted;
+} esp_partition_t;
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char* label);
+esp_err_t esp_partition_read(const esp_partition_t* p, size_t src_offset, void* dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t* p, size_t dst_offset, const void* src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t* p, size_t offset, size_t size);
+
+// Sólo host: tamaño de la partición (se borra entera), corte de energía en la
+// próxima escritura (se graban sólo `keepBytes`) y contadores
+void hostFlashReset(uint32_t size);
+void hostFlashTearNextWrite(size_t keepBytes);
+struct HostFlashStats { uint32_t reads, writes, erases; };
+HostFlashStats hostFlashStats();
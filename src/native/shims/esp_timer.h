@@ -0,0 +1,6 @@
+#pragma once
+// esp_timer sobre el reloj virtual
+#include <stdint.h>
+#include "../VirtualClock.h"
+
+inline int64_t esp_timer_get_time() { return (int64_t)VirtualClock::nowUs(); }
@@ -0,0 +1,30 @@
+#pragma once
+// Shim de la API C de NVS (ESP-IDF 4.4) sobre el mismo almacén en RAM que
+// Preferences (HostArduino.cpp). Sólo lo que usa NamesModel.
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+
+#define NVS_DEFAULT_PART_NAME "nvs"
+#define NVS_KEY_NAME_MAX_SIZE 16
+
+typedef enum { NVS_TYPE_STR = 0x21, NVS_TYPE_BLOB = 0x42, NVS_TYPE_ANY = 0xff } nvs_type_t;
+
+typedef struct {
+  char namespace_name[16];
+  char key[NVS_KEY_NAME_MAX_SIZE];
+  nvs_type_t type;
+} nvs_entry_info_t;
+
+typedef struct nvs_opaque_iterator_t* nvs_iterator_t;
+
+// Tipos no se distinguen en el host: NVS_TYPE_STR devuelve todas las claves.
+nvs_iterator_t nvs_entry_find(const char* part, const char* ns, nvs_type_t type);
+nvs_iterator_t nvs_entry_next(nvs_iterator_t it);   // NULL al final (libera)
+void           nvs_entry_info(nvs_iterator_t it, nvs_entry_info_t* out);
+void           nvs_release_iterator(nvs_iterator_t it);
+
+// Sólo host: escrituras hechas (Preferences: cada put/remove)
+uint32_t hostNvsWrites();